@@ -131,7 +131,8 @@ void send_gps_coords_from_module() {
 	uint8_t buffer[50] = "AT+SEND=";
 	offset = 8;
 	buffer[offset++] = 0x45;
-	buffer[offset++] = 0x01;
+	/* Position update, only the newest one needs to go out */
+	buffer[offset++] = 0x02;
 	/* Take the 4 most significant bytes (endianness) */
 	buffer[offset++] = *(((uint8_t*)(&lat))+7);
 	buffer[offset++] = *(((uint8_t*)(&lat))+6);
@@ -115,6 +115,9 @@ void register_sys_functions(LOWAPP_SYS_IF_T *lowappSys) {
 	lowappSys->SYS_initTimer2 = init_timer2;
 	lowappSys->SYS_setTimer2 = set_timer2;
 	lowappSys->SYS_cancelTimer2 = cancel_timer2;
+	lowappSys->SYS_initTimer3 = init_timer3;
+	lowappSys->SYS_setTimer3 = set_timer3;
+	lowappSys->SYS_cancelTimer3 = cancel_timer3;
 	lowappSys->SYS_initRepetitiveTimer = init_timer_cad;
 	lowappSys->SYS_setRepetitiveTimer = set_timer_cad;
 	lowappSys->SYS_cancelRepetitiveTimer = cancel_timer_cad;
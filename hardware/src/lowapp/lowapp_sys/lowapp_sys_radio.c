@@ -6,6 +6,7 @@
  * @date October 24, 2016
  */
 #include "lowapp_sys_radio.h"
+#include "lowapp_msg.h"
 #include "sx1272_ex.h"
 #include "board.h"
 
@@ -38,7 +39,10 @@ void radio_init(Lowapp_RadioEvents_t *evt) {
 	events.RxTimeout = evt->RxTimeout;
 	events.TxDone = evt->TxDone;
 	events.TxTimeout = evt->TxTimeout;
+	/* The driver reads the hint of the frames on the ValidHeader interrupt */
+	events.RxHeader = evt->RxHeader;
 	Radio.Init(&events);
+	setRxHeaderSize(FRAME_HINT_END);
 }
 
 /**
@@ -53,6 +57,7 @@ void radio_setCallbacks(Lowapp_RadioEvents_t *evt) {
 	events.RxTimeout = evt->RxTimeout;
 	events.TxDone = evt->TxDone;
 	events.TxTimeout = evt->TxTimeout;
+	events.RxHeader = evt->RxHeader;
 	setRadioCallbacks(&events);
 }
 
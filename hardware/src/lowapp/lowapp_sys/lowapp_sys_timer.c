@@ -21,6 +21,8 @@
 TimerEvent_t lowapp_timer_sm1;
 /** Timer 2 used in the state machine */
 TimerEvent_t lowapp_timer_sm2;
+/** Timer 3 used in the state machine */
+TimerEvent_t lowapp_timer_sm3;
 /** Repetitive timer for CAD interval */
 TimerEvent_t lowapp_timer_cad;
 
@@ -28,6 +30,8 @@ TimerEvent_t lowapp_timer_cad;
 void (*lowapp_timer_sm1_cb)(void) = NULL;
 /** Callback for one shot timer 2 */
 void (*lowapp_timer_sm2_cb)(void) = NULL;
+/** Callback for one shot timer 3 */
+void (*lowapp_timer_sm3_cb)(void) = NULL;
 /** Callback for repetitive timer */
 void (*lowapp_timer_cad_cb)(void) = NULL;
 
@@ -39,6 +43,7 @@ void init_timers() {
 	/* Init timers */
 	TimerInit(&lowapp_timer_sm1, lowapp_timer_sm1_cb);
 	TimerInit(&lowapp_timer_sm2, lowapp_timer_sm2_cb);
+	TimerInit(&lowapp_timer_sm3, lowapp_timer_sm3_cb);
 	TimerInit(&lowapp_timer_cad, lowapp_timer_cad_cb);
 }
 
@@ -48,6 +53,7 @@ void init_timers() {
 void clear_timer() {
 	TimerStop(&lowapp_timer_sm1);
 	TimerStop(&lowapp_timer_sm2);
+	TimerStop(&lowapp_timer_sm3);
 	TimerStop(&lowapp_timer_cad);
 }
 
@@ -93,6 +99,26 @@ void set_timer2(uint32_t timems) {
 	TimerStart(&lowapp_timer_sm2);
 }
 
+/**
+ * Initialise timer 3
+ *
+ * @param callback Callback to call when the signal is received
+ */
+void init_timer3(void (*callback)(void)) {
+	lowapp_timer_sm3_cb = callback;
+	TimerInit(&lowapp_timer_sm3, lowapp_timer_sm3_cb);
+}
+
+/**
+ * Request to set a callback to be called after timems ms using timer 3
+ *
+ * @param timems Time after which the timer should send its signal
+ */
+void set_timer3(uint32_t timems) {
+	TimerSetValue(&lowapp_timer_sm3, timems);
+	TimerStart(&lowapp_timer_sm3);
+}
+
 /**
  * Initialise repetitive timer
  *
@@ -127,6 +153,13 @@ void cancel_timer2() {
 	TimerStop(&lowapp_timer_sm2);
 }
 
+/**
+ * Disarm the timer 3
+ */
+void cancel_timer3() {
+	TimerStop(&lowapp_timer_sm3);
+}
+
 /**
  * Disarm the timer cad
  */
@@ -15,12 +15,15 @@ int init_timers();
 void clear_timer();
 void init_timer1(void (*callback)(void));
 void init_timer2(void (*callback)(void));
+void init_timer3(void (*callback)(void));
 void init_timer_cad(void (*callback)(void));
 void set_timer1(uint32_t timems);
 void set_timer2(uint32_t timems);
+void set_timer3(uint32_t timems);
 void set_timer_cad(uint32_t timems);
 void cancel_timer1();
 void cancel_timer2();
+void cancel_timer3();
 void cancel_timer_cad();
 
 uint64_t get_time_ms();
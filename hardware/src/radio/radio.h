@@ -80,6 +80,18 @@ typedef struct
      * \param [IN] channelDetected    Channel Activity detected during the CAD
      */
     void ( *CadDone ) ( bool channelActivityDetected );
+    /*!
+     * \brief Rx Header callback prototype, NULL if not used.
+     *
+     * LoRa only: called with the first bytes of the payload (see
+     *            setRxHeaderSize) while the frame is still being received.
+     *
+     * \param [IN] payload Bytes received so far
+     * \param [IN] size    Number of bytes received so far
+     * \retval true To go on with the reception
+     * \retval false To stop it, RxDone is then called with these bytes only
+     */
+    bool ( *RxHeader ) ( uint8_t *payload, uint16_t size );
 }RadioEvents_t;
 
 /*!
@@ -121,6 +121,12 @@ void SX1272OnDio5Irq( void );
  */
 void SX1272OnTimeoutIrq( void );
 
+/*!
+ * \brief Rx header timer callback, gives the first RxHeaderSize payload
+ *        bytes to RxHeader once they have been received
+ */
+void SX1272OnRxHeaderIrq( void );
+
 /*
  * Private global constants
  */
@@ -204,6 +210,7 @@ DioIrqHandler *DioIrq[] = { SX1272OnDio0Irq, SX1272OnDio1Irq,
 TimerEvent_t TxTimeoutTimer;
 TimerEvent_t RxTimeoutTimer;
 TimerEvent_t RxTimeoutSyncWord;
+TimerEvent_t RxHeaderTimer;
 
 /*
  * Radio driver functions implementation
@@ -219,6 +226,7 @@ void SX1272Init( RadioEvents_t *events )
     TimerInit( &TxTimeoutTimer, SX1272OnTimeoutIrq );
     TimerInit( &RxTimeoutTimer, SX1272OnTimeoutIrq );
     TimerInit( &RxTimeoutSyncWord, SX1272OnTimeoutIrq );
+    TimerInit( &RxHeaderTimer, SX1272OnRxHeaderIrq );
 
     SX1272Reset( );
 
@@ -710,6 +718,35 @@ uint32_t SX1272GetTimeOnAir( RadioModems_t modem, uint8_t pktLen )
     return airTime;
 }
 
+/*!
+ * \brief Time needed to receive the first payload bytes after a valid
+ *        explicit LoRa header
+ *
+ * The 8 symbols of the header block carry the first payload bits, the next
+ * ones come by blocks of ( Coderate + 4 ) symbols. One symbol is added as a
+ * margin.
+ *
+ * \param [IN] size Number of payload bytes
+ * \retval time Reception time [ms], at least 1 ms
+ */
+static uint32_t GetLoRaRxHeaderTime( uint8_t size )
+{
+    int32_t sf = SX1272.Settings.LoRa.Datarate;
+    int32_t bits = ( 8 * size ) - ( 4 * sf ) + 28;
+    int32_t bitsPerBlock = 4 * ( sf - ( ( SX1272.Settings.LoRa.LowDatarateOptimize > 0 ) ? 2 : 0 ) );
+    uint32_t symbols = 1;
+    uint32_t time;
+
+    if( bits > 0 )
+    {
+        symbols += ( ( bits + bitsPerBlock - 1 ) / bitsPerBlock ) * ( SX1272.Settings.LoRa.Coderate + 4 );
+    }
+    // Symbol time in us to keep the precision at high data rates
+    time = ( symbols * ( ( 1000UL << sf ) / ( 125 << SX1272.Settings.LoRa.Bandwidth ) ) + 999 ) / 1000;
+
+    return ( time > 0 ) ? time : 1;
+}
+
 void SX1272Send( uint8_t *buffer, uint8_t size )
 {
     uint32_t txTimeout = 0;
@@ -788,6 +825,7 @@ void SX1272SetSleep( void )
 {
     TimerStop( &RxTimeoutTimer );
     TimerStop( &TxTimeoutTimer );
+    TimerStop( &RxHeaderTimer );
 
     SX1272SetOpMode( RF_OPMODE_SLEEP );
     SX1272.Settings.State = RF_IDLE;
@@ -797,6 +835,7 @@ void SX1272SetStby( void )
 {
     TimerStop( &RxTimeoutTimer );
     TimerStop( &TxTimeoutTimer );
+    TimerStop( &RxHeaderTimer );
 
     SX1272SetOpMode( RF_OPMODE_STANDBY );
     SX1272.Settings.State = RF_IDLE;
@@ -871,17 +910,34 @@ void SX1272SetRx( uint32_t timeout )
             }
             else
             {
-                SX1272Write( REG_LR_IRQFLAGSMASK, //RFLR_IRQFLAGS_RXTIMEOUT |
-                                                  //RFLR_IRQFLAGS_RXDONE |
-                                                  //RFLR_IRQFLAGS_PAYLOADCRCERROR |
-                                                  RFLR_IRQFLAGS_VALIDHEADER |
-                                                  RFLR_IRQFLAGS_TXDONE |
-                                                  RFLR_IRQFLAGS_CADDONE |
-                                                  RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL |
-                                                  RFLR_IRQFLAGS_CADDETECTED );
-
-                // DIO0=RxDone
-                SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_00 );
+                if( ( SX1272.Settings.LoRa.RxHeaderSize != 0 ) && ( RadioEvents != NULL ) && ( RadioEvents->RxHeader != NULL ) )
+                {
+                    SX1272Write( REG_LR_IRQFLAGSMASK, //RFLR_IRQFLAGS_RXTIMEOUT |
+                                                      //RFLR_IRQFLAGS_RXDONE |
+                                                      //RFLR_IRQFLAGS_PAYLOADCRCERROR |
+                                                      //RFLR_IRQFLAGS_VALIDHEADER |
+                                                      RFLR_IRQFLAGS_TXDONE |
+                                                      RFLR_IRQFLAGS_CADDONE |
+                                                      RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL |
+                                                      RFLR_IRQFLAGS_CADDETECTED );
+
+                    // DIO0=RxDone, DIO3=ValidHeader
+                    SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO3_MASK ) | RFLR_DIOMAPPING1_DIO0_00 | RFLR_DIOMAPPING1_DIO3_01 );
+                }
+                else
+                {
+                    SX1272Write( REG_LR_IRQFLAGSMASK, //RFLR_IRQFLAGS_RXTIMEOUT |
+                                                      //RFLR_IRQFLAGS_RXDONE |
+                                                      //RFLR_IRQFLAGS_PAYLOADCRCERROR |
+                                                      RFLR_IRQFLAGS_VALIDHEADER |
+                                                      RFLR_IRQFLAGS_TXDONE |
+                                                      RFLR_IRQFLAGS_CADDONE |
+                                                      RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL |
+                                                      RFLR_IRQFLAGS_CADDETECTED );
+
+                    // DIO0=RxDone
+                    SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_00 );
+                }
             }
             SX1272Write( REG_LR_FIFORXBASEADDR, 0 );
             SX1272Write( REG_LR_FIFOADDRPTR, 0 );
@@ -1009,8 +1065,8 @@ void SX1272StartCad( void )
                                         //RFLR_IRQFLAGS_CADDETECTED
                                         );
 
-            // DIO3=CADDone
-            SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK ) | RFLR_DIOMAPPING1_DIO0_00 );
+            // DIO3=CADDone, it may have been mapped to ValidHeader for RX
+            SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO3_MASK ) | RFLR_DIOMAPPING1_DIO0_00 | RFLR_DIOMAPPING1_DIO3_00 );
 
             SX1272.Settings.State = RF_CAD;
             SX1272SetOpMode( RFLR_OPMODE_CAD );
@@ -1186,6 +1242,7 @@ void SX1272OnTimeoutIrq( void )
     switch( SX1272.Settings.State )
     {
     case RF_RX_RUNNING:
+        TimerStop( &RxHeaderTimer );
         if( SX1272.Settings.Modem == MODEM_FSK )
         {
             SX1272.Settings.FskPacketHandler.PreambleDetected = false;
@@ -1325,6 +1382,9 @@ void SX1272OnDio0Irq( void )
                 {
                     int8_t snr = 0;
 
+                    // The whole frame is there, no need to read its start
+                    TimerStop( &RxHeaderTimer );
+
                     // Clear Irq
                     SX1272Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_RXDONE );
 
@@ -1562,7 +1622,16 @@ void SX1272OnDio3Irq( void )
     case MODEM_FSK:
         break;
     case MODEM_LORA:
-        if( ( SX1272Read( REG_LR_IRQFLAGS ) & RFLR_IRQFLAGS_CADDETECTED ) == RFLR_IRQFLAGS_CADDETECTED )
+        if( ( SX1272.Settings.State == RF_RX_RUNNING ) &&
+            ( ( SX1272Read( REG_LR_IRQFLAGS ) & RFLR_IRQFLAGS_VALIDHEADER ) == RFLR_IRQFLAGS_VALIDHEADER ) )
+        {
+            // Clear Irq
+            SX1272Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_VALIDHEADER );
+            // The payload follows the header, read its start once it has been received
+            TimerSetValue( &RxHeaderTimer, GetLoRaRxHeaderTime( SX1272.Settings.LoRa.RxHeaderSize ) );
+            TimerStart( &RxHeaderTimer );
+        }
+        else if( ( SX1272Read( REG_LR_IRQFLAGS ) & RFLR_IRQFLAGS_CADDETECTED ) == RFLR_IRQFLAGS_CADDETECTED )
         {
             // Clear Irq
             SX1272Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_CADDETECTED | RFLR_IRQFLAGS_CADDONE );
@@ -1617,3 +1686,31 @@ void SX1272OnDio5Irq( void )
         break;
     }
 }
+
+void SX1272OnRxHeaderIrq( void )
+{
+    uint8_t start;
+    uint8_t size = SX1272.Settings.LoRa.RxHeaderSize;
+
+    if( ( SX1272.Settings.State != RF_RX_RUNNING ) || ( RadioEvents == NULL ) || ( RadioEvents->RxHeader == NULL ) )
+    {
+        return;
+    }
+    // The timer waits for the reception time of the bytes, RxDone stops it if
+    // the frame is shorter. The payload is read from the FIFO pointer, as for RxDone
+    start = SX1272Read( REG_LR_FIFOADDRPTR );
+    SX1272ReadFifo( RxTxBuffer, size );
+    // Rewind for the RxDone read
+    SX1272Write( REG_LR_FIFOADDRPTR, start );
+
+    if( RadioEvents->RxHeader( RxTxBuffer, size ) == false )
+    {
+        // Drop the rest of the frame, only its start is reported
+        int16_t rssi = SX1272ReadRssi( MODEM_LORA );
+        SX1272SetSleep( );
+        if( RadioEvents->RxDone != NULL )
+        {
+            RadioEvents->RxDone( RxTxBuffer, size, rssi, 0 );
+        }
+    }
+}
@@ -87,6 +87,7 @@ typedef struct
     bool     IqInverted;
     bool     RxContinuous;
     uint32_t TxTimeout;
+    uint8_t  RxHeaderSize;
 }RadioLoRaSettings_t;
 
 /*!
@@ -87,3 +87,13 @@ void setRxContinuous(bool rxContinuous) {
 void setRadioCallbacks( RadioEvents_t *events ) {
 	RadioEvents = events;
 }
+
+/**
+ * Set the number of bytes given to the RxHeader callback (only in LoRa mode)
+ *
+ * @param size Number of bytes of the payload to read before the end of the
+ * frame, 0 to never call RxHeader
+ */
+void setRxHeaderSize(uint8_t size) {
+	SX1272.Settings.LoRa.RxHeaderSize = size;
+}
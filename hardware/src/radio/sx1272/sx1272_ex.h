@@ -24,6 +24,7 @@ void setPreambleLength(uint16_t preambleLen);
 void setTxTimeout(uint32_t timeout);
 void setRxContinuous(bool rxContinuous);
 void setRadioCallbacks( RadioEvents_t *events );
+void setRxHeaderSize(uint8_t size);
 
 
 #endif
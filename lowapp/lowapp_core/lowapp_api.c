@@ -93,6 +93,70 @@ uint8_t _encryptionKey[16];
 NODE_MODE_T _opMode = PULL;
 /** Connected flag */
 bool _connected = false;
+/**
+ * Wake-up mode flag
+ *
+ * When set, unicast messages are preceded by a train of short wake-up frames
+ * instead of a long preamble.
+ */
+bool _wakeupMode = false;
+/**
+ * Synchronised mode flag
+ *
+ * When set, nodes follow a group clock and only listen and transmit during
+ * periodic rendezvous slots.
+ */
+bool _syncMode = false;
+/**
+ * Link adaptation flag
+ *
+ * When set, unicast messages use a spreading factor and coding rate chosen per
+ * destination, and CAD scans all the candidate spreading factors.
+ */
+bool _linkAdaptMode = false;
+/**
+ * Transmit power control flag
+ *
+ * When set, the transmit power towards each destination is adapted from the
+ * link margin reported in its ACK.
+ */
+bool _powerCtrlMode = false;
+/**
+ * Reliable broadcast flag
+ *
+ * When set, broadcast messages are numbered per source, receivers report the
+ * missing ones with NACK and the source sends them again.
+ */
+bool _relBcastMode = false;
+/**
+ * Relay flag
+ *
+ * When set, unicast messages to the nodes out of range are sent through the
+ * next hop of their route, and the relayed messages received are forwarded.
+ */
+bool _relayMode = false;
+/**
+ * Flooding flag
+ *
+ * When set, broadcast messages are flooded over several hops, and the flooded
+ * messages received are rebroadcast unless enough copies were heard.
+ */
+bool _floodMode = false;
+/**
+ * Mailbox flag
+ *
+ * When set, the unicast messages which could not be delivered are parked until
+ * their destination is heard again.
+ */
+bool _mailboxMode = false;
+/**
+ * Cleartext hint flag
+ *
+ * When set, the standard and relayed messages are sent with their destination
+ * id and a hash of the group in clear after the header, so that the other
+ * nodes drop them without decoding them.
+ */
+bool _hintMode = false;
 
 /**
  * Preamble time in ms
@@ -218,8 +282,6 @@ LOWAPP_SYS_IF_T* _sys = NULL;
 extern QFIXED_T _atcmd_list;
 extern QEVENT_T _coldEventQ;
 
-extern uint8_t cad_flag;
-
 extern const uint8_t jsonPrefixError[];
 extern const uint8_t errorMsgMissingConfiguration[];
 
@@ -251,6 +313,7 @@ int8_t lowapp_init(LOWAPP_SYS_IF_T* sys_fns) {
 	/* Init timers */
 	_sys->SYS_initTimer(timeoutCB);
 	_sys->SYS_initTimer2(timeoutCB2);
+	_sys->SYS_initTimer3(timeoutCB3);
 	_sys->SYS_initRepetitiveTimer(cadTimeoutCB);
 
 	if(load_full_config() < 0 || !check_configuration()) { 	/* Get all config values from system */
@@ -282,7 +345,6 @@ int8_t lowapp_init(LOWAPP_SYS_IF_T* sys_fns) {
 		_connected = true;
 
 		/* Initialise CAD timer */
-		cad_flag = 0;
 		_sys->SYS_setRepetitiveTimer(_cad_interval);
 
 		_sys->SYS_cmdResponse((uint8_t*)"BOOT OK", 7);
@@ -315,7 +377,8 @@ uint8_t lowapp_process() {
  * @param cmdrequest AT command as a string, forwarded from the application or
  * from the UART driver
  * @param sizeCommand Size of the command (not counting end of char/line)
- * @retval -1 If the parameter was NULL
+ * @retval -1 If the parameter was NULL, or if the command could not be queued
+ * @retval #LOWAPP_ERR_ATSIZE If the command does not fit in #ATCMD_MAX_LEN bytes
  * @retval 0 If the command was added to the queue of AT commands to process
  */
 int8_t lowapp_atcmd(uint8_t* cmdrequest, uint16_t sizeCommand) {
@@ -323,33 +386,32 @@ int8_t lowapp_atcmd(uint8_t* cmdrequest, uint16_t sizeCommand) {
 		return LOWAPP_ERR_INVAL;
 	}
 	uint8_t* command = NULL;
+	if (sizeCommand >= ATCMD_MAX_LEN) {
+		LOG(LOG_ERR, "AT command too long");
+		return LOWAPP_ERR_ATSIZE;
+	}
 	/*
-	 * Copy cmdrequest to a hex buffer to avoid allocation issue with calling
-	 * application code
+	 * Copy cmdrequest to a buffer of the pool to avoid allocation issue with
+	 * calling application code
 	 */
-	command = (uint8_t*) calloc(sizeCommand+1, sizeof(uint8_t));
+	command = atbuf_alloc();
 	if (command == NULL) {
-		LOG(LOG_ERR, "Error allocating memory");
+		LOG(LOG_ERR, "AT command pool empty");
 		return -1;
 	}
 	memcpy(command, cmdrequest, sizeCommand);
-	lock_atcmd();
+	command[sizeCommand] = '\0';
 	/* Add AT command to the list */
 	if (add_to_queue(&_atcmd_list, command, sizeCommand) == -1) {
-		unlock_atcmd();
 		LOG(LOG_ERR, "The AT cmd queue was full");
 		/* Free command buffer */
-		free(command);
+		atbuf_free(command);
 		command = NULL;
 		return -1;
-	} else {
-		unlock_atcmd();
 	}
 
-	lock_coldEventQ();
 	/* Notify the core that an AT command has been received */
 	add_simple_event(&_coldEventQ, RXAT);
-	unlock_coldEventQ();
 
 	return 0;
 }
@@ -359,19 +421,13 @@ int8_t lowapp_atcmd(uint8_t* cmdrequest, uint16_t sizeCommand) {
  * an error occurred.
  */
 void lowapp_atcmderror() {
-	lock_atcmd();
 	/* Add AT command to the list */
 	if (add_to_queue(&_atcmd_list, NULL, 0) == -1) {
-		unlock_atcmd();
 		LOG(LOG_ERR, "The AT cmd queue was full");
-	} else {
-		unlock_atcmd();
 	}
 
-	lock_coldEventQ();
 	/* Notify the core that an AT command has been received */
 	add_simple_event(&_coldEventQ, RXAT);
-	unlock_coldEventQ();
 }
 
 /** @} */
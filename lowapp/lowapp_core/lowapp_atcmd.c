@@ -95,6 +95,8 @@ const uint8_t msgSelftest[]			= "AT+SELFTEST";
 /**
  * AT show statistics command
  *
+ * AT+STATS=RESET clears the statistics once reported.
+ *
  * @see cmd_getstats Corresponding execution function
  */
 const uint8_t msgStats[]			= "AT+STATS";
@@ -104,6 +106,15 @@ const uint8_t msgStats[]			= "AT+STATS";
  * @see cmd_who Corresponding execution function
  */
 const uint8_t msgWho[]				= "AT+WHO";
+/**
+ * AT queues command
+ *
+ * AT+QUEUES=RESET restarts the high-water marks and the drop counters once
+ * reported.
+ *
+ * @see cmd_queues Corresponding execution function
+ */
+const uint8_t msgQueues[]			= "AT+QUEUES";
 /**
  * AT PING command
  *
@@ -152,6 +163,77 @@ const uint8_t msgConnect[]			= "AT+CONNECT";
  * @see cmd_reset Corresponding execution function
  */
 const uint8_t msgReset[]			= "ATZ";
+/**
+ * AT set/get wake-up mode command
+ *
+ * @see cmd_wakeup Corresponding execution function
+ */
+const uint8_t msgWakeup[]			= "AT+WAKEUP";
+/**
+ * AT set/get synchronised mode command
+ *
+ * @see cmd_sync Corresponding execution function
+ */
+const uint8_t msgSync[]				= "AT+SYNC";
+/**
+ * AT set/get link adaptation mode command
+ *
+ * @see cmd_adapt Corresponding execution function
+ */
+const uint8_t msgAdapt[]			= "AT+ADAPT";
+/**
+ * AT set/get transmit power control mode command
+ *
+ * @see cmd_powerctrl Corresponding execution function
+ */
+const uint8_t msgPowerCtrl[]		= "AT+POWERCTRL";
+/**
+ * AT set/get reliable broadcast mode command
+ *
+ * @see cmd_relbcast Corresponding execution function
+ */
+const uint8_t msgRelBcast[]			= "AT+RELBCAST";
+/**
+ * AT set/get relay mode command
+ *
+ * @see cmd_relay Corresponding execution function
+ */
+const uint8_t msgRelay[]			= "AT+RELAY";
+/**
+ * AT set/get route command
+ *
+ * @see cmd_route Corresponding execution function
+ */
+const uint8_t msgRoute[]			= "AT+ROUTE";
+/**
+ * AT set/get flooding mode command
+ *
+ * @see cmd_flood Corresponding execution function
+ */
+const uint8_t msgFlood[]			= "AT+FLOOD";
+/**
+ * AT set/get mailbox mode command
+ *
+ * @see cmd_mailbox Corresponding execution function
+ */
+const uint8_t msgMailbox[]			= "AT+MAILBOX";
+/**
+ * AT set/get cleartext hint mode command
+ *
+ * @see cmd_hint Corresponding execution function
+ */
+const uint8_t msgHint[]				= "AT+HINT";
+
+#ifdef LOWAPP_SM_PROFILE
+/**
+ * AT state machine profile command
+ *
+ * AT+SMPROF=RESET clears the profile once reported.
+ *
+ * @see cmd_smprof Corresponding execution function
+ */
+const uint8_t msgSmprof[]			= "AT+SMPROF";
+#endif
 
 #ifdef SIMU
 /**
@@ -172,18 +254,15 @@ const uint8_t defaultDisplayString[] = "OK {\"chanId\":\"00\",\"txDatarate\":\"0
 /** Ping payload */
 const uint8_t pingPayload[] = "PING";
 
-extern Lowapp_RadioEvents_t radio_callbacks;
-extern MSG_RXDONE_T msgReceived;
-extern uint16_t timer_safeguard_rxing_ack;
-extern uint8_t radioFlags;
-
 extern QFIXED_T _atcmd_list;
 extern QEVENT_T _coldEventQ;
+extern QEVENT_T _eventQ;
+extern RING_T _rx_pkt_ring;
+extern QFIXED_T _tx_pkt_list[TXQ_PRIO_LEVELS];
 
 extern bool txBlocked;
-extern QFIXED_T _tx_pkt_list;
 
-extern QSTAT_T statisticsWho;
+extern CORE_STATS_T coreStats;
 
 extern PEER_T peers[256];
 
@@ -192,14 +271,23 @@ extern const uint32_t channelFrequencies[];
 extern uint8_t jsonPrefixOk[];
 extern uint8_t jsonSuffix[];
 extern uint8_t jsonKeyValDelimiter[];
+extern uint8_t jsonFieldDelimiter[];
 extern uint8_t jsonDelimiterErrorCodeString[];
 extern uint8_t errorMsgAtCmdInvalidSize[];
 extern uint8_t jsonPrefixError[];
+extern uint8_t jsonSendPriority[];
+extern uint8_t jsonSendCredits[];
+extern uint8_t jsonRoutes[];
 
 extern uint8_t jsonWhoPrefix[];
 extern uint8_t jsonWhoDevice[];
 extern uint8_t jsonWhoLastRssi[];
 extern uint8_t jsonWhoLastSeen[];
+extern uint8_t jsonWhoRssi[];
+extern uint8_t jsonWhoSnr[];
+extern uint8_t jsonWhoPrr[];
+extern uint8_t jsonWhoAck[];
+extern uint8_t jsonWhoCadPhase[];
 extern uint8_t jsonWhoSuffix[];
 
 /* Static functions prototypes */
@@ -209,16 +297,32 @@ static int8_t cmd_writecfg(uint8_t** err);
 static int8_t cmd_readcfg(uint8_t** err);
 static int8_t cmd_displaycfg(uint8_t** err);
 static int8_t cmd_selftest(uint8_t** err);
-static int8_t cmd_getstats(uint8_t** err);
+static int8_t cmd_getstats(uint8_t* p1, uint8_t** err);
+static int8_t cmd_queues(uint8_t* p1, uint8_t** err);
+#ifdef LOWAPP_SM_PROFILE
+static int8_t cmd_smprof(uint8_t* p1, uint8_t** err);
+#endif
 static int8_t cmd_who(uint8_t** err);
-static int8_t cmd_ping(uint8_t* p1, uint8_t** err);
+static int8_t cmd_ping(uint8_t* p1, uint8_t* p2, uint8_t** err);
 static int8_t cmd_hello(uint8_t** err);
 static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err);
+static void send_response(const char* status, uint8_t priority, uint8_t dest);
 static int8_t cmd_pollrx(uint8_t** err);
 static int8_t cmd_pushrx(uint8_t** err);
 static int8_t cmd_disconnect(uint8_t** err);
 static int8_t cmd_connect(uint8_t** err);
 static int8_t cmd_reset(uint8_t** err);
+static int8_t cmd_bool_mode(uint8_t* p1, bool* flag, const char* name, uint8_t** err);
+static int8_t cmd_wakeup(uint8_t* p1, uint8_t** err);
+static int8_t cmd_sync(uint8_t* p1, uint8_t** err);
+static int8_t cmd_adapt(uint8_t* p1, uint8_t** err);
+static int8_t cmd_powerctrl(uint8_t* p1, uint8_t** err);
+static int8_t cmd_relbcast(uint8_t* p1, uint8_t** err);
+static int8_t cmd_relay(uint8_t* p1, uint8_t** err);
+static int8_t cmd_route(uint8_t* p1, uint8_t* p2, uint8_t** err);
+static int8_t cmd_flood(uint8_t* p1, uint8_t** err);
+static int8_t cmd_mailbox(uint8_t* p1, uint8_t** err);
+static int8_t cmd_hint(uint8_t* p1, uint8_t** err);
 static int8_t at_cmd_process(uint8_t* cmdrequest);
 static int8_t at_cmd_interp(uint8_t* cmd, uint8_t* p1, uint8_t* p2, uint8_t** err);
 static bool eat_ws(uint8_t** lp);
@@ -343,9 +447,13 @@ int8_t load_full_config() {
 		_cad_interval = preamble_symbols_to_timems(_preambleLen-10);
 		/* Update safeguard timers */
 		update_safeguard_timers();
+		/* Update preamble of each candidate SF for link adaptation */
+		link_update_radio();
+		/* Update sync preamble and CAD interval */
+		sync_update_radio();
 		/* Update CAD timer if the timer is currently running */
 		if(_connected) {
-			_sys->SYS_setRepetitiveTimer(_cad_interval);
+			_sys->SYS_setRepetitiveTimer(sync_next_cad_delay());
 		}
 	}
 
@@ -613,64 +721,314 @@ static int8_t cmd_selftest(uint8_t** err) {
 
 /**
  * @brief Retrieve statistics
+ *
+ * Reports the protocol counters, then the histograms of the time from the
+ * start of a transmission to its ACK and of the time spent in the TX queue.
+ * Each histogram is a list of #STATS_HIST_BUCKETS counts: the first bucket is
+ * under #STATS_HIST_BASE ms, each following bucket doubles the bound, and the
+ * last one has no bound. The usage of the object pools follows, as
+ * "used,hwm,fails" for each pool.
+ *
+ * @param[in] p1 "RESET" to clear the statistics once reported, NULL otherwise
  * @param[out] err Error buffer
- * @retval 0
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the parameter is not valid
+ * @retval #LOWAPP_ERR_NOMEM If the response could not be allocated
  * @see #msgStats AT command string
  */
-static int8_t cmd_getstats(uint8_t** err) {
+static int8_t cmd_getstats(uint8_t* p1, uint8_t** err) {
 	/* Back to pull mode */
 	_opMode = PULL;
-	// TODO
-	_sys->SYS_cmdResponse((uint8_t*)"OK GETSTATS", 11);
+	const char* names[] = { "txFrames", "rxFrames", "lbtBusy", "txTimeout", "ackOk", "ackNok",
+			"ackMissing", "crcError", "notForMe", "duplicate", "missingFrames", "queueFull",
+			"txExpired", "txCoalesced" };
+	uint16_t values[] = { coreStats.txFrames, coreStats.rxFrames, coreStats.lbtBusy,
+			coreStats.txTimeout, coreStats.ackOk, coreStats.ackNok, coreStats.ackMissing,
+			coreStats.crcError, coreStats.notForMe, coreStats.duplicate, coreStats.missingFrames,
+			coreStats.queueFull, coreStats.txExpired, coreStats.txCoalesced };
+	const char* histNames[] = { "ackLatency", "queueDelay" };
+	uint16_t* hists[] = { coreStats.ackLatency, coreStats.queueDelay };
+	uint8_t* buffer;
+	uint16_t sizeStr = 0;
+	uint16_t offset = 0;
+	uint8_t i, j;
+	if(p1 != NULL && strcmp((char*)p1, "RESET") != 0) {
+		*err = (uint8_t*)"invalid param";
+		return LOWAPP_ERR_INVAL;
+	}
+	/* Room for the longest values of all the counters and buckets */
+	buffer = calloc(640, sizeof(uint8_t));
+	if(buffer == NULL) {
+		*err = (uint8_t*)"Not enough memory";
+		return LOWAPP_ERR_NOMEM;
+	}
+	/* Build the JSON message */
+	sizeStr = strlen((char*)jsonPrefixOk);
+	memcpy(buffer+offset, jsonPrefixOk, sizeStr);
+	offset += sizeStr;
+	for(i = 0; i < sizeof(values)/sizeof(values[0]); ++i) {
+		if(i > 0) {
+			sizeStr = strlen((char*)jsonFieldDelimiter);
+			memcpy(buffer+offset, jsonFieldDelimiter, sizeStr);
+			offset += sizeStr;
+		}
+		sizeStr = strlen(names[i]);
+		memcpy(buffer+offset, names[i], sizeStr);
+		offset += sizeStr;
+		sizeStr = strlen((char*)jsonKeyValDelimiter);
+		memcpy(buffer+offset, jsonKeyValDelimiter, sizeStr);
+		offset += sizeStr;
+		/* The offsets of the fill functions are 8 bits, write from the field */
+		offset += FillBuffer16_t(buffer+offset, 0, &values[i], 1, false);
+	}
+	/* Histograms, as comma separated counts */
+	for(i = 0; i < sizeof(hists)/sizeof(hists[0]); ++i) {
+		sizeStr = strlen((char*)jsonFieldDelimiter);
+		memcpy(buffer+offset, jsonFieldDelimiter, sizeStr);
+		offset += sizeStr;
+		sizeStr = strlen(histNames[i]);
+		memcpy(buffer+offset, histNames[i], sizeStr);
+		offset += sizeStr;
+		sizeStr = strlen((char*)jsonKeyValDelimiter);
+		memcpy(buffer+offset, jsonKeyValDelimiter, sizeStr);
+		offset += sizeStr;
+		for(j = 0; j < STATS_HIST_BUCKETS; ++j) {
+			if(j > 0) {
+				buffer[offset++] = ',';
+			}
+			offset += FillBuffer16_t(buffer+offset, 0, &hists[i][j], 1, false);
+		}
+	}
+	offset += pools_fill_stats(buffer+offset);
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(buffer+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(buffer, offset);
+	free(buffer);
+	buffer = NULL;
+	if(p1 != NULL) {
+		memset(&coreStats, 0, sizeof(coreStats));
+		pools_clear_stats();
+	}
 	return 0;
 }
 
+#ifdef LOWAPP_SM_PROFILE
 /**
- * @brief Get list of recently seen group members with their RSSIs
+ * @brief Retrieve the time spent in each state of the state machine
+ *
+ * @param[in] p1 "RESET" to clear the profile once reported, NULL otherwise
  * @param[out] err Error buffer
- * @retval 0
- * @see #msgWho AT command string
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the parameter is not valid
+ * @see #msgSmprof AT command string
  */
-static int8_t cmd_who(uint8_t** err) {
+static int8_t cmd_smprof(uint8_t* p1, uint8_t** err) {
 	/* Back to pull mode */
 	_opMode = PULL;
-	uint16_t sizeStr, offset = 0;
-	uint8_t *buffer;
-	/* Allocate buffer to display all 16 stat elements */
-	buffer = calloc(18+statisticsWho.count*62, sizeof(uint8_t));
-	sizeStr = strlen((char*)jsonWhoPrefix);
-	memcpy(buffer, jsonWhoPrefix, sizeStr);
-	offset += sizeStr;
+	if(p1 != NULL && strcmp((char*)p1, "RESET") != 0) {
+		*err = (uint8_t*)"invalid param";
+		return LOWAPP_ERR_INVAL;
+	}
+	smprof_report();
+	if(p1 != NULL) {
+		smprof_reset();
+	}
+	return 0;
+}
+#endif
 
+/**
+ * @brief Retrieve the depth of the queues of the core
+ *
+ * Reports, for each TX priority level, the RX queue, the AT command queue and
+ * the two event queues, the current number of elements, the highest number
+ * reached and the number of elements refused because the queue was full, as
+ * "depth,hwm,drops". The bytes used in the RX queue, their highest number and
+ * the capacity of the RX queue follow, as "rxBytes":"used,hwm,size".
+ *
+ * @param[in] p1 "RESET" to restart the high-water marks and the drop counters
+ * once reported, NULL otherwise
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the parameter is not valid
+ * @see #msgQueues AT command string
+ */
+static int8_t cmd_queues(uint8_t* p1, uint8_t** err) {
+	/* Back to pull mode */
+	_opMode = PULL;
+	const char* names[] = { "rx", "atcmd", "event", "cold" };
+	uint16_t depths[TXQ_PRIO_LEVELS+4], hwms[TXQ_PRIO_LEVELS+4];
+	uint16_t drops[TXQ_PRIO_LEVELS+4];
+	uint16_t rxBytes[3];
+	uint8_t buffer[300] = "";
+	uint8_t sizeStr = 0;
+	uint16_t offset = 0;
 	uint8_t i;
-	/* Loop over all elements in the stat queue */
-	for(i = 0; i < statisticsWho.count; i++) {
-		/* Add device id */
-		sizeStr = strlen((char*)jsonWhoDevice);
-		memcpy(buffer+offset, jsonWhoDevice, sizeStr);
-		offset += sizeStr;
-		offset = FillBuffer8_t(buffer, offset, &(statisticsWho.els[i].deviceId), 1, false);
-		/* Add last rssi */
-		sizeStr = strlen((char*)jsonWhoLastRssi);
-		memcpy(buffer+offset, jsonWhoLastRssi, sizeStr);
-		offset += sizeStr;
-		offset = FillBuffer8_t(buffer, offset, (uint8_t*)&(statisticsWho.els[i].lastRssi), 1, false);
-		/* Add last seen */
-		sizeStr = strlen((char*)jsonWhoLastSeen);
-		memcpy(buffer+offset, jsonWhoLastSeen, sizeStr);
+	if(p1 != NULL && strcmp((char*)p1, "RESET") != 0) {
+		*err = (uint8_t*)"invalid param";
+		return LOWAPP_ERR_INVAL;
+	}
+	/* Snapshot of the queues, TX priority levels first */
+	for(i = 0; i < TXQ_PRIO_LEVELS; ++i) {
+		depths[i] = queue_size(&_tx_pkt_list[i]);
+		hwms[i] = _tx_pkt_list[i].hwm;
+		drops[i] = _tx_pkt_list[i].drops;
+	}
+	depths[i] = ring_count(&_rx_pkt_ring);
+	hwms[i] = _rx_pkt_ring.hwm;
+	drops[i++] = _rx_pkt_ring.drops;
+	rxBytes[0] = _rx_pkt_ring.used;
+	rxBytes[1] = _rx_pkt_ring.hwmBytes;
+	rxBytes[2] = _rx_pkt_ring.size;
+	depths[i] = queue_size(&_atcmd_list);
+	hwms[i] = _atcmd_list.hwm;
+	drops[i++] = _atcmd_list.drops;
+	depths[i] = event_size(&_eventQ);
+	hwms[i] = _eventQ.hwm;
+	drops[i++] = _eventQ.drops;
+	depths[i] = event_size(&_coldEventQ);
+	hwms[i] = _coldEventQ.hwm;
+	drops[i++] = _coldEventQ.drops;
+
+	/* Build the JSON message */
+	sizeStr = strlen((char*)jsonPrefixOk);
+	memcpy(buffer+offset, jsonPrefixOk, sizeStr);
+	offset += sizeStr;
+	for(i = 0; i < TXQ_PRIO_LEVELS+4; ++i) {
+		if(i > 0) {
+			sizeStr = strlen((char*)jsonFieldDelimiter);
+			memcpy(buffer+offset, jsonFieldDelimiter, sizeStr);
+			offset += sizeStr;
+		}
+		if(i < TXQ_PRIO_LEVELS) {
+			buffer[offset++] = 't';
+			buffer[offset++] = 'x';
+			buffer[offset++] = '0' + i;
+		}
+		else {
+			sizeStr = strlen(names[i-TXQ_PRIO_LEVELS]);
+			memcpy(buffer+offset, names[i-TXQ_PRIO_LEVELS], sizeStr);
+			offset += sizeStr;
+		}
+		sizeStr = strlen((char*)jsonKeyValDelimiter);
+		memcpy(buffer+offset, jsonKeyValDelimiter, sizeStr);
 		offset += sizeStr;
-		offset = FillBufferHexBI8_t(buffer, offset, (uint8_t*)(&(statisticsWho.els[i].lastSeen)),
-				8, false);
-		buffer[offset++] = '\"';
+		offset += FillBuffer16_t(buffer+offset, 0, &depths[i], 1, false);
+		buffer[offset++] = ',';
+		offset += FillBuffer16_t(buffer+offset, 0, &hwms[i], 1, false);
+		buffer[offset++] = ',';
+		offset += FillBuffer16_t(buffer+offset, 0, &drops[i], 1, false);
+	}
+	sizeStr = strlen((char*)jsonFieldDelimiter);
+	memcpy(buffer+offset, jsonFieldDelimiter, sizeStr);
+	offset += sizeStr;
+	memcpy(buffer+offset, "rxBytes", 7);
+	offset += 7;
+	sizeStr = strlen((char*)jsonKeyValDelimiter);
+	memcpy(buffer+offset, jsonKeyValDelimiter, sizeStr);
+	offset += sizeStr;
+	for(i = 0; i < 3; ++i) {
+		if(i > 0) {
+			buffer[offset++] = ',';
+		}
+		offset += FillBuffer16_t(buffer+offset, 0, &rxBytes[i], 1, false);
+	}
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(buffer+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(buffer, offset);
+
+	if(p1 != NULL) {
+		for(i = 0; i < TXQ_PRIO_LEVELS; ++i) {
+			queue_clear_stats(&_tx_pkt_list[i]);
+		}
+		ring_clear_stats(&_rx_pkt_ring);
+		queue_clear_stats(&_atcmd_list);
+		event_clear_stats(&_eventQ);
+		event_clear_stats(&_coldEventQ);
+	}
+	return 0;
+}
+
+/**
+ * Append a string to a response
+ *
+ * @param buffer Response buffer
+ * @param offset Offset in the buffer
+ * @param str String to append
+ * @return The new offset in the buffer
+ */
+static uint16_t who_append(uint8_t* buffer, uint16_t offset, const uint8_t* str) {
+	uint16_t sizeStr = strlen((char*)str);
+	memcpy(buffer+offset, str, sizeStr);
+	return offset + sizeStr;
+}
+
+/**
+ * @brief Get list of recently seen group members with their link quality
+ *
+ * Lists the content of the neighbour table: last RSSI and time seen, average
+ * RSSI and SNR, packet reception ratio and ACK success rate (in %), and the
+ * last CAD phase reported to AT+HELLO.
+ *
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_NOMEM If the response could not be allocated
+ * @see #msgWho AT command string
+ */
+static int8_t cmd_who(uint8_t** err) {
+	/* Back to pull mode */
+	_opMode = PULL;
+	uint16_t offset = 0;
+	uint16_t i;
+	uint8_t *buffer;
+	NEIGH_T* entry;
+	uint8_t value;
+	/* Allocate buffer to display all the neighbours, with their longest values */
+	buffer = calloc(18+neigh_count()*128, sizeof(uint8_t));
+	if(buffer == NULL) {
+		*err = (uint8_t*)"Not enough memory";
+		return LOWAPP_ERR_NOMEM;
+	}
+	offset = who_append(buffer, offset, jsonWhoPrefix);
+
+	/* Loop over all the neighbours of the table */
+	for(i = 0; i < NEIGH_TABLE_SIZE; i++) {
+		entry = neigh_at(i);
+		if(entry == NULL) {
+			continue;
+		}
+		/* The offsets of the fill functions are 8 bits, write from the field */
+		offset = who_append(buffer, offset, jsonWhoDevice);
+		offset += FillBuffer8_t(buffer+offset, 0, &entry->deviceId, 1, false);
+		offset = who_append(buffer, offset, jsonWhoLastRssi);
+		offset += FillBufferS16_t(buffer+offset, 0, entry->lastRssi, false);
+		offset = who_append(buffer, offset, jsonWhoLastSeen);
+		offset += FillBufferHexBI8_t(buffer+offset, 0, (uint8_t*)&entry->lastSeen, 8, false);
+		offset = who_append(buffer, offset, jsonWhoRssi);
+		offset += FillBufferS16_t(buffer+offset, 0, entry->rssiAvg/16, false);
+		offset = who_append(buffer, offset, jsonWhoSnr);
+		offset += FillBufferS16_t(buffer+offset, 0, entry->snrAvg/16, false);
+		offset = who_append(buffer, offset, jsonWhoPrr);
+		value = (entry->prr*100 + 127)/255;
+		offset += FillBuffer8_t(buffer+offset, 0, &value, 1, false);
+		if(entry->ackKnown) {
+			offset = who_append(buffer, offset, jsonWhoAck);
+			value = (entry->ackRate*100 + 127)/255;
+			offset += FillBuffer8_t(buffer+offset, 0, &value, 1, false);
+		}
+		if(entry->cadKnown) {
+			offset = who_append(buffer, offset, jsonWhoCadPhase);
+			offset += FillBuffer8_t(buffer+offset, 0, &entry->cadPhase, 1, false);
+		}
 		buffer[offset++] = '}';
 		buffer[offset++] = ',';
 	}
-	if(statisticsWho.count > 0) {
+	if(neigh_count() > 0) {
 		offset--;
 	}
-	sizeStr = strlen((char*)jsonWhoSuffix);
-	memcpy(buffer+offset, jsonWhoSuffix, sizeStr);
-	offset += sizeStr;
+	offset = who_append(buffer, offset, jsonWhoSuffix);
 	_sys->SYS_cmdResponse(buffer, offset);
 	free(buffer);
 	buffer = NULL;
@@ -678,166 +1036,213 @@ static int8_t cmd_who(uint8_t** err) {
 }
 
 /**
- * @brief Send a ping packet and wait for acknowledge
+ * @brief Send pings to a device and measure their round-trip time
+ *
+ * The pings go through the TX queue like any other message, the node keeps
+ * receiving during the test. Each ping and the final statistics are reported
+ * asynchronously.
  *
- * @param[in] p1 Device id to which the ping should be sent
+ * @param[in] p1 Device id to which the pings should be sent
+ * @param[in] p2 Number of pings, optionally followed by the interval between
+ * two pings in ms ("count" or "count,interval"), NULL for a single ping
  * @param[out] err Error buffer
  * @retval 0 On Success
- * @retval #LOWAPP_ERR_INVAL If the p1 parameter was missing
+ * @retval #LOWAPP_ERR_INVAL If the p1 parameter was missing, or if the count or
+ * the interval is not valid
+ * @retval #LOWAPP_ERR_DESTID If the destination id is not valid
+ * @retval #LOWAPP_ERR_DISCONNECT If the device is disconnected
  * @see #msgPing AT command string
  */
-static int8_t cmd_ping(uint8_t* p1, uint8_t** err) {
-	if (p1!=NULL) {
-		uint8_t buffer[128] = "";
-		MSG_T msgPing;
-		MSG_T ackPing;
-		uint8_t bufferLength = 0;
-		uint8_t destination;
-		uint8_t received;
-		/* Back to pull mode */
-		_opMode = PULL;
-		/* New set of callbacks to pause the state machine */
-		Lowapp_RadioEvents_t pingEvents;
-		pingEvents.CadDone = NULL;
-		pingEvents.RxDone = noSmRxDone;
-		pingEvents.RxError = noSmRxError;
-		pingEvents.RxTimeout = noSmRxTimeout;
-		pingEvents.TxDone = noSmTxDone;
-		pingEvents.TxTimeout = noSmRxTimeout;
-		_sys->SYS_radioSetCallbacks(&pingEvents);
-		/* Clear radio callbacks flags */
-		radioFlags = 0;
-
-		/* Retrieve destination id */
-		AsciiHexConversionOneValueBI8_t(&destination, p1);
-		/* Check the destination id */
-		if(destination == 0x00) {
-			/* Bring back standard radio callbacks */
-			_sys->SYS_radioSetCallbacks(&radio_callbacks);
-			*err=(uint8_t*)"Gateway functionality not implemented";
-			return LOWAPP_ERR_NOTIMPL;
-		}
-		if(!(destination >= MIN_DEVICE_ID && destination <= MAX_DEVICE_ID)) {
-			/* Bring back standard radio callbacks */
-			_sys->SYS_radioSetCallbacks(&radio_callbacks);
-			*err=(uint8_t*)"Invalid destination id";
-			return LOWAPP_ERR_DESTID;
-		}
-		/* Build PING message */
-		msgPing.hdr.type = TYPE_STDMSG;
-		msgPing.hdr.version = LOWAPP_CURRENT_VERSION;
-		msgPing.hdr.payloadLength = strlen((char*)pingPayload);
-		msgPing.content.std.destId = destination;
-		msgPing.content.std.srcId = _deviceId;
-		msgPing.content.std.txSeq = 0;
-		msgPing.content.std.txSeq = peers[msgPing.content.std.destId].out_txseq;
-
-		memcpy(msgPing.content.std.payload, pingPayload, msgPing.hdr.payloadLength);
-		/* Fill frame and set flag */
-		bufferLength = buildFrame(buffer, &msgPing);
-		/* Send the ping */
-		_sys->SYS_cmdResponse((uint8_t*)"SEND PING", 9);
-		_sys->SYS_radioTx(buffer, bufferLength);
-		LOG(LOG_PARSER, "Trying to send (tryTx)");	/* Used by log parser */
-		/* Wait for tx done */
-		while(radioFlags == 0) { };
-		if(radioFlags & RADIOFLAGS_TXDONE) {
-			radioFlags = 0;
-			/* Increment sequence number when tx done*/
-			peers[destination].out_txseq =
-				(peers[destination].out_txseq % 255) + 1;
-			/* Set RX configuration for ACK */
-			_sys->SYS_radioSetRxFixLen(true, ACK_FRAME_LENGTH);
-			_sys->SYS_radioSetPreamble(PREAMBLE_ACK);
-			_sys->SYS_radioSetRxContinuous(true);
-			/* Wait for the ACK slot */
-			_sys->SYS_delayMs(TIMER_ACK_SLOT_START);
-			/* Start radio reception */
-#ifdef SIMU
-			/*
-			 * Issues were noticed wit inotify using small timeouts of a few
-			 * milliseconds on a standard Linux OS. This functions has been
-			 * developed to counter these effects by taking care of the whole
-			 * reception process at once.
-			 */
-			simu_radio_rxing_ack(timer_safeguard_rxing_ack);
-#else
-			/* Direclty start radio reception */
-			_sys->SYS_radioRx(timer_safeguard_rxing_ack);
-#endif
-
-			while(radioFlags == 0) {}
-			if(radioFlags & RADIOFLAGS_RXDONE) {
-				radioFlags = 0;
-				/* Build MSG_T from message frame */
-				received = retrieveMessage(&ackPing, msgReceived.data);
-				/* Check destination is this node */
-				if (received == 0) {
-					process_ack(&ackPing);
-				}
-				else {
-					/* Fail if the message was not received correctly */
-					_sys->SYS_cmdResponse((uint8_t*)"NOK TX", 6);
-				}
-			}
-			else {
-				/* Fail if no reception occurred */
-				_sys->SYS_cmdResponse((uint8_t*)"NOK TX", 6);
-			}
-		}
-		else {
-			/* Fail if transmission failed */
-			_sys->SYS_cmdResponse((uint8_t*)"NOK TX", 6);
-		}
-
-		/* Set RX configuration back to standard */
-		_sys->SYS_radioSetRxFixLen(false, 0);
-		_sys->SYS_radioSetPreamble(_preambleLen);
-		_sys->SYS_radioSetRxContinuous(true);
-
-		/* Bring back standard radio callbacks */
-		_sys->SYS_radioSetCallbacks(&radio_callbacks);
-		return 0;	// Ok
-	} else {
+static int8_t cmd_ping(uint8_t* p1, uint8_t* p2, uint8_t** err) {
+	uint8_t destination;
+	uint32_t count = 1;
+	uint32_t interval = PING_INTERVAL;
+	uint8_t* p3 = NULL;
+	char* end;
+	/* Back to pull mode */
+	_opMode = PULL;
+	if (p1 == NULL) {
 		// lacking params
 		*err=(uint8_t*)"missing param";
 		return LOWAPP_ERR_INVAL;
 	}
+	/* Retrieve destination id */
+	AsciiHexConversionOneValueBI8_t(&destination, p1);
+	/* Check the destination id */
+	if(destination == 0x00) {
+		*err=(uint8_t*)"Gateway functionality not implemented";
+		return LOWAPP_ERR_NOTIMPL;
+	}
+	if(!(destination >= MIN_DEVICE_ID && destination <= MAX_DEVICE_ID)) {
+		*err=(uint8_t*)"Invalid destination id";
+		return LOWAPP_ERR_DESTID;
+	}
+	/* Retrieve count and interval */
+	if(p2 != NULL) {
+		p3 = (uint8_t*) strchr((char*)p2, ',');
+		if(p3 != NULL) {
+			*p3 = '\0';
+			p3++;
+			/* Parsed on 32 bits, so that a value too big does not wrap */
+			interval = strtoul((char*)p3, &end, 10);
+			if(*p3 < '0' || *p3 > '9' || *end != '\0' || interval > PING_MAX_INTERVAL) {
+				*err=(uint8_t*)"Invalid ping interval";
+				return LOWAPP_ERR_INVAL;
+			}
+		}
+		count = strtoul((char*)p2, &end, 10);
+		if(*p2 < '0' || *p2 > '9' || *end != '\0' || count == 0 || count > PING_MAX_COUNT) {
+			*err=(uint8_t*)"Invalid ping count";
+			return LOWAPP_ERR_INVAL;
+		}
+	}
+	/* Do not allow ping when disconnected */
+	if(!_connected) {
+		*err=(uint8_t*)"NOK TX (DISCONNECTED)";
+		return LOWAPP_ERR_DISCONNECT;
+	}
+	/* The first ping is queued by the state machine when back to idle */
+	ping_start(destination, (uint8_t)count, (uint16_t)interval);
+	_sys->SYS_cmdResponse((uint8_t*)"OK PING", 7);
+	return 0;
 }
 
 /**
- * @brief Send a hello packet
+ * @brief Discover the neighbours in radio range
+ *
+ * A discovery request is broadcast, and each neighbour answers in a random
+ * reply slot. The neighbours which replied are added to the AT+WHO list and
+ * reported with HELLO {"count":"n","nodes":"id:rssi:rssiSeen:phase,..."} once
+ * the reply slots are over.
+ *
  * @param[out] err Error buffer
- * @retval 0
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_DISCONNECT If the device is disconnected
+ * @retval #LOWAPP_ERR_QFULL If the TX queue is full
  * @see #msgHello AT command string
  */
 static int8_t cmd_hello(uint8_t** err) {
 	/* Back to pull mode */
 	_opMode = PULL;
-	// TODO
+	MSG_T* msg;
+	/* Do not allow discovery when disconnected */
+	if(!_connected) {
+		*err=(uint8_t*)"NOK TX (DISCONNECTED)";
+		return LOWAPP_ERR_DISCONNECT;
+	}
+	msg = hello_build_request();
+	if(msg == NULL) {
+		*err=(uint8_t*)"NOK TX (NO MEMORY)";
+		return LOWAPP_ERR_NOMEM;
+	}
+	/* The request is freed by lowapp_tx if the queue is full */
+	if(lowapp_tx(msg) == -1) {
+		*err=(uint8_t*)"NOK TX (QUEUE FULL)";
+		return LOWAPP_ERR_QFULL;
+	}
 	_sys->SYS_cmdResponse((uint8_t*)"OK HELLO", 8);
+	if(!txBlocked) {
+		/* Notify the state machine that a message is waiting to be processed */
+		add_simple_event(&_coldEventQ, TXREQ);
+	}
 	return 0;
 }
 
 /**
  * @brief Send data to a given device
  *
- * @param[in] p1 Device id of the receiver
+ * The device id of the receiver can be followed by the priority of the message
+ * (e.g. AT+SEND=05:2,data). Priority 2 messages are sent before all the others,
+ * priority 0 messages after all the others. The default priority is 1.
+ *
+ * A time to live in seconds can follow the priority (e.g. AT+SEND=05:1:30,data
+ * or AT+SEND=05::30,data). A message which could not be sent within its time to
+ * live is dropped and NOK TX EXPIRED is sent to the application.
+ *
+ * A coalescing key can follow the time to live (e.g. AT+SEND=05:::7,data). A
+ * message to the same destination with the same key which is still waiting in
+ * the TX queue is replaced by the new one, and SEND REPLACED is answered.
+ * Keys up to #TXQ_KEY_RESERVED are used by the stack itself and refused.
+ *
+ * Up to #MCAST_MAX_DEST receivers can be given, separated by '+' (e.g.
+ * AT+SEND=05+07+09,data). The message is then sent once, each receiver sends
+ * its ACK in its own slot, and the delivery is reported per receiver, e.g.
+ * NOK TX {"acked":"05,09","missing":"07","retry":"1"}. The message is sent
+ * again to the missing receivers only.
+ *
+ * The answer gives the priority of the message and the number of messages
+ * which can still be queued with the same priority and destination, e.g.
+ * SEND REQUEST {"priority":"1","credits":"3"}.
+ *
+ * @param[in] p1 Device id of the receiver (or receivers), optionally followed by ':' and the
+ * priority (0 to 2), then by ':' and the time to live (1 to 9999 s), then by
+ * ':' and the coalescing key (1 to 255)
  * @param[in] p2 Data to send
  * @param[out] err Error buffer
  * @retval 0 If the data was sent
  * @retval #LOWAPP_ERR_PAYLOAD If the payload was too big for transmission
- * @retval #LOWAPP_ERR_INVAL If a parameter was missing
+ * @retval #LOWAPP_ERR_INVAL If a parameter was missing or if the priority or
+ * time to live was invalid
  * @see #msgSend AT command string
  */
 static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 	MSG_T* msg;
+	uint8_t priority = TXQ_PRIO_NORMAL;
 #ifdef LOWAPP_MSG_FORMAT_CLASSIC
 	if (p1!=NULL && p2!=NULL) {
 		int size = 0;
 		uint8_t destination;
-		/* Retrieve destination id */
-		AsciiHexConversionOneValueBI8_t(&destination, p1);
+		uint8_t ids[MCAST_MAX_DEST];
+		uint8_t nDest = 0;
+		uint8_t maxSize = MAX_PAYLOAD_STD_SIZE-1;
+		uint16_t ttl = 0;
+		uint16_t key = 0;
+		uint8_t len;
+		char* opt;
+		/* Retrieve destination ids, separated by '+' */
+		opt = (char*)p1;
+		do {
+			if(nDest == MCAST_MAX_DEST) {
+				*err=(uint8_t*)"Too many destinations";
+				return LOWAPP_ERR_DESTID;
+			}
+			AsciiHexConversionOneValueBI8_t(&ids[nDest++], (uint8_t*)opt);
+			opt += strcspn(opt, "+:");
+		} while(*opt++ == '+');
+		destination = ids[0];
+
+		/* Retrieve priority, time to live and coalescing key */
+		opt = strchr((char*)p1, ':');
+		if(opt != NULL) {
+			opt++;
+			if(*opt != ':' && *opt != '\0') {
+				if(*opt < '0' || *opt >= '0'+TXQ_PRIO_LEVELS || (opt[1] != ':' && opt[1] != '\0')) {
+					*err=(uint8_t*)"Invalid priority";
+					return LOWAPP_ERR_INVAL;
+				}
+				priority = *opt - '0';
+				opt++;
+			}
+			if(*opt == ':') {
+				opt++;
+				len = strcspn(opt, ":");
+				if(len > 0) {
+					if(len > 4 || (ttl = AsciiDecStringConversion_t((uint8_t*)opt, len)) == 0) {
+						*err=(uint8_t*)"Invalid time to live";
+						return LOWAPP_ERR_INVAL;
+					}
+					opt += len;
+				}
+			}
+			if(*opt == ':') {
+				opt++;
+				len = strlen(opt);
+				if(len == 0 || len > 3 || (key = AsciiDecStringConversion_t((uint8_t*)opt, len)) <= TXQ_KEY_RESERVED || key > 255) {
+					*err=(uint8_t*)"Invalid coalescing key";
+					return LOWAPP_ERR_INVAL;
+				}
+			}
+		}
 
 		/* Do not allow send request when disconnected */
 		if(!_connected) {
@@ -855,26 +1260,51 @@ static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 			*err=(uint8_t*)"Invalid destination id";
 			return LOWAPP_ERR_DESTID;
 		}
+		/* Multicast destinations must all be group members */
+		if(nDest > 1) {
+			for(len = 0; len < nDest; ++len) {
+				if(ids[len] < MIN_DEVICE_ID || ids[len] > MAX_DEVICE_ID) {
+					*err=(uint8_t*)"Invalid destination id";
+					return LOWAPP_ERR_DESTID;
+				}
+			}
+			/* The destination list is sent at the head of the payload */
+			maxSize -= 1+nDest;
+		}
 
 		/* Get size of data (loop until '\0') */
-		while(size < MAX_PAYLOAD_STD_SIZE-1 && p2[size] != '\0') {
+		while(size < maxSize && p2[size] != '\0') {
 			size++;
 		}
 		/* Check payload size is valid */
-		if(size == MAX_PAYLOAD_STD_SIZE-1 && p2[size] != '\0') {
+		if(size == maxSize && p2[size] != '\0') {
 			*err=(uint8_t*)"Payload too big for transmission";
 			return LOWAPP_ERR_PAYLOAD;
 		}
 
 		/* Build a message with the corresponding destination and data */
-		msg = (MSG_T*) malloc(sizeof(MSG_T));
+		msg = msg_alloc();
+		if(msg == NULL) {
+			*err=(uint8_t*)"NOK TX (NO MEMORY)";
+			return LOWAPP_ERR_NOMEM;
+		}
 		msg->hdr.type = TYPE_STDMSG;
 		msg->hdr.version = LOWAPP_CURRENT_VERSION;
 		msg->hdr.payloadLength = size;
 		msg->content.std.destId = destination;
 		msg->content.std.srcId = _deviceId;
 		msg->content.std.txSeq = 0;	// #TODO Sequence number
+		msg->priority = priority;
+		msg->deadline = 0;
+		if(ttl != 0) {
+			msg->deadline = (uint32_t)(_sys->SYS_getTimeMs() + (uint32_t)ttl*1000) | 1;
+		}
+		msg->key = key;
+		msg->retry = 0;
 		memcpy(msg->content.std.payload, p2, msg->hdr.payloadLength);
+		if(nDest > 1) {
+			mcast_fill(msg, ids, nDest, p2, size);
+		}
 	} else {
 		/* Missing params */
 		*err=(uint8_t*)"missing params";
@@ -887,6 +1317,8 @@ static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 	 * 	B0: 45
 	 * 	B1 : Message type:
 	 * 		01 : Unicast or broadcast message
+	 * 		02 : Position update, replacing any position update to the same
+	 * 		destination still waiting in the TX queue
 	 * 	B2-B6 : GPS latitude
 	 * 	B7-B10 : GPS longitude
 	 * 	B11 : Destination id, 0xFF for broadcast
@@ -895,7 +1327,7 @@ static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 	 */
 
 	/* Check the prefix of the GPS APP message */
-	if(*p1 == 0x45 && *(p1+1) == 0x01) {
+	if(*p1 == 0x45 && (*(p1+1) == 0x01 || *(p1+1) == 0x02)) {
 		uint8_t offset = 2;
 		uint8_t offsetPayload = 0;
 
@@ -907,7 +1339,11 @@ static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 		}
 
 		/* Build a message with the corresponding destination and data */
-		msg = (MSG_T*) malloc(sizeof(MSG_T));
+		msg = msg_alloc();
+		if(msg == NULL) {
+			*err=(uint8_t*)"NOK TX (NO MEMORY)";
+			return LOWAPP_ERR_NOMEM;
+		}
 		msg->hdr.type = TYPE_STDMSG;
 		msg->hdr.version = LOWAPP_CURRENT_VERSION;
 		offset = 2;
@@ -934,6 +1370,10 @@ static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 		}
 		msg->content.std.srcId = _deviceId;
 		msg->content.std.txSeq = 0;	// #TODO Sequence number
+		msg->priority = priority;
+		msg->deadline = 0;
+		msg->key = (*(p1+1) == 0x02) ? TXQ_KEY_POSITION : 0;
+		msg->retry = 0;
 		memcpy(msg->content.std.payload+offsetPayload, p1+offset,
 				size);
 	}
@@ -944,39 +1384,79 @@ static int8_t cmd_send(uint8_t* p1, uint8_t* p2, uint8_t** err) {
 #endif
 	LOG(LOG_STATES, "Add event TXREQ to cold event queue");
 
+	/* The message is freed if it cannot be queued */
+	uint8_t dest = msg->content.std.destId;
 	/* Add message to tx queue */
-	if (lowapp_tx(msg) == -1) {
+	int8_t txRet = lowapp_tx(msg);
+	if (txRet == -1) {
 		/* Message is lost */
 		LOG(LOG_ERR, "TX queue was full");
-		_sys->SYS_cmdResponse((uint8_t*)"NOK TX (QUEUE FULL)", 19);
+		send_response("NOK TX (QUEUE FULL)", priority, dest);
+	}
+	else if (txRet == 1) {
+		/* A queued message was replaced, it is already scheduled */
+		send_response("SEND REPLACED", priority, dest);
 	}
 	else {
 		/* We are blocked and therefore cannot send right now */
 		if(txBlocked) {
 			LOG(LOG_INFO, "Delaying TX");
-			_sys->SYS_cmdResponse((uint8_t*)"SEND DELAYED", 12);
+			send_response("SEND DELAYED", priority, dest);
 		}
 		else {
 			/*
-			 * If there is already an element in the queue, the sending of the packet
-			 * will be delayed.
+			 * If there is already an element of the same or a higher priority in the
+			 * queue, the sending of the packet will be delayed.
 			 */
-			if(queue_size(&_tx_pkt_list) > 1) {
+			if(lowapp_tx_pending(priority) > 1) {
 				LOG(LOG_INFO, "Delaying TX");
-				_sys->SYS_cmdResponse((uint8_t*)"SEND DELAYED", 12);
+				send_response("SEND DELAYED", priority, dest);
 			}
 			else {
-				_sys->SYS_cmdResponse((uint8_t*)"SEND REQUEST", 12);
+				send_response("SEND REQUEST", priority, dest);
 			}
 			/* Notify the state machine that a message is waiting to be processed */
-			lock_coldEventQ();
 			add_simple_event(&_coldEventQ, TXREQ);
-			unlock_coldEventQ();
 		}
 	}
 	return 0;
 }
 
+/**
+ * @brief Answer a send request, adding the priority of the message
+ *
+ * The number of messages which can still be queued with the same priority and
+ * destination is added as credits, so that the application can pace its
+ * requests instead of overrunning the TX queue.
+ *
+ * @param[in] status Status of the request
+ * @param[in] priority Priority of the message
+ * @param[in] dest Destination of the message
+ */
+static void send_response(const char* status, uint8_t priority, uint8_t dest) {
+	uint8_t credits = lowapp_tx_credits(priority, dest);
+	uint8_t bufCmd[50] = "";
+	/* Size of the current string to add to the anwser */
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	/* Build the JSON message */
+	sizeStr = strlen(status);
+	memcpy(bufCmd+offset, status, sizeStr);
+	offset += sizeStr;
+	sizeStr = strlen((char*)jsonSendPriority);
+	memcpy(bufCmd+offset, jsonSendPriority, sizeStr);
+	offset += sizeStr;
+	bufCmd[offset++] = '0' + priority;
+	sizeStr = strlen((char*)jsonSendCredits);
+	memcpy(bufCmd+offset, jsonSendCredits, sizeStr);
+	offset += sizeStr;
+	offset = FillBuffer8_t(bufCmd, offset, &credits, 1, false);
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(bufCmd+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(bufCmd, offset);
+}
+
 
 /**
  * @brief Check for received packets.
@@ -993,7 +1473,7 @@ static int8_t cmd_pollrx(uint8_t** err) {
 	/*
 	 * Retrieve RX messages
 	 * No need to protect resource because only the state machine thread is
-	 * touching the _rx_pkt_list
+	 * touching the RX queue
 	 */
 	response_rx_packets();
 	return 0;
@@ -1044,7 +1524,7 @@ static int8_t cmd_connect(uint8_t** err) {
 		if(check_configuration()) {
 			_connected = true;
 			/* Initialise CAD launcher */
-			_sys->SYS_setRepetitiveTimer(_cad_interval);
+			_sys->SYS_setRepetitiveTimer(sync_next_cad_delay());
 		}
 		else {
 			*err=(uint8_t*)"Invalid configuration";
@@ -1068,6 +1548,282 @@ static int8_t cmd_reset(uint8_t** err) {
 #endif
 	return 0;
 }
+
+/**
+ * @brief Set or get a mode which is either enabled (1) or disabled (0)
+ *
+ * Common part of the mode commands, answering OK {"name":"0"} or
+ * OK {"name":"1"} with the mode after the change.
+ *
+ * @param[in] p1 New mode (0 or 1), NULL to get the current mode
+ * @param[in,out] flag Mode to set or get
+ * @param[in] name Name of the mode in the response
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ */
+static int8_t cmd_bool_mode(uint8_t* p1, bool* flag, const char* name, uint8_t** err) {
+	uint8_t bufCmd[32] = "";
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	/* Back to pull mode */
+	_opMode = PULL;
+	if(p1 != NULL) {
+		if(strcmp((char*)p1, "0") == 0) {
+			*flag = false;
+		}
+		else if(strcmp((char*)p1, "1") == 0) {
+			*flag = true;
+		}
+		else {
+			*err=(uint8_t*)"Invalid mode";
+			return LOWAPP_ERR_INVAL;
+		}
+	}
+	memcpy(bufCmd, "OK {\"", 5);
+	offset += 5;
+	sizeStr = strlen(name);
+	memcpy(bufCmd+offset, name, sizeStr);
+	offset += sizeStr;
+	memcpy(bufCmd+offset, "\":\"", 3);
+	offset += 3;
+	bufCmd[offset++] = *flag ? '1' : '0';
+	memcpy(bufCmd+offset, "\"}", 2);
+	offset += 2;
+	_sys->SYS_cmdResponse(bufCmd, offset);
+	return 0;
+}
+
+/**
+ * @brief Set or get the wake-up mode
+ *
+ * In wake-up mode (1), unicast messages are preceded by a strobe of short
+ * wake-up frames instead of a long preamble. Mode 0 is the long preamble.
+ *
+ * @param[in] p1 New wake-up mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgWakeup AT command string
+ */
+static int8_t cmd_wakeup(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_wakeupMode, "wakeup", err);
+}
+
+/**
+ * @brief Set or get the synchronised mode
+ *
+ * In synchronised mode (1), nodes converge on a group clock and only listen and
+ * transmit during periodic rendezvous slots, using a short preamble. Mode 0 is
+ * the asynchronous CAD cycle. Enabling the mode starts a new acquisition of the
+ * group clock.
+ *
+ * @param[in] p1 New synchronised mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgSync AT command string
+ */
+static int8_t cmd_sync(uint8_t* p1, uint8_t** err) {
+	bool wasSync = _syncMode;
+	int8_t ret = cmd_bool_mode(p1, &_syncMode, "sync", err);
+	if(ret != 0 || p1 == NULL) {
+		return ret;
+	}
+	if(_syncMode && !wasSync) {
+		sync_init();
+	}
+	/* Restart the CAD timer with the new listening schedule */
+	if(_connected) {
+		_sys->SYS_setRepetitiveTimer(sync_next_cad_delay());
+	}
+	return 0;
+}
+
+/**
+ * @brief Set or get the link adaptation mode
+ *
+ * In link adaptation mode (1), unicast messages are sent with a spreading
+ * factor and coding rate chosen for their destination and CAD scans all the
+ * candidate spreading factors. Mode 0 uses the group configuration only.
+ *
+ * @param[in] p1 New link adaptation mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgAdapt AT command string
+ */
+static int8_t cmd_adapt(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_linkAdaptMode, "adapt", err);
+}
+
+/**
+ * @brief Set or get the transmit power control mode
+ *
+ * In power control mode (1), the transmit power towards each destination is
+ * lowered as long as the link margin reported in its ACK allows it. Mode 0
+ * always uses the configured power.
+ *
+ * @param[in] p1 New power control mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgPowerCtrl AT command string
+ */
+static int8_t cmd_powerctrl(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_powerCtrlMode, "powerctrl", err);
+}
+
+/**
+ * @brief Set or get the reliable broadcast mode
+ *
+ * In reliable broadcast mode (1), the receivers of a broadcast message report
+ * the previous broadcast messages they missed from its source with a NACK, and
+ * the source sends them again. Mode 0 sends broadcast messages only once. All
+ * the group members must use the same mode.
+ *
+ * @param[in] p1 New reliable broadcast mode (0 or 1), NULL to get the current
+ * mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgRelBcast AT command string
+ */
+static int8_t cmd_relbcast(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_relBcastMode, "relbcast", err);
+}
+
+/**
+ * @brief Set or get the relay mode
+ *
+ * In relay mode (1), unicast messages to the nodes reached through a route
+ * are sent to the next hop of the route, and the relayed messages received
+ * for other nodes are forwarded. Mode 0 still delivers the relayed messages
+ * destined to this device, but does not forward the others.
+ *
+ * @param[in] p1 New relay mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgRelay AT command string
+ */
+static int8_t cmd_relay(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_relayMode, "relay", err);
+}
+
+/**
+ * @brief Set, remove or list the routes to the nodes out of range
+ *
+ * AT+ROUTE=07,05 sends the messages to 07 through 05. AT+ROUTE=07 removes the
+ * route to 07. AT+ROUTE lists the routes as destination:next hop:hops, e.g.
+ * OK {"routes":"07:05:2,09:05:3"}. Routes set with this command are never
+ * replaced by learned routes.
+ *
+ * @param[in] p1 Device id of the destination, NULL to list the routes
+ * @param[in] p2 Device id of the next hop, NULL to remove the route
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_DESTID If a device id is not valid
+ * @see #msgRoute AT command string
+ */
+static int8_t cmd_route(uint8_t* p1, uint8_t* p2, uint8_t** err) {
+	uint8_t buffer[180] = "";
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	uint8_t dest, nextHop;
+	/* Back to pull mode */
+	_opMode = PULL;
+	if(p1 != NULL) {
+		AsciiHexConversionOneValueBI8_t(&dest, p1);
+		if(dest < MIN_DEVICE_ID || dest > MAX_DEVICE_ID) {
+			*err=(uint8_t*)"Invalid destination id";
+			return LOWAPP_ERR_DESTID;
+		}
+		if(p2 == NULL) {
+			route_remove(dest);
+		}
+		else {
+			AsciiHexConversionOneValueBI8_t(&nextHop, p2);
+			if(nextHop < MIN_DEVICE_ID || nextHop > MAX_DEVICE_ID || nextHop == dest) {
+				*err=(uint8_t*)"Invalid next hop id";
+				return LOWAPP_ERR_DESTID;
+			}
+			route_learn(dest, nextHop, 2, true);
+		}
+	}
+	/* Build the JSON message */
+	sizeStr = strlen((char*)jsonPrefixOk);
+	memcpy(buffer+offset, jsonPrefixOk, sizeStr);
+	offset += sizeStr;
+	sizeStr = strlen((char*)jsonRoutes);
+	memcpy(buffer+offset, jsonRoutes, sizeStr);
+	offset += sizeStr;
+	offset = route_fill_list(buffer, offset, sizeof(buffer));
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(buffer+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(buffer, offset);
+	return 0;
+}
+
+/**
+ * @brief Set or get the flooding mode
+ *
+ * In flooding mode (1), broadcast messages are flooded over up to
+ * #FLOOD_MAX_HOPS hops. The flooded messages received are rebroadcast once
+ * after a random delay, unless #FLOOD_SUPPRESS_COUNT copies were heard first.
+ * Mode 0 still delivers the flooded messages received, but does not rebroadcast
+ * them.
+ *
+ * @param[in] p1 New flooding mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgFlood AT command string
+ */
+static int8_t cmd_flood(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_floodMode, "flood", err);
+}
+
+/**
+ * @brief Set or get the mailbox mode
+ *
+ * In mailbox mode (1), a unicast message which was not acknowledged is parked,
+ * and sent again when its destination is heard. Each parked message is
+ * reported with MAILBOX {"dest":"xx","count":"n"}. Mode 0 drops the parked
+ * messages.
+ *
+ * @param[in] p1 New mailbox mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgMailbox AT command string
+ */
+static int8_t cmd_mailbox(uint8_t* p1, uint8_t** err) {
+	int8_t ret = cmd_bool_mode(p1, &_mailboxMode, "mailbox", err);
+	if(ret == 0 && p1 != NULL && !_mailboxMode) {
+		mbox_clear();
+	}
+	return ret;
+}
+
+/**
+ * @brief Set or get the cleartext hint mode
+ *
+ * In hint mode (1), the standard and relayed messages are sent with their
+ * destination id and a hash of the group in clear after the header. The nodes
+ * which are not the destination drop them without decoding them, and can stop
+ * their reception early. The frames with a hint are received whatever the mode.
+ *
+ * @param[in] p1 New hint mode (0 or 1), NULL to get the current mode
+ * @param[out] err Error buffer
+ * @retval 0 On success
+ * @retval #LOWAPP_ERR_INVAL If the mode is not valid
+ * @see #msgHint AT command string
+ */
+static int8_t cmd_hint(uint8_t* p1, uint8_t** err) {
+	return cmd_bool_mode(p1, &_hintMode, "hint", err);
+}
 /** @} */
 
 #pragma GCC diagnostic pop
@@ -1279,15 +2035,19 @@ static int8_t at_cmd_interp(uint8_t* cmd, uint8_t* p1, uint8_t* p2, uint8_t** er
 	}
 	/* If the command is a statistics AT command */
 	else if (strcmp((char*)msgStats,cmdChar)==0)  {
-		return cmd_getstats(err);
+		return cmd_getstats(p1, err);
 	}
 	/* If the command is a WHO AT command */
 	else if (strcmp((char*)msgWho,cmdChar)==0)  {
 		return cmd_who(err);
 	}
+	/* If the command is a queues AT command */
+	else if (strcmp((char*)msgQueues,cmdChar)==0)  {
+		return cmd_queues(p1, err);
+	}
 	/* If the command is a PING AT command */
 	else if (strcmp((char*)msgPing,cmdChar)==0)  {
-		return cmd_ping(p1,err);
+		return cmd_ping(p1, p2, err);
 	}
 	/* If the command is a HELLO AT command */
 	else if (strcmp((char*)msgHello,cmdChar)==0)  {
@@ -1317,6 +2077,52 @@ static int8_t at_cmd_interp(uint8_t* cmd, uint8_t* p1, uint8_t* p2, uint8_t** er
 	else if (strcmp((char*)msgReset,cmdChar)==0)  {
 		return cmd_reset(err);
 	}
+	/* If the command is a wake-up mode AT command */
+	else if (strcmp((char*)msgWakeup,cmdChar)==0)  {
+		return cmd_wakeup(p1, err);
+	}
+	/* If the command is a synchronised mode AT command */
+	else if (strcmp((char*)msgSync,cmdChar)==0)  {
+		return cmd_sync(p1, err);
+	}
+	/* If the command is a link adaptation mode AT command */
+	else if (strcmp((char*)msgAdapt,cmdChar)==0)  {
+		return cmd_adapt(p1, err);
+	}
+	/* If the command is a power control mode AT command */
+	else if (strcmp((char*)msgPowerCtrl,cmdChar)==0)  {
+		return cmd_powerctrl(p1, err);
+	}
+	/* If the command is a reliable broadcast mode AT command */
+	else if (strcmp((char*)msgRelBcast,cmdChar)==0)  {
+		return cmd_relbcast(p1, err);
+	}
+	/* If the command is a relay mode AT command */
+	else if (strcmp((char*)msgRelay,cmdChar)==0)  {
+		return cmd_relay(p1, err);
+	}
+	/* If the command is a route AT command */
+	else if (strcmp((char*)msgRoute,cmdChar)==0)  {
+		return cmd_route(p1, p2, err);
+	}
+	/* If the command is a flooding mode AT command */
+	else if (strcmp((char*)msgFlood,cmdChar)==0)  {
+		return cmd_flood(p1, err);
+	}
+	/* If the command is a mailbox mode AT command */
+	else if (strcmp((char*)msgMailbox,cmdChar)==0)  {
+		return cmd_mailbox(p1, err);
+	}
+	/* If the command is a cleartext hint mode AT command */
+	else if (strcmp((char*)msgHint,cmdChar)==0)  {
+		return cmd_hint(p1, err);
+	}
+#ifdef LOWAPP_SM_PROFILE
+	/* If the command is a state machine profile AT command */
+	else if (strcmp((char*)msgSmprof,cmdChar)==0)  {
+		return cmd_smprof(p1, err);
+	}
+#endif
 #ifdef SIMU
 	/* If the command is a set log AT command */
 	else if(strcmp((char*)msgLog, cmdChar)==0) {
@@ -1339,19 +2145,15 @@ void at_queue_process() {
 	uint8_t* cmd;
 	uint16_t len;
 	int8_t getFromQ = 0;
-	lock_atcmd();
 	getFromQ = get_from_queue(&_atcmd_list, (void**)&cmd, &len);
-	unlock_atcmd();
 	/* Loop while an AT command is in the queue */
 	while(getFromQ != -1) {
 		at_cmd_process(cmd);
 		/* Free memory */
-		free(cmd);
+		atbuf_free(cmd);
 		cmd = NULL;
 
-		lock_atcmd();
 		getFromQ = get_from_queue(&_atcmd_list, (void**)&cmd, &len);
-		unlock_atcmd();
 	}
 }
 
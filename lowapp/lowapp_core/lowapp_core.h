@@ -22,7 +22,12 @@ typedef enum {
 	TYPE_STDMSG = 0x1, /**< Standard type LoWAPP message */
 	TYPE_ACK = 0x2, /**< Acknowledge type LoWAPP message */
 	TYPE_GWOUT = 0x3, /**< Gateway out type LoWAPP message */
-	TYPE_GWIN = 0x4 /**< Gateway in type LoWAPP message */
+	TYPE_GWIN = 0x4, /**< Gateway in type LoWAPP message */
+	TYPE_WAKEUP = 0x5, /**< Wake-up strobe / early ACK type LoWAPP message */
+	TYPE_NACK = 0x6, /**< Missing broadcast messages report, same layout as an ACK */
+	TYPE_RELAY = 0x7, /**< Relayed message, same layout as a standard message */
+	TYPE_HELLO = 0x8, /**< Neighbour discovery request, same layout as a standard message */
+	TYPE_HELLO_REPLY = 0x9 /**< Neighbour discovery reply, same layout as an ACK */
 } MSG_TYPE;
 
 /**
@@ -36,6 +41,16 @@ typedef enum {
  */
 #define LOWAPP_CURRENT_VERSION	0x1
 
+/**
+ * Version field of a standard frame carrying a cleartext hint
+ *
+ * The hint (destination id and group hash) follows the header, so that the
+ * frames destined to other nodes can be dropped without being decoded.
+ *
+ * @see #_hintMode
+ */
+#define LOWAPP_HINT_VERSION	0x2
+
 /**
  * @addtogroup lowapp_core_config
  * @{
@@ -128,7 +143,8 @@ typedef enum {
 	TIMEOUT, /**< Generic timer timed out (usually safeguard timer) */
 	RXTIMEOUT, /**< Timeout occurred at the radio reception level */
 	TXTIMEOUT, /**< Timeout occurred at the radio transmission level */
-	TXUNBLOCK	/**< Unblock transmission when timer ends */
+	TXUNBLOCK,	/**< Unblock transmission when timer ends */
+	DEFERRED	/**< A deferred transmission (flood rebroadcast, ping) is due */
 } EVENTS;
 
 /**
@@ -153,6 +169,8 @@ typedef enum {
 	RXING_ACK,
 	/** CAD state @see state_cad Corresponding state's function */
 	CAD,
+	/** Transmitting wake-up strobe state @see state_txing_wakeup Corresponding state's function */
+	TXING_WAKEUP,
 	/** Restart state @see state_restart Corresponding state's function */
 	RESTART
 } STATES;
@@ -161,12 +179,18 @@ typedef enum {
 /** @} */
 
 /**
- * Sequence number for a specific group member
+ * Sequence numbers and link settings for a specific group member
+ *
+ * The link statistics are kept in the neighbour table (#NEIGH_T).
  */
 typedef struct PEER {
 	uint8_t out_txseq; /**< TX Sequence number */
 	uint8_t out_rxseq; /**< Last RX sequence number from the receiver */
 	uint8_t in_expected; /**< Next sequence number expected for incomming transmission */
+	uint8_t in_mcast; /**< Sequence number of the last multicast message received from this member */
+	uint8_t in_bcast; /**< Next broadcast sequence number expected from this member, 0 if none was received */
+	uint8_t bcast_missing; /**< Broadcast messages missing from this member, bit i for sequence number in_bcast-1-i */
+	int8_t link_power; /**< Transmit power towards this member (dBm), 0 until an ACK reported a margin */
 } PEER_T;
 
 /** Lower threshold for sequence numbers, used to assume rollover of the counter */
@@ -180,13 +204,44 @@ typedef struct PEER {
 #define DUTY_CYCLE_ALLOWED	36000
 
 /**
- * Statistics element for AT+WHO
+ * Entry of the neighbour table, reported by AT+WHO
  */
-typedef struct STAT {
-	uint8_t deviceId;	/**< Device id */
+typedef struct NEIGH {
+	uint8_t deviceId;	/**< Device id, 0 if the entry is free */
 	int16_t lastRssi;		/**< RSSI of the last message received from this node */
 	uint64_t lastSeen;	/**< Time in ms of the last message received */
-} STAT_T;
+	int16_t rssiAvg;	/**< Moving average of the RSSI (1/16 dBm) */
+	int16_t snrAvg;		/**< Moving average of the SNR (1/16 dB) */
+	uint8_t prr;		/**< Packet reception ratio estimate (1/255) */
+	uint8_t ackRate;	/**< ACK success rate estimate (1/255) */
+	uint8_t cadPhase;	/**< Last CAD phase reported (1/256 of the CAD interval) */
+	bool cadKnown;		/**< A CAD phase was reported */
+	bool ackKnown;		/**< At least one unicast message was sent */
+	uint8_t fails;		/**< Number of consecutive unicast transmissions without ACK */
+	uint32_t parkUntil;	/**< Local time (ms, truncated) until which messages to this node are held back, 0 if not parked */
+} NEIGH_T;
+
+/**
+ * Counters for AT+STATS
+ */
+typedef struct CORE_STATS {
+	uint16_t txFrames;	/**< Frames transmitted (messages, ACK and wake-up frames) */
+	uint16_t rxFrames;	/**< Frames received and parsed */
+	uint16_t lbtBusy;	/**< Transmissions delayed because listen before talk found the channel busy */
+	uint16_t txTimeout;	/**< Transmissions which timed out */
+	uint16_t ackOk;		/**< Unicast messages acknowledged */
+	uint16_t ackNok;	/**< Unicast messages answered by a frame which was not their ACK */
+	uint16_t ackMissing;	/**< Unicast messages without any answer */
+	uint16_t crcError;	/**< Frames received with a wrong CRC (or encryption key) */
+	uint16_t notForMe;	/**< Frames received for another node */
+	uint16_t duplicate;	/**< Duplicate messages received */
+	uint16_t missingFrames;	/**< Messages missed, from the gaps in the sequence numbers */
+	uint16_t queueFull;	/**< Messages dropped because the TX or RX queue was full */
+	uint16_t txExpired;	/**< Messages dropped because their deadline passed before they were sent */
+	uint16_t txCoalesced;	/**< Queued messages replaced by a newer message with the same key */
+	uint16_t ackLatency[STATS_HIST_BUCKETS];	/**< Histogram of the time from the start of the transmission to the ACK */
+	uint16_t queueDelay[STATS_HIST_BUCKETS];	/**< Histogram of the time spent in the TX queue */
+} CORE_STATS_T;
 
 /**
  * Operation modes available for the nodes
@@ -211,18 +266,23 @@ enum NODE_MODE {
 typedef enum NODE_MODE NODE_MODE_T;
 
 void update_safeguard_timers();
+void set_radio_config(uint8_t sf, uint8_t cr, uint16_t preambleLen, int8_t power);
 void set_default_values();
 bool check_configuration();
 bool check_attribute(const uint8_t* key, const uint8_t* val);
 void core_radio_init();
 void core_init();
 int8_t lowapp_tx(MSG_T* msg);
+uint8_t lowapp_tx_pending(uint8_t priority);
+uint8_t lowapp_tx_credits(uint8_t priority, uint8_t dest);
 uint8_t sm_run();
 void clean_queues(void);
 void process_ack(MSG_T* msg);
 
 void timeoutCB();
 void timeoutCB2();
+void timeoutCB3();
+void deferred_schedule(uint32_t delay);
 void cadTimeoutCB();
 
 #endif
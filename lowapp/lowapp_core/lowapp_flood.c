@@ -0,0 +1,211 @@
+/**
+ * @file lowapp_flood.c
+ * @brief LoWAPP controlled flooding
+ *
+ * When the flooding mode is enabled, broadcast messages are sent as
+ * #TYPE_RELAY messages to #LOWAPP_ID_BROADCAST, with the relay header of
+ * #lowapp_route.c: #LOWAPP_ID_BROADCAST as final destination, the origin, the
+ * number of hops left and a flood id chosen by the origin.
+ *
+ * Each receiver delivers a flooded message once, and rebroadcasts it once
+ * after a random delay between #FLOOD_DELAY_MIN and #FLOOD_DELAY_MAX. Each copy
+ * overheard in the meantime is counted, and the rebroadcast is cancelled once
+ * #FLOOD_SUPPRESS_COUNT copies were heard: the neighbourhood is then already
+ * covered.
+ *
+ * The messages are identified by (origin, flood id) in a direct-mapped hash
+ * set of #FLOOD_CACHE entries, so that a lookup costs a single comparison. A
+ * collision forgets the older message, which at worst is delivered and
+ * rebroadcast again.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+#include "utilities.h"
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_flood LoWAPP Core Flooding
+ * @brief Controlled flooding of broadcast messages
+ * @{
+ */
+
+/**
+ * Flooded message cache entry
+ */
+typedef struct FLOOD_ENTRY {
+	uint8_t origin; /**< Device id of the origin, 0 for a free entry */
+	uint8_t id; /**< Flood id chosen by the origin */
+	uint8_t copies; /**< Number of copies heard */
+} FLOOD_ENTRY_T;
+
+/**
+ * Rebroadcast waiting for its delay
+ */
+typedef struct FLOOD_WAIT {
+	MSG_T* msg; /**< Message to rebroadcast, NULL for a free entry */
+	uint32_t due; /**< Local time (ms, truncated) of the rebroadcast */
+} FLOOD_WAIT_T;
+
+/** Flooded messages heard last */
+static FLOOD_ENTRY_T floodCache[FLOOD_CACHE];
+
+/** Rebroadcasts waiting for their delay */
+static FLOOD_WAIT_T floodPending[FLOOD_PENDING];
+
+/** Last flood id used for our own messages */
+static uint8_t floodId = 0;
+
+/**
+ * Get the cache entry of a flooded message
+ *
+ * @param origin Device id of the origin
+ * @param id Flood id of the message
+ * @return The entry the message is stored in
+ */
+static FLOOD_ENTRY_T* flood_entry(uint8_t origin, uint8_t id) {
+	return &floodCache[(origin * 31 + id) & (FLOOD_CACHE-1)];
+}
+
+/**
+ * Flood a broadcast message
+ *
+ * The relay header is added at the head of the payload.
+ *
+ * @param msg Message to send, modified in place
+ */
+void flood_wrap(MSG_T* msg) {
+	if(msg->hdr.type != TYPE_STDMSG || msg->content.std.destId != LOWAPP_ID_BROADCAST) {
+		return;
+	}
+	if(msg->hdr.payloadLength + RELAY_HDR_SIZE > MAX_PAYLOAD_STD_SIZE-1) {
+		LOG(LOG_WARN, "Payload too big for flooding, broadcasting once");
+		return;
+	}
+	memmove(msg->content.std.payload+RELAY_HDR_SIZE, msg->content.std.payload, msg->hdr.payloadLength);
+	msg->content.std.payload[0] = LOWAPP_ID_BROADCAST;
+	msg->content.std.payload[1] = _deviceId;
+	msg->content.std.payload[2] = FLOOD_MAX_HOPS-1;
+	floodId++;
+	msg->content.std.payload[3] = floodId;
+	msg->hdr.payloadLength += RELAY_HDR_SIZE;
+	msg->hdr.type = TYPE_RELAY;
+}
+
+/**
+ * Process a flooded message received
+ *
+ * The first copy is turned back into a broadcast message from its origin, and
+ * its rebroadcast is scheduled. The following copies are only counted.
+ *
+ * @param msg Flooded message received, modified in place
+ * @retval True If the message must be delivered to the application
+ * @retval False If the message was already received, and must be freed
+ */
+bool flood_receive(MSG_T* msg) {
+	FLOOD_ENTRY_T* entry;
+	uint8_t origin, id, hopsLeft, i;
+	int32_t delay;
+	MSG_T* copy;
+	if(msg->hdr.payloadLength < RELAY_HDR_SIZE) {
+		return false;
+	}
+	origin = msg->content.std.payload[1];
+	hopsLeft = msg->content.std.payload[2];
+	id = msg->content.std.payload[3];
+	if(origin == _deviceId) {
+		return false;
+	}
+
+	entry = flood_entry(origin, id);
+	if(entry->origin == origin && entry->id == id) {
+		if(entry->copies < UINT8_MAX) {
+			entry->copies++;
+		}
+		return false;
+	}
+	entry->origin = origin;
+	entry->id = id;
+	entry->copies = 1;
+	/* The first copy came through the shortest path to the origin */
+	if(origin != msg->content.std.srcId) {
+		route_learn(origin, msg->content.std.srcId, FLOOD_MAX_HOPS-hopsLeft, false);
+	}
+
+	/* Schedule the rebroadcast */
+	if(_floodMode && hopsLeft > 0 && hopsLeft < FLOOD_MAX_HOPS) {
+		for(i = 0; i < FLOOD_PENDING; ++i) {
+			if(floodPending[i].msg == NULL) {
+				break;
+			}
+		}
+		if(i < FLOOD_PENDING && (copy = msg_alloc()) != NULL) {
+			delay = randr(FLOOD_DELAY_MIN, FLOOD_DELAY_MAX);
+			memcpy(copy, msg, sizeof(MSG_T));
+			copy->content.std.payload[2] = hopsLeft-1;
+			copy->content.std.srcId = _deviceId;
+			copy->content.std.txSeq = 0;
+			copy->hdr.rfu = 0;
+			copy->priority = TXQ_PRIO_NORMAL;
+			copy->deadline = 0;
+			copy->key = 0;
+			copy->retry = 0;
+			floodPending[i].msg = copy;
+			floodPending[i].due = (uint32_t)_sys->SYS_getTimeMs() + delay;
+			deferred_schedule(delay);
+		}
+		else {
+			LOG(LOG_WARN, "No room for the rebroadcast, flooded message from %u not relayed", origin);
+		}
+	}
+
+	/* Deliver the message from its origin */
+	msg->hdr.payloadLength -= RELAY_HDR_SIZE;
+	memmove(msg->content.std.payload, msg->content.std.payload+RELAY_HDR_SIZE, msg->hdr.payloadLength);
+	msg->hdr.type = TYPE_STDMSG;
+	msg->content.std.srcId = origin;
+	return true;
+}
+
+/**
+ * Queue the rebroadcasts whose delay is over
+ *
+ * Called when timer 3 ends. A rebroadcast is cancelled if enough copies of its
+ * message were heard, the timer is armed again for the next one.
+ */
+void flood_poll(void) {
+	uint8_t i;
+	int32_t left;
+	FLOOD_ENTRY_T* entry;
+	MSG_T* msg;
+	for(i = 0; i < FLOOD_PENDING; ++i) {
+		msg = floodPending[i].msg;
+		if(msg == NULL) {
+			continue;
+		}
+		left = (int32_t)(floodPending[i].due - (uint32_t)_sys->SYS_getTimeMs());
+		if(left > 0) {
+			deferred_schedule(left);
+			continue;
+		}
+		floodPending[i].msg = NULL;
+		entry = flood_entry(msg->content.std.payload[1], msg->content.std.payload[3]);
+		if(entry->origin == msg->content.std.payload[1] && entry->id == msg->content.std.payload[3]
+				&& entry->copies >= FLOOD_SUPPRESS_COUNT) {
+			LOG(LOG_INFO, "Rebroadcast suppressed, %u copies heard", entry->copies);
+			msg_free(msg);
+			continue;
+		}
+		LOG(LOG_INFO, "Rebroadcasting flooded message from %u", msg->content.std.payload[1]);
+		/* The message is freed by lowapp_tx if the queue is full */
+		lowapp_tx(msg);
+	}
+}
+
+/** @} */
+/** @} */
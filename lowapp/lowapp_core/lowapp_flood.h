@@ -0,0 +1,19 @@
+/**
+ * @file lowapp_flood.h
+ * @brief LoWAPP controlled flooding
+ *
+ * Defines the functions used to spread broadcast messages over several hops
+ * while suppressing the redundant rebroadcasts.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_FLOOD_H_
+#define LOWAPP_CORE_FLOOD_H_
+
+void flood_wrap(MSG_T* msg);
+bool flood_receive(MSG_T* msg);
+void flood_poll(void);
+
+#endif
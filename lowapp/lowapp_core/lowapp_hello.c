@@ -0,0 +1,259 @@
+/**
+ * @file lowapp_hello.c
+ * @brief LoWAPP neighbour discovery
+ *
+ * AT+HELLO broadcasts a #TYPE_HELLO request, with the usual preamble so that
+ * every node of the group hears it. Its single payload byte is the number of
+ * reply slots, chosen from the number of nodes already known to keep the
+ * replies apart.
+ *
+ * Each node hearing the request answers in a randomly drawn slot with a
+ * #TYPE_HELLO_REPLY frame, which has the layout and the short preamble of an
+ * ACK: the received sequence number field carries the RSSI at which the
+ * request was heard (in -dBm), and the expected sequence number field carries
+ * the phase of the CAD cycle of the node at the start of its slot (in 1/256 of
+ * #_cad_interval).
+ *
+ * The requester listens during all the slots, like for multicast ACK, and
+ * records each reply in the neighbour table. The neighbours which replied
+ * are reported at the end of the window with
+ * HELLO {"count":"n","nodes":"id:rssi:rssiSeen:phase,..."}.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+#include "utilities.h"
+
+extern volatile uint64_t lastCadTime;
+extern uint16_t timer_safeguard_txing_ack;
+extern const uint8_t jsonHelloCount[];
+extern const uint8_t jsonHelloNodes[];
+extern const uint8_t jsonSuffix[];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_hello LoWAPP Core Neighbour Discovery
+ * @brief Discovery request and random reply slots
+ * @{
+ */
+
+/**
+ * Neighbour which replied to a discovery request
+ */
+typedef struct HELLO_NODE {
+	uint8_t id; /**< Device id of the neighbour */
+	int16_t rssi; /**< RSSI of the reply (dBm) */
+	int16_t rssiSeen; /**< RSSI of the request seen by the neighbour (dBm) */
+	uint8_t cadPhase; /**< CAD phase of the neighbour at the start of its slot */
+} HELLO_NODE_T;
+
+/** Neighbours which replied to the last request */
+static HELLO_NODE_T helloNodes[HELLO_MAX_NODES];
+
+/** Number of entries of #helloNodes */
+static uint8_t helloCount = 0;
+
+/** Number of reply slots of the last request */
+static uint8_t helloSlots = HELLO_SLOTS_MIN;
+
+/** Listening for replies after a discovery request */
+static bool helloListening = false;
+
+/** Local time (in ms) at which the reply window ends */
+static uint64_t helloListenEnd = 0;
+
+/**
+ * Build a discovery request
+ *
+ * @return The request, to be queued for transmission
+ * @retval NULL If the message pool is empty
+ */
+MSG_T* hello_build_request(void) {
+	MSG_T* msg = msg_alloc();
+	uint16_t slots = 2 * neigh_count();
+	if(msg == NULL) {
+		return NULL;
+	}
+	if(slots < HELLO_SLOTS_MIN) {
+		slots = HELLO_SLOTS_MIN;
+	}
+	else if(slots > HELLO_SLOTS_MAX) {
+		slots = HELLO_SLOTS_MAX;
+	}
+	msg->hdr.type = TYPE_HELLO;
+	msg->hdr.version = LOWAPP_CURRENT_VERSION;
+	msg->hdr.payloadLength = 1;
+	msg->hdr.rfu = 0;
+	msg->content.std.destId = LOWAPP_ID_BROADCAST;
+	msg->content.std.srcId = _deviceId;
+	msg->content.std.txSeq = 0;
+	msg->content.std.payload[0] = slots;
+	msg->priority = TXQ_PRIO_NORMAL;
+	msg->deadline = 0;
+	msg->key = 0;
+	msg->retry = 0;
+	return msg;
+}
+
+/**
+ * Build the reply to a discovery request
+ *
+ * @param request Discovery request received
+ * @param rssi RSSI of the request (dBm)
+ * @param snr SNR of the request (dB)
+ * @param[out] delay Delay (in ms) from the end of the request to the reply, in
+ * a random slot
+ * @return The reply, to be freed by the caller
+ * @retval NULL If the message pool is empty
+ */
+MSG_T* hello_build_reply(MSG_T* request, int16_t rssi, int8_t snr, uint32_t* delay) {
+	MSG_T* reply = msg_alloc();
+	uint8_t slots = HELLO_SLOTS_MIN;
+	uint64_t sinceCad;
+	if(reply == NULL) {
+		return NULL;
+	}
+	if(request->hdr.payloadLength >= 1 && request->content.std.payload[0] != 0) {
+		slots = request->content.std.payload[0];
+		if(slots > HELLO_SLOTS_MAX) {
+			slots = HELLO_SLOTS_MAX;
+		}
+	}
+	*delay = TIMER_ACK_SLOT_START + randr(0, slots-1)*mcast_slot_length() + MCAST_ACK_GUARD;
+
+	reply->hdr.payloadLength = 0;
+	reply->hdr.type = TYPE_HELLO_REPLY;
+	reply->hdr.version = LOWAPP_CURRENT_VERSION;
+	reply->hdr.rfu = link_margin_report(snr);
+	reply->content.ack.destId = request->content.std.srcId;
+	reply->content.ack.srcId = _deviceId;
+	reply->content.ack.rxdSeq = (rssi >= 0) ? 0 : (rssi < -255) ? 255 : -rssi;
+	reply->content.ack.expectedSeq = 0;
+	if(_cad_interval != 0) {
+		sinceCad = _sys->SYS_getTimeMs() + *delay - lastCadTime;
+		reply->content.ack.expectedSeq = ((sinceCad % _cad_interval) * 256) / _cad_interval;
+	}
+	return reply;
+}
+
+/**
+ * Start waiting for replies after a discovery request was sent
+ *
+ * @param msg Discovery request sent
+ */
+void hello_sent(MSG_T* msg) {
+	helloSlots = msg->content.std.payload[0];
+	helloCount = 0;
+	helloListening = true;
+	helloListenEnd = 0;
+}
+
+/**
+ * Check whether replies are expected after a discovery request
+ *
+ * @retval True If the reply window is open
+ * @retval False Otherwise
+ */
+bool hello_active(void) {
+	return helloListening;
+}
+
+/**
+ * Get the time left in the reply window
+ *
+ * The window starts with the first call, at the beginning of the first slot.
+ *
+ * @return The time left in ms
+ */
+uint32_t hello_listen_time(void) {
+	uint64_t now = _sys->SYS_getTimeMs();
+	if(!helloListening) {
+		return 0;
+	}
+	if(helloListenEnd == 0) {
+		helloListenEnd = now + helloSlots*mcast_slot_length() + timer_safeguard_txing_ack;
+	}
+	if(now >= helloListenEnd) {
+		return 0;
+	}
+	return helloListenEnd - now;
+}
+
+/**
+ * Record a reply to the discovery request
+ *
+ * @param reply Reply received
+ * @param rssi RSSI of the reply (dBm)
+ */
+void hello_reply_in(MSG_T* reply, int16_t rssi) {
+	uint8_t i;
+	uint8_t src = reply->content.ack.srcId;
+	LOG(LOG_INFO, "Hello reply from %u (%d dBm, seen at -%u dBm)", src, rssi, reply->content.ack.rxdSeq);
+
+	neigh_cad_phase(src, reply->content.ack.expectedSeq);
+	/* The node is reachable again */
+	mbox_heard(src);
+
+	for(i = 0; i < helloCount; ++i) {
+		if(helloNodes[i].id == src) {
+			break;
+		}
+	}
+	if(i == HELLO_MAX_NODES) {
+		return;
+	}
+	if(i == helloCount) {
+		helloCount++;
+	}
+	helloNodes[i].id = src;
+	helloNodes[i].rssi = rssi;
+	helloNodes[i].rssiSeen = -(int16_t)reply->content.ack.rxdSeq;
+	helloNodes[i].cadPhase = reply->content.ack.expectedSeq;
+}
+
+/**
+ * End the reply window and report the neighbours which replied
+ */
+void hello_finish(void) {
+	uint8_t buffer[250] = "";
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	uint8_t i;
+	helloListening = false;
+
+	sizeStr = strlen((char*)jsonHelloCount);
+	memcpy(buffer, jsonHelloCount, sizeStr);
+	offset += sizeStr;
+	offset = FillBuffer8_t(buffer, offset, &helloCount, 1, false);
+	sizeStr = strlen((char*)jsonHelloNodes);
+	memcpy(buffer+offset, jsonHelloNodes, sizeStr);
+	offset += sizeStr;
+	for(i = 0; i < helloCount; ++i) {
+		/* Room for the longest entry and the end of the response */
+		if((size_t)offset + 17 + 2 > sizeof(buffer)) {
+			break;
+		}
+		if(i > 0) {
+			buffer[offset++] = ',';
+		}
+		offset = FillBufferHexBI8_t(buffer, offset, &helloNodes[i].id, 1, false);
+		buffer[offset++] = ':';
+		offset = FillBufferS16_t(buffer, offset, helloNodes[i].rssi, false);
+		buffer[offset++] = ':';
+		offset = FillBufferS16_t(buffer, offset, helloNodes[i].rssiSeen, false);
+		buffer[offset++] = ':';
+		offset = FillBuffer8_t(buffer, offset, &helloNodes[i].cadPhase, 1, false);
+	}
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(buffer+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(buffer, offset);
+}
+
+/** @} */
+/** @} */
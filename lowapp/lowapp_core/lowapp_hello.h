@@ -0,0 +1,23 @@
+/**
+ * @file lowapp_hello.h
+ * @brief LoWAPP neighbour discovery
+ *
+ * Defines the functions used to discover the neighbours in radio range with a
+ * single broadcast request answered in random reply slots.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_HELLO_H_
+#define LOWAPP_CORE_HELLO_H_
+
+MSG_T* hello_build_request(void);
+MSG_T* hello_build_reply(MSG_T* request, int16_t rssi, int8_t snr, uint32_t* delay);
+void hello_sent(MSG_T* msg);
+bool hello_active(void);
+uint32_t hello_listen_time(void);
+void hello_reply_in(MSG_T* reply, int16_t rssi);
+void hello_finish(void);
+
+#endif
@@ -20,8 +20,23 @@
 #include "lowapp_log.h"
 #include "lowapp_radio_evt.h"
 #include "lowapp_atcmd.h"
+#include "lowapp_sync.h"
+#include "lowapp_link.h"
+#include "lowapp_mcast.h"
+#include "lowapp_rbcast.h"
+#include "lowapp_route.h"
+#include "lowapp_flood.h"
+#include "lowapp_mbox.h"
+#include "lowapp_hello.h"
+#include "lowapp_ping.h"
+#include "lowapp_neigh.h"
+#include "lowapp_smprof.h"
+#include "lowapp_pool.h"
+#include "lowapp_rxq.h"
 /* Include LoWAPP util headers */
 #include "lowapp_utils_queue.h"
+#include "lowapp_utils_pool.h"
+#include "lowapp_utils_ring.h"
 #include "lowapp_utils_conversion.h"
 
 #include "lowapp_shared_res.h"
@@ -39,6 +54,15 @@ extern uint16_t _preambleLen;
 extern uint8_t _encryptionKey[16];
 extern NODE_MODE_T _opMode;
 extern bool _connected;
+extern bool _wakeupMode;
+extern bool _syncMode;
+extern bool _linkAdaptMode;
+extern bool _powerCtrlMode;
+extern bool _relBcastMode;
+extern bool _relayMode;
+extern bool _floodMode;
+extern bool _mailboxMode;
+extern bool _hintMode;
 
 extern uint32_t _cad_interval;
 
@@ -0,0 +1,287 @@
+/**
+ * @file lowapp_link.c
+ * @brief LoWAPP per-link adaptation
+ *
+ * When the link adaptation mode is enabled, each unicast message is sent with
+ * the lowest airtime spreading factor and coding rate that keep the link to its
+ * destination reliable, instead of the group-wide #_rsf and #_coderate.
+ *
+ * The average SNR of the frames and ACK received from each peer, kept in the
+ * neighbour table, gives the lowest SF
+ * whose demodulation floor is still #LINK_SNR_MARGIN below the link SNR. Each
+ * missing ACK then makes the link more robust: the first one switches to the
+ * most robust coding rate, the following ones add one SF each.
+ *
+ * The candidate SFs range from #_rsf to #_rsf + #LINK_SF_STEPS. Receivers scan
+ * all of them during CAD. ACK are always sent with #_coderate, on the SF of
+ * the message they acknowledge. Broadcast messages keep the group SF.
+ *
+ * When the power control mode is enabled, the transmit power towards each peer
+ * is also adapted. Every ACK reports the link margin of the acknowledged frame
+ * in its header rfu field, and the sender steps its power down while the margin
+ * stays above #LINK_POWER_TARGET_MARGIN, or back up to reach it. A missing ACK
+ * restores #_power before any other adaptation.
+ *
+ * The consecutive missing ACK also park a destination for #TXQ_PARK_TIME, so
+ * that the messages to the other destinations are scheduled first.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+extern PEER_T peers[256];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_link LoWAPP Core Link Adaptation
+ * @brief Per-link spreading factor and coding rate
+ * @{
+ */
+
+/**
+ * Demodulation floor (in half dB) of the spreading factors, from SF7 to SF12
+ */
+static const int8_t linkSnrFloor[] = { -15, -20, -25, -30, -35, -40 };
+
+/** Standard preamble length (in symbols) for each SF, keeping the preamble time */
+static uint16_t linkPreambleLen[MAX_SPREADINGFACTOR-MIN_SPREADINGFACTOR+1];
+
+/** SF the radio is currently configured with */
+static uint8_t linkRadioSf = 0;
+
+/** Coding rate the radio is currently configured with */
+static uint8_t linkRadioCr = 0;
+
+/** Transmit power the radio is currently configured with */
+static int8_t linkRadioPower = 0;
+
+/**
+ * Get the highest SF a link can use
+ * @return The highest candidate SF
+ */
+static uint8_t link_max_sf(void) {
+	if(!_linkAdaptMode) {
+		return _rsf;
+	}
+	if(_rsf > MAX_SPREADINGFACTOR - LINK_SF_STEPS) {
+		return MAX_SPREADINGFACTOR;
+	}
+	return _rsf + LINK_SF_STEPS;
+}
+
+/**
+ * Update the preamble lengths according to the current radio configuration
+ *
+ * Must be called after the radio was set up with the group configuration.
+ */
+void link_update_radio(void) {
+	uint8_t sf;
+	for(sf = MIN_SPREADINGFACTOR; sf <= MAX_SPREADINGFACTOR; ++sf) {
+		linkPreambleLen[sf-MIN_SPREADINGFACTOR] = preamble_timems_to_symbols_sf(preambleTime, sf)+10;
+	}
+	/* Keep the exact group preamble on the group SF */
+	linkPreambleLen[_rsf-MIN_SPREADINGFACTOR] = _preambleLen;
+	linkRadioSf = _rsf;
+	linkRadioCr = _coderate;
+	linkRadioPower = _power;
+}
+
+/**
+ * Record the outcome of a unicast transmission to a peer
+ *
+ * A peer never heard is added to the neighbour table, so that it can be parked.
+ *
+ * @param peer Device id of the destination
+ * @param acked True if the ACK was received
+ */
+void link_ack_result(uint8_t peer, bool acked) {
+	NEIGH_T* entry = acked ? neigh_find(peer) : neigh_add(peer);
+	if(entry == NULL) {
+		return;
+	}
+	if(acked) {
+		entry->fails = 0;
+		entry->parkUntil = 0;
+		return;
+	}
+	/* Full power first, the margin may have dropped since the last report */
+	if(peers[peer].link_power != 0 && peers[peer].link_power < _power) {
+		LOG(LOG_INFO, "Link to %u: back to full power", peer);
+		peers[peer].link_power = 0;
+	}
+	else if(entry->fails < LINK_MAX_FAILS) {
+		entry->fails++;
+	}
+	/* Let the other destinations go first for a while */
+	if(entry->fails >= TXQ_PARK_FAILS) {
+		LOG(LOG_INFO, "Parking destination %u", peer);
+		entry->parkUntil = (uint32_t)(_sys->SYS_getTimeMs() + TXQ_PARK_TIME) | 1;
+	}
+}
+
+/**
+ * Choose the radio parameters of a transmission to a peer
+ *
+ * @param peer Device id of the destination
+ * @param[out] sf Spreading factor to use
+ * @param[out] cr Coding rate to use
+ * @param[out] power Transmit power to use
+ */
+void link_select(uint8_t peer, uint8_t* sf, uint8_t* cr, int8_t* power) {
+	uint8_t maxSf = link_max_sf();
+	NEIGH_T* entry;
+	*sf = _rsf;
+	*cr = _coderate;
+	*power = _power;
+	if(peer == LOWAPP_ID_BROADCAST || peer == LOWAPP_ID_MULTICAST) {
+		return;
+	}
+	if(_powerCtrlMode && peers[peer].link_power != 0) {
+		*power = peers[peer].link_power;
+	}
+	entry = neigh_find(peer);
+	if(!_linkAdaptMode || entry == NULL) {
+		return;
+	}
+	/* Lowest SF with enough margin over its demodulation floor (average SNR in 1/16 dB) */
+	if(entry->lastSeen != 0) {
+		while(*sf < maxSf &&
+				entry->snrAvg < (linkSnrFloor[*sf-MIN_SPREADINGFACTOR] + 2*LINK_SNR_MARGIN)*8) {
+			(*sf)++;
+		}
+	}
+	/* Missing ACK: more robust coding first, as it costs less airtime than a higher SF */
+	if(entry->fails > 0) {
+		*cr = LINK_MAX_CODERATE;
+		*sf += entry->fails - 1;
+		if(*sf > maxSf) {
+			*sf = maxSf;
+		}
+	}
+	LOG(LOG_INFO, "Link to %u: SF%u CR4/%u %ddBm", peer, *sf, *cr+4, *power);
+}
+
+/**
+ * Configure the radio with the given parameters if it is not already the case
+ *
+ * The standard preamble length is adapted to the SF in order to keep the
+ * preamble time.
+ *
+ * @param sf Spreading factor
+ * @param cr Coding rate
+ * @param power Transmit power (in dBm)
+ */
+void link_set_radio(uint8_t sf, uint8_t cr, int8_t power) {
+	/* Nothing to do before the configuration is loaded */
+	if(linkRadioSf == 0 || sf < MIN_SPREADINGFACTOR || sf > MAX_SPREADINGFACTOR) {
+		return;
+	}
+	if(sf == linkRadioSf && cr == linkRadioCr && power == linkRadioPower) {
+		return;
+	}
+	linkRadioSf = sf;
+	linkRadioCr = cr;
+	linkRadioPower = power;
+	set_radio_config(sf, cr, linkPreambleLen[sf-MIN_SPREADINGFACTOR], power);
+}
+
+/**
+ * Use the transmit power of the link to a peer on the current SF
+ *
+ * Used before sending an ACK to that peer.
+ *
+ * @param peer Device id of the destination
+ */
+void link_set_power(uint8_t peer) {
+	int8_t power = _power;
+	if(_powerCtrlMode && peers[peer].link_power != 0) {
+		power = peers[peer].link_power;
+	}
+	link_set_radio(linkRadioSf, linkRadioCr, power);
+}
+
+/**
+ * Build the link margin report of a received frame
+ *
+ * The margin is the SNR of the frame above the demodulation floor of the SF it
+ * was received with.
+ *
+ * @param snr SNR of the received frame (dB)
+ * @return The value of the ACK header rfu field
+ */
+uint16_t link_margin_report(int8_t snr) {
+	if(linkRadioSf < MIN_SPREADINGFACTOR || linkRadioSf > MAX_SPREADINGFACTOR) {
+		return 0;
+	}
+	int16_t margin = snr - linkSnrFloor[linkRadioSf-MIN_SPREADINGFACTOR]/2;
+	if(margin > INT8_MAX) {
+		margin = INT8_MAX;
+	}
+	else if(margin < INT8_MIN) {
+		margin = INT8_MIN;
+	}
+	return LINK_MARGIN_FLAG | (uint8_t)margin;
+}
+
+/**
+ * Adjust the transmit power towards a peer from the margin reported in its ACK
+ *
+ * @param peer Device id of the sender of the ACK
+ * @param report Header rfu field of the ACK
+ */
+void link_power_feedback(uint8_t peer, uint16_t report) {
+	if(!_powerCtrlMode || (report & LINK_MARGIN_FLAG) == 0) {
+		return;
+	}
+	int8_t margin = (int8_t)(report & 0xFF);
+	int16_t power = peers[peer].link_power != 0 ? peers[peer].link_power : _power;
+	if(margin > LINK_POWER_TARGET_MARGIN + LINK_POWER_HYSTERESIS) {
+		/* Step down slowly */
+		power -= LINK_POWER_STEP;
+	}
+	else if(margin < LINK_POWER_TARGET_MARGIN) {
+		/* Step up straight to the target */
+		power += LINK_POWER_TARGET_MARGIN - margin;
+	}
+	if(power < LINK_MIN_POWER) {
+		power = LINK_MIN_POWER;
+	}
+	if(power >= _power) {
+		power = 0;
+	}
+	if(power != peers[peer].link_power) {
+		LOG(LOG_INFO, "Link to %u: margin %d dB, power %d dBm", peer, margin, power != 0 ? power : _power);
+		peers[peer].link_power = power;
+	}
+}
+
+/**
+ * Go back to the group coding rate on the current SF
+ *
+ * Used after a transmission, before listening for the ACK.
+ */
+void link_restore_coderate(void) {
+	link_set_radio(linkRadioSf, _coderate, linkRadioPower);
+}
+
+/**
+ * Move the CAD scan on to the next candidate SF
+ *
+ * @retval True If the radio was set up for the next SF
+ * @retval False If all the candidate SF have been scanned
+ */
+bool link_scan_next(void) {
+	if(linkRadioSf >= link_max_sf()) {
+		return false;
+	}
+	link_set_radio(linkRadioSf+1, _coderate, linkRadioPower);
+	return true;
+}
+
+/** @} */
+/** @} */
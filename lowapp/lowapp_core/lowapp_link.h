@@ -0,0 +1,25 @@
+/**
+ * @file lowapp_link.h
+ * @brief LoWAPP per-link adaptation
+ *
+ * Defines the functions used to choose the spreading factor, coding rate and
+ * transmit power of each link from the observed link quality.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_LINK_H_
+#define LOWAPP_CORE_LINK_H_
+
+void link_update_radio(void);
+void link_ack_result(uint8_t peer, bool acked);
+void link_select(uint8_t peer, uint8_t* sf, uint8_t* cr, int8_t* power);
+void link_set_radio(uint8_t sf, uint8_t cr, int8_t power);
+void link_set_power(uint8_t peer);
+uint16_t link_margin_report(int8_t snr);
+void link_power_feedback(uint8_t peer, uint16_t report);
+void link_restore_coderate(void);
+bool link_scan_next(void);
+
+#endif
@@ -0,0 +1,198 @@
+/**
+ * @file lowapp_mbox.c
+ * @brief LoWAPP store-and-forward mailbox
+ *
+ * When the mailbox mode is enabled, a unicast message which was not
+ * acknowledged, or could not be transmitted at all, is not dropped but parked
+ * in the mailbox. It is queued for transmission again only when its
+ * destination is heard again, instead of being retried blindly while the
+ * destination is asleep or out of range.
+ *
+ * The mailbox holds at most #MBOX_SIZE messages, and #MBOX_PER_DEST for a
+ * single destination: the oldest message is dropped to make room for a new one.
+ * A message is parked at most #MBOX_MAX_ATTEMPTS times, and a message past its
+ * deadline is never parked.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+extern const uint8_t jsonMboxParked[];
+extern const uint8_t jsonMboxCount[];
+extern const uint8_t jsonSuffix[];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_mbox LoWAPP Core Mailbox
+ * @brief Store-and-forward of the messages to unreachable peers
+ * @{
+ */
+
+/** Parked messages, oldest first */
+static MSG_T* mbox[MBOX_SIZE];
+
+/** Number of parked messages */
+static uint8_t mboxCount = 0;
+
+/** Message sent and waiting for its ACK */
+static MSG_T* mboxInFlight = NULL;
+
+/**
+ * Remove a message from the mailbox, keeping the order of the others
+ *
+ * @param pos Position of the message in the mailbox
+ * @return The message removed
+ */
+static MSG_T* mbox_remove(uint8_t pos) {
+	MSG_T* msg = mbox[pos];
+	mboxCount--;
+	memmove(&mbox[pos], &mbox[pos+1], (mboxCount - pos) * sizeof(MSG_T*));
+	mbox[mboxCount] = NULL;
+	return msg;
+}
+
+/**
+ * Send the number of messages parked for a destination to the application
+ *
+ * @param dest Device id of the destination
+ * @param count Number of messages parked for the destination
+ */
+static void mbox_report(uint8_t dest, uint8_t count) {
+	uint8_t bufCmd[40] = "";
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	sizeStr = strlen((char*)jsonMboxParked);
+	memcpy(bufCmd, jsonMboxParked, sizeStr);
+	offset += sizeStr;
+	offset = FillBufferHexBI8_t(bufCmd, offset, &dest, 1, false);
+	sizeStr = strlen((char*)jsonMboxCount);
+	memcpy(bufCmd+offset, jsonMboxCount, sizeStr);
+	offset += sizeStr;
+	offset = FillBuffer8_t(bufCmd, offset, &count, 1, false);
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(bufCmd+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(bufCmd, offset);
+}
+
+/**
+ * Keep a unicast message sent until its ACK is received
+ *
+ * @param msg Message sent
+ */
+void mbox_sent(MSG_T* msg) {
+	if(mboxInFlight != NULL) {
+		/* The outcome of the previous message is unknown, do not risk a duplicate */
+		msg_free(mboxInFlight);
+	}
+	mboxInFlight = msg;
+}
+
+/**
+ * The message sent was acknowledged
+ */
+void mbox_delivered(void) {
+	if(mboxInFlight != NULL) {
+		msg_free(mboxInFlight);
+		mboxInFlight = NULL;
+	}
+}
+
+/**
+ * The message sent was not acknowledged, park it
+ */
+void mbox_failed(void) {
+	if(mboxInFlight != NULL) {
+		if(!mbox_park(mboxInFlight)) {
+			msg_free(mboxInFlight);
+		}
+		mboxInFlight = NULL;
+	}
+}
+
+/**
+ * Park an undelivered message until its destination is heard again
+ *
+ * @param msg Message which could not be delivered
+ * @retval True If the message was parked
+ * @retval False If the message cannot be parked, and must be freed
+ */
+bool mbox_park(MSG_T* msg) {
+	uint8_t dest = msg->content.std.destId;
+	uint8_t i, nDest = 0, oldest = MBOX_SIZE;
+	if(!_mailboxMode || dest < MIN_DEVICE_ID || dest > MAX_DEVICE_ID
+			|| (msg->hdr.type != TYPE_STDMSG && msg->hdr.type != TYPE_RELAY)) {
+		return false;
+	}
+	/* A ping measures the link as it is now */
+	if(msg->key == TXQ_KEY_PING) {
+		return false;
+	}
+	if(msg->retry >= MBOX_MAX_ATTEMPTS) {
+		LOG(LOG_INFO, "Message to %u dropped after %u attempts", dest, msg->retry);
+		return false;
+	}
+	if(msg->deadline != 0 && (int32_t)(msg->deadline - (uint32_t)_sys->SYS_getTimeMs()) <= 0) {
+		return false;
+	}
+	for(i = 0; i < mboxCount; ++i) {
+		if(mbox[i]->content.std.destId == dest) {
+			if(nDest == 0) {
+				oldest = i;
+			}
+			nDest++;
+		}
+	}
+	/* Make room, dropping the oldest message of the destination or of all */
+	if(nDest >= MBOX_PER_DEST || mboxCount >= MBOX_SIZE) {
+		if(nDest < MBOX_PER_DEST) {
+			oldest = 0;
+		}
+		if(mbox[oldest]->content.std.destId == dest) {
+			nDest--;
+		}
+		LOG(LOG_WARN, "Mailbox full, dropping message to %u", mbox[oldest]->content.std.destId);
+		msg_free(mbox_remove(oldest));
+	}
+	msg->retry++;
+	mbox[mboxCount++] = msg;
+	LOG(LOG_INFO, "Message to %u parked in mailbox", dest);
+	mbox_report(dest, nDest+1);
+	return true;
+}
+
+/**
+ * Queue the messages parked for a peer which was just heard
+ *
+ * @param peer Device id of the peer heard
+ */
+void mbox_heard(uint8_t peer) {
+	uint8_t i = 0;
+	while(i < mboxCount) {
+		if(mbox[i]->content.std.destId != peer) {
+			i++;
+			continue;
+		}
+		LOG(LOG_INFO, "Node %u heard, sending parked message again", peer);
+		/* The message is freed by lowapp_tx if the queue is full */
+		lowapp_tx(mbox_remove(i));
+	}
+}
+
+/**
+ * Free all the messages of the mailbox
+ */
+void mbox_clear(void) {
+	while(mboxCount > 0) {
+		msg_free(mbox_remove(mboxCount-1));
+	}
+	mbox_delivered();
+}
+
+/** @} */
+/** @} */
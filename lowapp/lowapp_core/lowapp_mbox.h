@@ -0,0 +1,22 @@
+/**
+ * @file lowapp_mbox.h
+ * @brief LoWAPP store-and-forward mailbox
+ *
+ * Defines the functions used to keep the unicast messages which could not be
+ * delivered until their destination is heard again.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_MBOX_H_
+#define LOWAPP_CORE_MBOX_H_
+
+void mbox_sent(MSG_T* msg);
+void mbox_delivered(void);
+void mbox_failed(void);
+bool mbox_park(MSG_T* msg);
+void mbox_heard(uint8_t peer);
+void mbox_clear(void);
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * @file lowapp_mcast.c
+ * @brief LoWAPP multicast messages
+ *
+ * A multicast message is a standard message sent to #LOWAPP_ID_MULTICAST. The
+ * first byte of its payload is the number of destinations, followed by their
+ * device ids, followed by the data. It is sent with the group radio
+ * configuration, like broadcast messages.
+ *
+ * Each listed destination sends its ACK in its own slot, in the order of the
+ * list, the first slot starting #TIMER_ACK_SLOT_START after the message. The
+ * sender collects all the ACK in a single reception window, reports the
+ * destinations which acknowledged the message and the missing ones, and sends
+ * the message again to the missing ones only, up to #MCAST_MAX_RETRY times.
+ *
+ * Multicast messages carry their own sequence number, shared by their retries,
+ * and do not take part in the sequence numbers of the unicast links.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+extern uint16_t timer_safeguard_txing_ack;
+
+extern const uint8_t jsonNokTx[];
+extern const uint8_t jsonErrorTxFail[];
+extern const uint8_t jsonSuffix[];
+extern const uint8_t jsonMcastAcked[];
+extern const uint8_t jsonMcastMissing[];
+extern const uint8_t jsonMcastRetry[];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_mcast LoWAPP Core Multicast
+ * @brief Multicast messages and sequential ACK slots
+ * @{
+ */
+
+/** Multicast message sent, waiting for its ACK */
+static MSG_T* mcastMsg = NULL;
+
+/** ACK received for the current multicast message (one bit per slot) */
+static uint8_t mcastAcked = 0;
+
+/** Local time (in ms) at which the ACK reception window ends */
+static uint64_t mcastListenEnd = 0;
+
+/** Last multicast sequence number used */
+static uint8_t mcastSeq = 0;
+
+/**
+ * Get the length of an ACK slot
+ *
+ * @return The slot length in ms, for the current radio configuration
+ */
+uint32_t mcast_slot_length(void) {
+	return timer_safeguard_txing_ack + 2*MCAST_ACK_GUARD;
+}
+
+/**
+ * Get the number of destinations of a multicast message
+ *
+ * @param payload Payload of the multicast message
+ * @param length Length of the payload
+ * @return The number of destinations
+ * @retval 0 If the destination list is invalid
+ */
+static uint8_t mcast_count(const uint8_t* payload, uint8_t length) {
+	uint8_t nDest;
+	if(length == 0) {
+		return 0;
+	}
+	nDest = payload[0];
+	if(nDest > MCAST_MAX_DEST || nDest+1 > length) {
+		return 0;
+	}
+	return nDest;
+}
+
+/**
+ * Find the slot of a device in the destination list of a multicast message
+ *
+ * @param payload Payload of the multicast message
+ * @param length Length of the payload
+ * @param id Device id to look for
+ * @return The slot of the device
+ * @retval -1 If the device is not listed
+ */
+static int8_t mcast_slot(const uint8_t* payload, uint8_t length, uint8_t id) {
+	uint8_t i, nDest = mcast_count(payload, length);
+	for(i = 0; i < nDest; ++i) {
+		if(payload[1+i] == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Fill a standard message with a destination list and data
+ *
+ * @param msg Message to fill
+ * @param ids Device ids of the destinations
+ * @param nDest Number of destinations (up to #MCAST_MAX_DEST)
+ * @param data Data to send
+ * @param size Size of the data in bytes
+ */
+void mcast_fill(MSG_T* msg, const uint8_t* ids, uint8_t nDest, const uint8_t* data, uint8_t size) {
+	msg->content.std.destId = LOWAPP_ID_MULTICAST;
+	msg->content.std.payload[0] = nDest;
+	memcpy(msg->content.std.payload+1, ids, nDest);
+	memcpy(msg->content.std.payload+1+nDest, data, size);
+	msg->hdr.payloadLength = 1+nDest+size;
+}
+
+/**
+ * Check whether this device is a destination of a multicast message
+ *
+ * @param view Received multicast frame
+ * @retval True If the device is listed
+ * @retval False Otherwise
+ */
+bool mcast_listed(const FRAME_VIEW_T* view) {
+	return mcast_slot(view->payload, view->hdr.payloadLength, _deviceId) >= 0;
+}
+
+/**
+ * Accept a multicast message this device is a destination of
+ *
+ * The destination list is skipped in the payload of the frame, so that only
+ * the data is forwarded to the application.
+ *
+ * @param view Received multicast frame
+ * @return The delay (in ms) before sending the ACK in our slot
+ */
+uint32_t mcast_accept(FRAME_VIEW_T* view) {
+	int8_t slot = mcast_slot(view->payload, view->hdr.payloadLength, _deviceId);
+	uint8_t nDest = mcast_count(view->payload, view->hdr.payloadLength);
+	view->hdr.payloadLength -= 1+nDest;
+	view->payload += 1+nDest;
+	if(slot < 0) {
+		slot = 0;
+	}
+	return TIMER_ACK_SLOT_START + slot*mcast_slot_length() + MCAST_ACK_GUARD;
+}
+
+/**
+ * Get the time during which the destinations of a multicast message send ACK
+ *
+ * @param view Received multicast frame
+ * @return The time (in ms) from the end of the message to the end of the last
+ * ACK slot
+ */
+uint32_t mcast_window(const FRAME_VIEW_T* view) {
+	uint8_t nDest = mcast_count(view->payload, view->hdr.payloadLength);
+	if(nDest == 0) {
+		return TIMER_ACK_SLOT_START+TIMER_ACK_SLOT_LENGTH;
+	}
+	return TIMER_ACK_SLOT_START + nDest*mcast_slot_length();
+}
+
+/**
+ * Get the sequence number of a new multicast message
+ *
+ * @return The sequence number, never 0
+ */
+uint8_t mcast_next_seq(void) {
+	mcastSeq = (mcastSeq % 255) + 1;
+	return mcastSeq;
+}
+
+/**
+ * Start waiting for the ACK of a multicast message which was just sent
+ *
+ * @param msg Multicast message sent, owned by this module until #mcast_finish
+ */
+void mcast_start(MSG_T* msg) {
+	if(mcastMsg != NULL) {
+		msg_free(mcastMsg);
+	}
+	mcastMsg = msg;
+	mcastAcked = 0;
+	mcastListenEnd = 0;
+}
+
+/**
+ * Check whether a multicast message is waiting for its ACK
+ *
+ * @retval True If ACK are expected for a multicast message
+ * @retval False Otherwise
+ */
+bool mcast_active(void) {
+	return mcastMsg != NULL;
+}
+
+/**
+ * Get the time left in the ACK reception window
+ *
+ * The window starts with the first call, at the beginning of the first slot.
+ *
+ * @return The time left in ms
+ */
+uint32_t mcast_listen_time(void) {
+	uint64_t now = _sys->SYS_getTimeMs();
+	if(mcastMsg == NULL) {
+		return 0;
+	}
+	if(mcastListenEnd == 0) {
+		mcastListenEnd = now + mcast_count(mcastMsg->content.std.payload, mcastMsg->hdr.payloadLength)*mcast_slot_length() + timer_safeguard_txing_ack;
+	}
+	if(now >= mcastListenEnd) {
+		return 0;
+	}
+	return mcastListenEnd - now;
+}
+
+/**
+ * Record an ACK received for the current multicast message
+ *
+ * @param ack ACK received
+ * @retval True If all the destinations have acknowledged the message
+ * @retval False Otherwise
+ */
+bool mcast_ack(MSG_T* ack) {
+	int8_t slot;
+	uint8_t nDest;
+	if(mcastMsg == NULL || ack->content.ack.rxdSeq != mcastMsg->content.std.txSeq) {
+		return false;
+	}
+	slot = mcast_slot(mcastMsg->content.std.payload, mcastMsg->hdr.payloadLength, ack->content.ack.srcId);
+	if(slot >= 0) {
+		LOG(LOG_INFO, "Multicast ACK from %u (slot %d)", ack->content.ack.srcId, slot);
+		mcastAcked |= 1 << slot;
+	}
+	nDest = mcast_count(mcastMsg->content.std.payload, mcastMsg->hdr.payloadLength);
+	return mcastAcked == (uint8_t)((1 << nDest) - 1);
+}
+
+/**
+ * Append a list of device ids to a response
+ *
+ * @param buffer Response buffer
+ * @param offset Offset in the buffer
+ * @param acked True to list the destinations which acknowledged the message,
+ * false to list the missing ones
+ * @return The new offset in the buffer
+ */
+static uint8_t mcast_fill_ids(uint8_t* buffer, uint8_t offset, bool acked) {
+	uint8_t i, nDest = mcast_count(mcastMsg->content.std.payload, mcastMsg->hdr.payloadLength);
+	bool first = true;
+	for(i = 0; i < nDest; ++i) {
+		if(((mcastAcked >> i) & 1) != acked) {
+			continue;
+		}
+		if(!first) {
+			buffer[offset++] = ',';
+		}
+		offset = FillBufferHexBI8_t(buffer, offset, &mcastMsg->content.std.payload[1+i], 1, false);
+		first = false;
+	}
+	return offset;
+}
+
+/**
+ * End the ACK reception window of the current multicast message
+ *
+ * Reports the delivery to each destination to the application, and queues the
+ * message again for the missing destinations if retries are left.
+ */
+void mcast_finish(void) {
+	uint8_t buffer[100] = "";
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	uint8_t i, nMissing = 0, nDest;
+	if(mcastMsg == NULL) {
+		return;
+	}
+	nDest = mcast_count(mcastMsg->content.std.payload, mcastMsg->hdr.payloadLength);
+	for(i = 0; i < nDest; ++i) {
+		link_ack_result(mcastMsg->content.std.payload[1+i], (mcastAcked >> i) & 1);
+		neigh_ack(mcastMsg->content.std.payload[1+i], (mcastAcked >> i) & 1);
+		if(((mcastAcked >> i) & 1) == 0) {
+			nMissing++;
+		}
+	}
+
+	/* Build the JSON message */
+	if(nMissing == 0) {
+		sizeStr = strlen("OK TX");
+		memcpy(buffer+offset, "OK TX", sizeStr);
+	}
+	else {
+		sizeStr = strlen((char*)jsonNokTx);
+		memcpy(buffer+offset, jsonNokTx, sizeStr);
+	}
+	offset += sizeStr;
+	sizeStr = strlen((char*)jsonMcastAcked);
+	memcpy(buffer+offset, jsonMcastAcked, sizeStr);
+	offset += sizeStr;
+	offset = mcast_fill_ids(buffer, offset, true);
+	if(nMissing > 0) {
+		sizeStr = strlen((char*)jsonMcastMissing);
+		memcpy(buffer+offset, jsonMcastMissing, sizeStr);
+		offset += sizeStr;
+		offset = mcast_fill_ids(buffer, offset, false);
+		sizeStr = strlen((char*)jsonMcastRetry);
+		memcpy(buffer+offset, jsonMcastRetry, sizeStr);
+		offset += sizeStr;
+		if(mcastMsg->retry < MCAST_MAX_RETRY) {
+			uint8_t retry = mcastMsg->retry + 1;
+			offset = FillBuffer8_t(buffer, offset, &retry, 1, false);
+		}
+		else {
+			memcpy(buffer+offset, "MAX", 3);
+			offset += 3;
+		}
+	}
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(buffer+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(buffer, offset);
+
+	if(nMissing > 0 && mcastMsg->retry < MCAST_MAX_RETRY) {
+		/* Keep the missing destinations only, in their original order */
+		uint8_t ids[MCAST_MAX_DEST];
+		uint8_t dataLength = mcastMsg->hdr.payloadLength-1-nDest;
+		nMissing = 0;
+		for(i = 0; i < nDest; ++i) {
+			if(((mcastAcked >> i) & 1) == 0) {
+				ids[nMissing++] = mcastMsg->content.std.payload[1+i];
+			}
+		}
+		memmove(mcastMsg->content.std.payload+1+nMissing, mcastMsg->content.std.payload+1+nDest, dataLength);
+		memcpy(mcastMsg->content.std.payload+1, ids, nMissing);
+		mcastMsg->content.std.payload[0] = nMissing;
+		mcastMsg->hdr.payloadLength = 1+nMissing+dataLength;
+		mcastMsg->retry++;
+		/* A retry must not replace a newer message */
+		mcastMsg->key = 0;
+		LOG(LOG_INFO, "Multicast retry %u to %u destinations", mcastMsg->retry, nMissing);
+		/* The message is freed by lowapp_tx if the queue is full, the retry announced is then lost */
+		if(lowapp_tx(mcastMsg) < 0) {
+			LOG(LOG_ERR, "Multicast retry dropped, TX queue full");
+			_sys->SYS_cmdResponse((uint8_t*)jsonErrorTxFail, strlen((char*)jsonErrorTxFail));
+		}
+	}
+	else {
+		msg_free(mcastMsg);
+	}
+	mcastMsg = NULL;
+}
+
+/** @} */
+/** @} */
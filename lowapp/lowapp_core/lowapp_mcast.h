@@ -0,0 +1,27 @@
+/**
+ * @file lowapp_mcast.h
+ * @brief LoWAPP multicast messages
+ *
+ * Defines the functions used to send a standard message to a list of
+ * destinations and to collect their ACK in sequential slots.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_MCAST_H_
+#define LOWAPP_CORE_MCAST_H_
+
+uint32_t mcast_slot_length(void);
+void mcast_fill(MSG_T* msg, const uint8_t* ids, uint8_t nDest, const uint8_t* data, uint8_t size);
+bool mcast_listed(const FRAME_VIEW_T* view);
+uint32_t mcast_accept(FRAME_VIEW_T* view);
+uint32_t mcast_window(const FRAME_VIEW_T* view);
+uint8_t mcast_next_seq(void);
+void mcast_start(MSG_T* msg);
+bool mcast_active(void);
+uint32_t mcast_listen_time(void);
+bool mcast_ack(MSG_T* ack);
+void mcast_finish(void);
+
+#endif
@@ -12,7 +12,6 @@
 #include "utilities.h"
 #include <math.h>
 
-extern QFIXED_T _rx_pkt_list;
 extern const uint32_t bandwidthValues[];
 
 /* Static function prototypes */
@@ -70,6 +69,52 @@ const uint8_t errorMsgMissingConfiguration[] = "\", \"errstr\":\"Missing or inco
 /** AT command invalid size error message */
 const uint8_t errorMsgAtCmdInvalidSize[] = "AT COMMAND TOO LONG";
 
+/** Priority json following the status of a send request */
+const uint8_t jsonSendPriority[] = " {\"priority\":\"";
+/** Credits json following the priority of a send request */
+const uint8_t jsonSendCredits[] = "\",\"credits\":\"";
+
+/** List of the destinations which acknowledged a multicast message json */
+const uint8_t jsonMcastAcked[] = " {\"acked\":\"";
+/** List of the destinations which did not acknowledge a multicast message json */
+const uint8_t jsonMcastMissing[] = "\",\"missing\":\"";
+/** Multicast retry json */
+const uint8_t jsonMcastRetry[] = "\",\"retry\":\"";
+
+/** Mailbox json, when an undelivered message is parked */
+const uint8_t jsonMboxParked[] = "MAILBOX {\"dest\":\"";
+/** Mailbox json, number of messages parked for the destination */
+const uint8_t jsonMboxCount[] = "\",\"count\":\"";
+
+/** Neighbour discovery json, number of neighbours which replied */
+const uint8_t jsonHelloCount[] = "HELLO {\"count\":\"";
+/** Neighbour discovery json, list of neighbours which replied */
+const uint8_t jsonHelloNodes[] = "\",\"nodes\":\"";
+
+/** Ping json, result of a single ping */
+const uint8_t jsonPingPrefix[] = "PING {\"dest\":\"";
+/** Ping json, sequence number of the ping */
+const uint8_t jsonPingSeq[] = "\",\"seq\":\"";
+/** Ping json, round-trip time */
+const uint8_t jsonPingRtt[] = "\",\"rtt\":\"";
+/** Ping json, RSSI of the ACK */
+const uint8_t jsonPingRssi[] = "\",\"rssi\":\"";
+/** Ping json, lost ping */
+const uint8_t jsonPingLost[] = "\",\"lost\":\"1";
+/** Ping json, number of pings sent */
+const uint8_t jsonPingSent[] = "\",\"sent\":\"";
+/** Ping json, number of pings acknowledged */
+const uint8_t jsonPingReceived[] = "\",\"received\":\"";
+/** Ping json, minimum round-trip time */
+const uint8_t jsonPingMin[] = "\",\"min\":\"";
+/** Ping json, average round-trip time */
+const uint8_t jsonPingAvg[] = "\",\"avg\":\"";
+/** Ping json, maximum round-trip time */
+const uint8_t jsonPingMax[] = "\",\"max\":\"";
+
+/** Route list json key */
+const uint8_t jsonRoutes[] = "routes\":\"";
+
 /** Prefix for NOK TX retry json */
 const uint8_t jsonPrefixNokTxRetry[] = "NOK TX {\"retry\":\"";
 /** Max retry reached error message */
@@ -81,8 +126,12 @@ const uint8_t jsonErrorTxFail[] = "NOK TX {\"status\":\"FAILED\"}";
 const uint8_t jsonNokTx[] = "NOK TX";
 /** NOK for RXERROR json response */
 const uint8_t jsonNokTxRxError[] = "NOK TX {\"status\":\"RXERROR\"}";
+/** NOK for expired message json response */
+const uint8_t jsonNokTxExpired[] = "NOK TX {\"status\":\"EXPIRED\"}";
 /** NOK for RXTIMEOUT json response */
 const uint8_t jsonNokTxRxTimeout[] = "NOK TX {\"status\":\"RXTIMEOUT\"}";
+/** NOK for a received message dropped because the RX queue was full */
+const uint8_t jsonNokRxQueueFull[] = "NOK RX {\"status\":\"QUEUE FULL\"}";
 
 /** Statistics for AT+WHO command prefix for json response */
 const uint8_t jsonWhoPrefix[] = "OK {\"wholist\":[";
@@ -92,6 +141,16 @@ const uint8_t jsonWhoDevice[] = "{\"deviceId\":";
 const uint8_t jsonWhoLastRssi[] = ",\"lastRssi\":";
 /** Last seen time for WHO statistics json response */
 const uint8_t jsonWhoLastSeen[] = ",\"lastSeen\":\"";
+/** Average RSSI for WHO statistics json response */
+const uint8_t jsonWhoRssi[] = "\",\"rssi\":";
+/** Average SNR for WHO statistics json response */
+const uint8_t jsonWhoSnr[] = ",\"snr\":";
+/** Packet reception ratio (%) for WHO statistics json response */
+const uint8_t jsonWhoPrr[] = ",\"prr\":";
+/** ACK success rate (%) for WHO statistics json response */
+const uint8_t jsonWhoAck[] = ",\"ack\":";
+/** Last CAD phase for WHO statistics json response */
+const uint8_t jsonWhoCadPhase[] = ",\"cadPhase\":";
 /** Suffix for WHO statistics json response */
 const uint8_t jsonWhoSuffix[] = "]}";
 
@@ -124,8 +183,6 @@ uint16_t makeNonce() {
  * @param sizeToEncode Size of the data to encode
  */
 static void encodeInPlace(uint8_t _appKey[], uint16_t randomValueForNonce, uint8_t* startEncode, uint16_t sizeToEncode) {
-	/* Temporary encryption buffer */
-	uint8_t encryptedBuffer[256] = {0};
 	/* Actual key used for AES encryption (currently on 128 bits) */
 	uint8_t actualKey[ENCKEY_SIZE] = {0};
 	uint32_t actualNonce;
@@ -137,9 +194,8 @@ static void encodeInPlace(uint8_t _appKey[], uint16_t randomValueForNonce, uint8
 		/* XOR between _encryptionKey and the actualNonce variable */
 		actualKey[i] |= _encryptionKey[i] ^ ((actualNonce >> (4*(i/4))) & 0xFF);
 	}
-	/* Encode into a buffer */
-	LoRaMacPayloadEncrypt(startEncode, sizeToEncode, _appKey, 0, 0, 0, encryptedBuffer);
-	memcpy(startEncode, encryptedBuffer, sizeToEncode);
+	/* Counter mode works byte per byte, the output can overwrite the input */
+	LoRaMacPayloadEncrypt(startEncode, sizeToEncode, _appKey, 0, 0, 0, startEncode);
 }
 
 /**
@@ -150,7 +206,6 @@ static void encodeInPlace(uint8_t _appKey[], uint16_t randomValueForNonce, uint8
  * @param sizeToEncode Size of the data to decode
  */
 static void decodeInPlace(uint8_t _appKey[], uint16_t randomValueForNonce, uint8_t* encBuf, uint16_t sizeToEncode) {
-	uint8_t decBuffer[256] = {0};
 	/* Actual key used for AES encryption (currently on 128 bits) */
 	uint8_t actualKey[ENCKEY_SIZE] = {0};
 	uint32_t actualNonce;
@@ -162,9 +217,32 @@ static void decodeInPlace(uint8_t _appKey[], uint16_t randomValueForNonce, uint8
 		/* XOR between a pair of bytes from the 32-bytes _encryptionKey and the actualNonce variable */
 		actualKey[i] |= _encryptionKey[i] ^ ((actualNonce >> (4*(i/4))) & 0xFF);
 	}
-	/* Decode into a buffer */
-	LoRaMacPayloadDecrypt(encBuf, sizeToEncode, _appKey, 0, 0, 0, decBuffer);
-	memcpy(encBuf, decBuffer, sizeToEncode);
+	/* Counter mode works byte per byte, the output can overwrite the input */
+	LoRaMacPayloadDecrypt(encBuf, sizeToEncode, _appKey, 0, 0, 0, encBuf);
+}
+
+/**
+ * Hash of the group id, sent in the hint of a frame
+ * @return The two bytes of the group id folded into one
+ */
+static uint8_t groupHash(void) {
+	return (_groupId >> 8) ^ (_groupId & 0xFF);
+}
+
+/**
+ * Check whether a message is sent with a cleartext hint
+ *
+ * Only the standard and relayed messages carry a hint, when #_hintMode is set
+ * and the frame leaves room for it.
+ *
+ * @param msg Message to transmit
+ * @retval True If the frame of the message starts with a hint
+ * @retval False Otherwise
+ */
+static bool frameHinted(MSG_T *msg) {
+	return _hintMode
+			&& (msg->hdr.type == TYPE_STDMSG || msg->hdr.type == TYPE_RELAY)
+			&& msg->hdr.payloadLength + FRAME_HINT_SIZE <= MAX_PAYLOAD_STD_SIZE;
 }
 
 /**
@@ -177,18 +255,31 @@ uint8_t frameSize(MSG_T *msg) {
 	/* Check frame type */
 	switch(msg->hdr.type) {
 	case TYPE_STDMSG:
+	case TYPE_RELAY:
+	case TYPE_HELLO:
 		packetSize = sizeof(LORA_HDR_T)
 				+ 2	// Nonce
 				+ 3	// Standard type
 				+ msg->hdr.payloadLength
 				+ 2;	// CRC
+		if(frameHinted(msg)) {
+			packetSize += FRAME_HINT_SIZE;
+		}
 		break;
 	case TYPE_ACK:
+	case TYPE_NACK:
+	case TYPE_HELLO_REPLY:
 		packetSize = sizeof(LORA_HDR_T)
 				+ 2	// Nonce
 				+ sizeof(ACKMSG_T)
 				+ 2; // CRC
 		break;
+	case TYPE_WAKEUP:
+		packetSize = sizeof(LORA_HDR_T)
+				+ 2	// Nonce
+				+ sizeof(WAKEMSG_T)
+				+ 2; // CRC
+		break;
 	default:
 		packetSize = 0;
 		break;
@@ -204,16 +295,31 @@ uint8_t frameSize(MSG_T *msg) {
  */
 uint16_t buildFrame(uint8_t *frameBuffer, MSG_T *msg) {
 	uint8_t* ptrBuf;
+	uint8_t* ptrNonce;
 	uint16_t packetSize;
 	uint16_t crc;
 	/* Check frame type */
 	switch(msg->hdr.type) {
 	case TYPE_STDMSG:
+	case TYPE_RELAY:
+	case TYPE_HELLO:
 		ptrBuf = frameBuffer;
-		*ptrBuf = (msg->hdr.version << 4) | (msg->hdr.type);
-		ptrBuf++;
-		wrap_byte(&ptrBuf, msg->hdr.payloadLength);
-		wrap_short(&ptrBuf, msg->hdr.rfu);
+		if(frameHinted(msg)) {
+			*ptrBuf = (LOWAPP_HINT_VERSION << 4) | (msg->hdr.type);
+			ptrBuf++;
+			wrap_byte(&ptrBuf, msg->hdr.payloadLength);
+			wrap_short(&ptrBuf, msg->hdr.rfu);
+			/* Hint left in clear, covered by the CRC */
+			wrap_byte(&ptrBuf, msg->content.std.destId);
+			wrap_byte(&ptrBuf, groupHash());
+		}
+		else {
+			*ptrBuf = (msg->hdr.version << 4) | (msg->hdr.type);
+			ptrBuf++;
+			wrap_byte(&ptrBuf, msg->hdr.payloadLength);
+			wrap_short(&ptrBuf, msg->hdr.rfu);
+		}
+		ptrNonce = ptrBuf;
 		wrap_short(&ptrBuf, makeNonce());
 		wrap_byte(&ptrBuf, msg->content.std.destId);
 		wrap_byte(&ptrBuf, msg->content.std.srcId);
@@ -228,11 +334,13 @@ uint16_t buildFrame(uint8_t *frameBuffer, MSG_T *msg) {
 #pragma GCC diagnostic pop
 		wrap_short(&ptrBuf, crc);
 
-		/* Encode */
-		encodeInPlace(_encryptionKey, *((uint16_t*)(frameBuffer+4)), frameBuffer+6, msg->hdr.payloadLength+8);
+		/* Encode the content and the CRC */
+		encodeInPlace(_encryptionKey, *((uint16_t*)ptrNonce), ptrNonce+2, ptrBuf-ptrNonce-2);
 
 		return ptrBuf-frameBuffer;
 	case TYPE_ACK:
+	case TYPE_NACK:
+	case TYPE_HELLO_REPLY:
 		packetSize = 0;
 		packetSize += sizeof(LORA_HDR_T);
 		packetSize += 2;	// Nonce
@@ -261,6 +369,28 @@ uint16_t buildFrame(uint8_t *frameBuffer, MSG_T *msg) {
 		/* Encode */
 		encodeInPlace(_encryptionKey, *((uint16_t*)(frameBuffer+4)), frameBuffer+6, 6);
 
+		return ptrBuf-frameBuffer;
+	case TYPE_WAKEUP:
+		ptrBuf = frameBuffer;
+		*ptrBuf = (msg->hdr.version << 4) | (msg->hdr.type);
+		ptrBuf++;
+		wrap_byte(&ptrBuf, msg->hdr.payloadLength);
+		wrap_short(&ptrBuf, msg->hdr.rfu);
+		wrap_short(&ptrBuf, makeNonce());
+		wrap_byte(&ptrBuf, msg->content.wake.destId);
+		wrap_byte(&ptrBuf, msg->content.wake.srcId);
+		wrap_short(&ptrBuf, msg->content.wake.timeToData);
+
+		/* Compute CRC on full frame and add it to the end */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverflow"
+		crc = PacketComputeCrc(frameBuffer, ptrBuf-frameBuffer, POLYNOMIAL_IBM);
+#pragma GCC diagnostic pop
+		wrap_short(&ptrBuf, crc);
+
+		/* Encode */
+		encodeInPlace(_encryptionKey, *((uint16_t*)(frameBuffer+4)), frameBuffer+6, 6);
+
 		return ptrBuf-frameBuffer;
 	default:
 		return 0;
@@ -269,92 +399,192 @@ uint16_t buildFrame(uint8_t *frameBuffer, MSG_T *msg) {
 
 
 /**
- * Retrieve a message structure from a frame
- * @param[out] msg Message to be filled from the buffer
- * @param[in] frameBuffer Input frame buffer
- * @retval 0 If the message was filled successfully
+ * Check the cleartext hint at the start of a frame
+ *
+ * Only the first #FRAME_HINT_END bytes of the frame are read and nothing is
+ * decoded, so that the radio layer can stop the reception of a frame destined
+ * to another node while it is still on air.
+ *
+ * @param[in] frameBuffer Start of the frame
+ * @param length Number of bytes received so far
+ * @retval 0 If the frame has to be received: no hint, too short to tell, or
+ * for me, broadcast or multicast
+ * @retval -2 If the frame is destined to another node of the group
+ * @retval -5 If the frame is destined to another group
+ */
+int8_t frameHint(const uint8_t *frameBuffer, uint16_t length) {
+	uint8_t type = frameBuffer[0] & 0xF;
+	uint8_t dest;
+	if(length < FRAME_HINT_END || (frameBuffer[0] >> 4) != LOWAPP_HINT_VERSION
+			|| (type != TYPE_STDMSG && type != TYPE_RELAY)) {
+		return 0;
+	}
+	if(frameBuffer[sizeof(LORA_HDR_T)+1] != groupHash()) {
+		return -5;
+	}
+	dest = frameBuffer[sizeof(LORA_HDR_T)];
+	if(dest == _deviceId || dest == LOWAPP_ID_BROADCAST || dest == LOWAPP_ID_MULTICAST) {
+		return 0;
+	}
+	return -2;
+}
+
+/**
+ * Decode a frame in place and check it
+ *
+ * The content of the frame is decrypted once, in the reception buffer, and is
+ * not copied: the view points to it. A frame can thus be viewed only once.
+ * A frame dropped from its hint is not decoded, and its view has no content.
+ *
+ * @param[out] view View of the frame, cleared if the frame is too short for a
+ * header
+ * @param[in] frameBuffer Input frame buffer, decoded in place
+ * @param length Number of bytes received in the buffer
+ * @retval 0 If the frame is destined to me
  * @retval -1 If the message type was unknown
  * @retval -2 If the packet was not destined to me
- * @retval -3 If the CRC check failed
+ * @retval -3 If the CRC check failed, or the frame is shorter than its header says
  * @retval -4 If the version of the protocol is not the current version
+ * @retval -5 If the hint of the frame shows another group
  */
-int8_t retrieveMessage(MSG_T *msg, uint8_t *frameBuffer) {
+int8_t frameView(FRAME_VIEW_T *view, uint8_t *frameBuffer, uint16_t length) {
 	uint8_t* ptrBuf = frameBuffer;
 	uint16_t nonce;
+	uint16_t contentSize;
 	uint16_t crcComputed, crcRetrieved;
+	int8_t hint;
 
+	memset(view, 0, sizeof(FRAME_VIEW_T));
+	if(length < sizeof(LORA_HDR_T)+FRAME_NONCE_SIZE) {
+		return -3;
+	}
 	/* Copy header from the frame buffer */
-	msg->hdr.version = *ptrBuf >> 4;
-	msg->hdr.type = *ptrBuf & 0xF;
+	view->hdr.version = *ptrBuf >> 4;
+	view->hdr.type = *ptrBuf & 0xF;
 	ptrBuf++;
-	msg->hdr.payloadLength = parse_byte(&ptrBuf);
-	msg->hdr.rfu = parse_short(&ptrBuf);
+	view->hdr.payloadLength = parse_byte(&ptrBuf);
+	view->hdr.rfu = parse_short(&ptrBuf);
+
+	/* Drop the frames for other nodes from their hint, before decoding anything */
+	if(view->hdr.version == LOWAPP_HINT_VERSION
+			&& (view->hdr.type == TYPE_STDMSG || view->hdr.type == TYPE_RELAY)) {
+		hint = frameHint(frameBuffer, length);
+		if(hint != 0) {
+			return hint;
+		}
+		ptrBuf += FRAME_HINT_SIZE;
+		/* The hint belongs to the frame, not to the message */
+		view->hdr.version = LOWAPP_CURRENT_VERSION;
+		if(length < (ptrBuf-frameBuffer)+FRAME_NONCE_SIZE) {
+			return -3;
+		}
+	}
 	nonce = parse_short(&ptrBuf);
+	view->content = ptrBuf;
 
 	/* Check protocol version */
-	if(msg->hdr.version != LOWAPP_CURRENT_VERSION) {
+	if(view->hdr.version != LOWAPP_CURRENT_VERSION) {
 		return -4;
 	}
 
-	/* Check message type from header */
-	switch(msg->hdr.type) {
+	/* Size of the content from the message type */
+	switch(view->hdr.type) {
 	case TYPE_STDMSG:
-		/* Decode message */
-		decodeInPlace(_encryptionKey, nonce, ptrBuf, msg->hdr.payloadLength+8);
-		/* Copy message content */
-		msg->content.std.destId = parse_byte(&ptrBuf);
-		msg->content.std.srcId = parse_byte(&ptrBuf);
+	case TYPE_RELAY:
+	case TYPE_HELLO:
+		view->payload = ptrBuf+FRAME_STD_HDR_SIZE;
+		contentSize = FRAME_STD_HDR_SIZE+view->hdr.payloadLength;
+		break;
+	case TYPE_ACK:
+	case TYPE_NACK:
+	case TYPE_HELLO_REPLY:
+		contentSize = sizeof(ACKMSG_T);
+		break;
+	case TYPE_WAKEUP:
+		contentSize = sizeof(WAKEMSG_T);
+		break;
+	default:
+		return -1;
+	}
+	if(length < (ptrBuf-frameBuffer)+contentSize+FRAME_CRC_SIZE) {
+		return -3;
+	}
 
-		/* Check CRC */
-		crcRetrieved = get_short(ptrBuf+1+msg->hdr.payloadLength);
+	/* Decode the content and the CRC */
+	decodeInPlace(_encryptionKey, nonce, ptrBuf, contentSize+FRAME_CRC_SIZE);
+	crcRetrieved = get_short(ptrBuf+contentSize);
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Woverflow"
-		crcComputed = PacketComputeCrc(frameBuffer, ptrBuf+1+msg->hdr.payloadLength-frameBuffer, POLYNOMIAL_IBM);
+	crcComputed = PacketComputeCrc(frameBuffer, ptrBuf+contentSize-frameBuffer, POLYNOMIAL_IBM);
 #pragma GCC diagnostic pop
-		if(crcComputed != crcRetrieved) {
-			/* Wrong AES key assumed */
-			return -3;
-		}
+	if(crcComputed != crcRetrieved) {
+		/* Wrong AES key assumed */
+		return -3;
+	}
 
-		/* Check destination */
-		if(msg->content.std.destId == _deviceId || msg->content.std.destId == LOWAPP_ID_BROADCAST) {
-			msg->content.std.txSeq = parse_byte(&ptrBuf);
-			memcpy(msg->content.std.payload, ptrBuf, msg->hdr.payloadLength);
-			ptrBuf += msg->hdr.payloadLength;
+	/* Check destination */
+	if(FRAME_DEST(view) == _deviceId) {
+		return 0;
+	}
+	if(view->payload != NULL) {
+		if(FRAME_DEST(view) == LOWAPP_ID_BROADCAST) {
 			return 0;
 		}
-		else {
-			return -2;
+		/* The destination list of a multicast message is needed even if we are not listed */
+		if(FRAME_DEST(view) == LOWAPP_ID_MULTICAST) {
+			return mcast_listed(view) ? 0 : -2;
 		}
+	}
+	return -2;
+}
+
+/**
+ * Copy a frame view to a message structure
+ *
+ * @param[out] msg Message to be filled
+ * @param[in] view View of the frame, filled by #frameView
+ * @param withPayload True to copy the payload of a standard frame as well
+ */
+void frameToMessage(MSG_T *msg, const FRAME_VIEW_T *view, bool withPayload) {
+	uint8_t* ptrBuf = view->content;
+	uint8_t payloadLength = view->hdr.payloadLength;
+	msg->hdr = view->hdr;
+	if(ptrBuf == NULL) {
+		return;
+	}
+	switch(view->hdr.type) {
+	case TYPE_STDMSG:
+	case TYPE_RELAY:
+	case TYPE_HELLO:
+		msg->content.std.destId = parse_byte(&ptrBuf);
+		msg->content.std.srcId = parse_byte(&ptrBuf);
+		msg->content.std.txSeq = parse_byte(&ptrBuf);
+		if(withPayload && view->payload != NULL) {
+			if(payloadLength > MAX_PAYLOAD_STD_SIZE) {
+				payloadLength = MAX_PAYLOAD_STD_SIZE;
+			}
+			memcpy(msg->content.std.payload, view->payload, payloadLength);
+		}
+		break;
 	case TYPE_ACK:
-		/* Decode message */
-		decodeInPlace(_encryptionKey, nonce, ptrBuf, 6);
-		/* Copy message content */
+	case TYPE_NACK:
+	case TYPE_HELLO_REPLY:
 		msg->content.ack.destId = parse_byte(&ptrBuf);
 		msg->content.ack.srcId = parse_byte(&ptrBuf);
-
-		/* Check CRC */
-		crcRetrieved = get_short(ptrBuf+2);
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Woverflow"
-		crcComputed = PacketComputeCrc(frameBuffer, ptrBuf+2-frameBuffer, POLYNOMIAL_IBM);
-#pragma GCC diagnostic pop
-		if(crcComputed != crcRetrieved) {
-			/* Wrong AES key assumed */
-			return -3;
-		}
-
-		/* Check destination */
-		if(msg->content.ack.destId == _deviceId) {
-			msg->content.ack.rxdSeq = parse_byte(&ptrBuf);
-			msg->content.ack.expectedSeq = parse_byte(&ptrBuf);
-			return 0;
-		}
-		else {
-			return -2;
-		}
+		msg->content.ack.rxdSeq = parse_byte(&ptrBuf);
+		msg->content.ack.expectedSeq = parse_byte(&ptrBuf);
+		break;
+	case TYPE_WAKEUP:
+		msg->content.wake.destId = parse_byte(&ptrBuf);
+		msg->content.wake.srcId = parse_byte(&ptrBuf);
+		/*
+		 * Time to data is also needed by the nodes which are not the destination,
+		 * so that they can go back to sleep for the right amount of time
+		 */
+		msg->content.wake.timeToData = parse_short(&ptrBuf);
+		break;
 	default:
-		return -1;
+		break;
 	}
 }
 
@@ -438,33 +668,50 @@ static uint16_t buildJson(uint8_t **frameBuffer, MSG_RX_APP_T *msg_rx) {
 /**
  * Display received packets as JSON
  *
- * Returns all received packets since last check as JSON formatted string through SYS_cmdResponse
+ * Returns the packets received since last check as JSON formatted string through
+ * SYS_cmdResponse. At most #RXQ_POLL_MAX packets are returned, the others are
+ * kept in the RX queue for the next check, as well as the packets which could
+ * not be returned for lack of memory.
  */
 void response_rx_packets() {
 	uint8_t* buffer = NULL;
 	uint8_t* totalBuffer = NULL;
-	void* bufMsgRx = NULL;
-	uint16_t length;
+	uint8_t* grown;
 	uint16_t totalLength;
+	/* Message read out of the RX queue */
+	MSG_T msg;
+	MSG_RX_APP_T msg_rx_app;
 #ifdef LOWAPP_MSG_FORMAT_CLASSIC
+	uint16_t length;
+	uint8_t count = 0;
 	/* Check the rx queue is not empty */
-	if(queue_size(&_rx_pkt_list) > 0) {
+	if(rxq_count() > 0) {
 		totalLength = 14;
 
 		totalBuffer = (uint8_t*) malloc(sizeof(uint8_t)*totalLength);
+		if(totalBuffer == NULL) {
+			LOG(LOG_ERR, "Memory allocation error");
+			_sys->SYS_cmdResponse((uint8_t*)"NOK RX (NO MEMORY)", 18);
+			return;
+		}
 		strncpy((char*)totalBuffer, "OK {\"rxpkts\":[", totalLength);
 
-		MSG_T* msg;
-		MSG_RX_APP_T *msg_rx_app;
-		while(queue_size(&_rx_pkt_list) > 0) {
-			/* Retrieve element of the RX queue */
-			get_from_queue(&_rx_pkt_list, &bufMsgRx, &length);
-			msg_rx_app = (MSG_RX_APP_T*) bufMsgRx;
-			msg = msg_rx_app->msg;
+		/* Retrieve the elements of the RX queue in order */
+		while(count < RXQ_POLL_MAX && rxq_peek(&msg_rx_app, &msg)) {
 			/* Build JSON object for each message */
-			length = buildJson(&buffer, msg_rx_app);
+			length = buildJson(&buffer, &msg_rx_app);
+			if(length == 0) {
+				break;
+			}
 			/* Realloc enough memory to store ]}\0 */
-			totalBuffer = realloc(totalBuffer, totalLength + length + 3);
+			grown = realloc(totalBuffer, totalLength + length + 3);
+			if(grown == NULL) {
+				LOG(LOG_ERR, "Memory allocation error");
+				free(buffer);
+				buffer = NULL;
+				break;
+			}
+			totalBuffer = grown;
 			/* Copy JSON formatted message to the final buffer */
 			strncpy((char*)(totalBuffer+totalLength), (char*)buffer, length);
 			totalLength += length;
@@ -475,12 +722,14 @@ void response_rx_packets() {
 			/* Free JSON temporary buffer */
 			free(buffer);
 			buffer = NULL;
-			/* Free MSG retrieved from queue */
-			free(msg);
-			msg = NULL;
-			free(bufMsgRx);
-			bufMsgRx = NULL;
-			msg = NULL;
+			/* Remove the message from the queue */
+			rxq_pop();
+			count++;
+		}
+		if(count == 0) {
+			free(totalBuffer);
+			_sys->SYS_cmdResponse((uint8_t*)"NOK RX (NO MEMORY)", 18);
+			return;
 		}
 		totalLength--;	/* Remove trailing ',' */
 		strncpy((char*)(totalBuffer+totalLength), "]}\0", 3);
@@ -516,14 +765,20 @@ void response_rx_packets() {
 	 *     06 01 41424344  (ABCD)
 	 *     07 03 3132333435 (12345)
 	 */
-	uint8_t rxSize = queue_size(&_rx_pkt_list);
+	/* The rest of the queue is kept for the next poll */
+	uint8_t rxSize = (rxq_count() > UINT8_MAX) ? UINT8_MAX : rxq_count();
 	uint8_t offset = 0;
-	uint8_t offsetTxtMessage = 0;
+	uint16_t offsetTxtMessage = 0;
 	uint8_t i;
 	uint8_t messageLength;
 	totalLength = 3+9*rxSize;
 
 	totalBuffer = (uint8_t*) malloc(sizeof(uint8_t)*totalLength);
+	if(totalBuffer == NULL) {
+		LOG(LOG_ERR, "Memory allocation error");
+		_sys->SYS_cmdResponse((uint8_t*)"NOK RX (NO MEMORY)", 18);
+		return;
+	}
 	/* Set prefix for GPS format response */
 	*(totalBuffer+(offset++)) = 0x45;
 	*(totalBuffer+(offset++)) = 0x02;
@@ -531,40 +786,41 @@ void response_rx_packets() {
 
 	/* Offset used to set text messages */
 	offsetTxtMessage = offset + rxSize*9;
-	MSG_T* msg;
-	MSG_RX_APP_T *msg_rx_app;
 	for(i = 0; i < rxSize; ++i) {
 		/* Retrieve element of the RX queue */
-		get_from_queue(&_rx_pkt_list, &bufMsgRx, &length);
-		msg_rx_app = (MSG_RX_APP_T*) bufMsgRx;
-		msg = msg_rx_app->msg;
+		rxq_peek(&msg_rx_app, &msg);
 		/* Check duplicate flag */
-//		if(msg_rx_app->state.duplicate_flag == 0) {
+//		if(msg_rx_app.state.duplicate_flag == 0) {
 
 			/* Copy text message */
 #ifdef LOWAPP_MSG_FORMAT_GPSAPP_RSSI
 			uint8_t bufferRssiString[5] = ",";
 			uint8_t rssiReversed;
 			uint8_t rssiStringLength;
-			rssiReversed = -msg_rx_app->rssi;
+			rssiReversed = -msg_rx_app.rssi;
 			rssiStringLength = FillBuffer8_t(bufferRssiString, 1, &rssiReversed, 1, false);
 			/*
 			 * Actual message length is 8 less than payloadLength
 			 * because of the GPS coordinates
 			 */
-			messageLength = msg->hdr.payloadLength-8;
+			messageLength = msg.hdr.payloadLength-8;
 			/* Realloc enough memory */
+			grown = realloc(totalBuffer, totalLength + 2 + messageLength + rssiStringLength);
+			if(grown == NULL) {
+				LOG(LOG_ERR, "Memory allocation error");
+				break;
+			}
+			totalBuffer = grown;
 			totalLength += 2 + messageLength + rssiStringLength;
-			totalBuffer = realloc(totalBuffer, totalLength);
 			/* Copy message source device id to the buffer */
-			*(totalBuffer+offset+(i*9)) = msg->content.std.srcId;
+			*(totalBuffer+offset+(i*9)) = msg.content.std.srcId;
 			/* Copy GPS coordinates to the buffer */
-			memcpy((char*)(totalBuffer+offset+(i*9)+1), (char*)msg->content.std.payload, 8);
+			memcpy((char*)(totalBuffer+offset+(i*9)+1), (char*)msg.content.std.payload, 8);
 
 			/* Length in the message format includes the length value itself and the source id (+2) */
 			*(totalBuffer+(offsetTxtMessage++)) = messageLength+2+rssiStringLength;
-			*(totalBuffer+(offsetTxtMessage++)) = msg->content.std.srcId;
-			memcpy((char*)(totalBuffer+offsetTxtMessage), (char*)msg->content.std.payload+8, messageLength);
+			*(totalBuffer+(offsetTxtMessage++)) = msg.content.std.srcId;
+			memcpy((char*)(totalBuffer+offsetTxtMessage), (char*)msg.content.std.payload+8, messageLength);
 			offsetTxtMessage += messageLength;
 			memcpy((char*)(totalBuffer+offsetTxtMessage), bufferRssiString, rssiStringLength);
 			offsetTxtMessage += rssiStringLength;
@@ -573,31 +829,37 @@ void response_rx_packets() {
 			 * Actual message length is 8 less than payloadLength
 			 * because of the GPS coordinates
 			 */
-			messageLength = msg->hdr.payloadLength-8;
+			messageLength = msg.hdr.payloadLength-8;
 			/* Realloc enough memory */
+			grown = realloc(totalBuffer, totalLength + 2 + messageLength);
+			if(grown == NULL) {
+				LOG(LOG_ERR, "Memory allocation error");
+				break;
+			}
+			totalBuffer = grown;
 			totalLength += 2 + messageLength;
-			totalBuffer = realloc(totalBuffer, totalLength);
 			/* Copy message source device id to the buffer */
-			*(totalBuffer+offset+(i*9)) = msg->content.std.srcId;
+			*(totalBuffer+offset+(i*9)) = msg.content.std.srcId;
 			/* Copy GPS coordinates to the buffer */
-			memcpy((char*)(totalBuffer+offset+(i*9)+1), (char*)msg->content.std.payload, 8);
+			memcpy((char*)(totalBuffer+offset+(i*9)+1), (char*)msg.content.std.payload, 8);
 			/* Length in the message format includes the length value itself and the source id (+2) */
 			*(totalBuffer+(offsetTxtMessage++)) = messageLength+2;
-			*(totalBuffer+(offsetTxtMessage++)) = msg->content.std.srcId;
-			memcpy((char*)(totalBuffer+offsetTxtMessage), (char*)msg->content.std.payload+8, messageLength);
+			*(totalBuffer+(offsetTxtMessage++)) = msg.content.std.srcId;
+			memcpy((char*)(totalBuffer+offsetTxtMessage), (char*)msg.content.std.payload+8, messageLength);
 			offsetTxtMessage += messageLength;
 #endif
 //		}
 
-		/* Free MSG retrieved from queue */
-		free(msg);
-		msg = NULL;
-		free(bufMsgRx);
-		bufMsgRx = NULL;
-		msg = NULL;
+		/* Remove the message from the queue */
+		rxq_pop();
+	}
+	if(i < rxSize) {
+		/* Out of memory: the text messages follow the coordinates answered only */
+		memmove(totalBuffer+offset+i*9, totalBuffer+offset+rxSize*9, offsetTxtMessage-(offset+rxSize*9));
+		offsetTxtMessage -= (rxSize-i)*9;
+		totalBuffer[2] = i;
 	}
-	totalBuffer = realloc(totalBuffer, totalLength+2);
-	_sys->SYS_cmdResponse(totalBuffer, totalLength);
+	_sys->SYS_cmdResponse(totalBuffer, offsetTxtMessage);
 
 	/* Free allocation buffer */
 	free(totalBuffer);
@@ -610,8 +872,17 @@ void response_rx_packets() {
  * @return The duration of a single symbol in seconds
  */
 double get_symbol_time() {
+	return get_symbol_time_sf(_rsf);
+}
+
+/**
+ * Get the symbol time for a given SF and the current bandwidth
+ * @param sf Spreading factor
+ * @return The duration of a single symbol in seconds
+ */
+double get_symbol_time_sf(uint8_t sf) {
 	/* Compute duration of one symbol in seconds */
-	return ((1 << _rsf)/((double)bandwidthValues[_bandwidth]));
+	return ((1 << sf)/((double)bandwidthValues[_bandwidth]));
 }
 
 /**
@@ -632,9 +903,23 @@ uint16_t preamble_timeus_to_symbols(uint32_t preambleTime) {
  * @return The number of corresponding symbols
  */
 uint16_t preamble_timems_to_symbols(uint16_t preambleTime) {
-	uint16_t pLen;
+	return preamble_timems_to_symbols_sf(preambleTime, _rsf);
+}
+
+/**
+ * Convert preamble time from ms to symbols for a given SF
+ * @param preambleTime Duration of the preamble in ms
+ * @param sf Spreading factor
+ * @return The number of corresponding symbols
+ */
+uint16_t preamble_timems_to_symbols_sf(uint16_t preambleTime, uint8_t sf) {
+	double pLen;
 	/* Get number of symbols for the whole preambleTime */
-	pLen = floor((preambleTime/1000.0)/get_symbol_time() - 4.25);
+	pLen = floor((preambleTime/1000.0)/get_symbol_time_sf(sf) - 4.25);
+	/* Preamble time shorter than the fixed part of the preamble at this SF */
+	if(pLen < 0) {
+		return 0;
+	}
 	return pLen;
 }
 
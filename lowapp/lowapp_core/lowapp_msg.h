@@ -54,6 +54,24 @@
 /** Size of an ACK frame in bytes */
 #define ACK_FRAME_LENGTH	12
 
+/** Size of a wake-up frame in bytes */
+#define WAKEUP_FRAME_LENGTH	12
+
+/** Size of the cleartext hint of a frame: destination id and group hash */
+#define FRAME_HINT_SIZE	2
+
+/** Number of bytes to receive before a frame can be dropped from its hint */
+#define FRAME_HINT_END	(4+FRAME_HINT_SIZE)
+
+/** Size of the nonce sent in clear before the encoded content */
+#define FRAME_NONCE_SIZE	2
+
+/** Size of a standard frame content before its payload: destination, source and sequence */
+#define FRAME_STD_HDR_SIZE	3
+
+/** Size of the CRC closing a frame */
+#define FRAME_CRC_SIZE	2
+
 /** Maximum number of retry for txFrame */
 #define MAX_TX_FRAME_RETRY	3
 
@@ -61,6 +79,8 @@
 #define RANDOM_BLOCK_TX_MIN	0
 /** Random value max for blocing tx */
 #define RANDOM_BLOCK_TX_MAX	1000
+/** Random value max for blocking tx when a high priority message is pending */
+#define RANDOM_BLOCK_TX_HIGH_MAX	250
 
 /** Standard message */
 struct STDMSG {
@@ -78,6 +98,18 @@ struct ACKMSG {
 	uint8_t expectedSeq;	/**< Expected sequence number */
 };
 
+/**
+ * Wake-up message
+ *
+ * Short frame repeated by the sender in place of a long preamble. A wake-up
+ * frame sent back by the destination with a null timeToData is an early ACK.
+ */
+struct WAKEMSG {
+	uint8_t destId;		/**< Destination device id */
+	uint8_t srcId;		/**< Source device id */
+	uint16_t timeToData;	/**< Time in ms before the data frame is sent */
+};
+
 /** Gateway out message */
 struct GWOUTMSG {
 	uint8_t srcId;			/**< Source device id */
@@ -102,6 +134,7 @@ struct GWINMSG {
 union FMSG {
 	struct STDMSG std;		/**< Standard message */
 	struct ACKMSG ack;		/**< Acknowledge message */
+	struct WAKEMSG wake;	/**< Wake-up message */
 	struct GWOUTMSG gwout;	/**< Gateway out message */
 	struct GWINMSG gwin;		/**< Gateway in message */
 };
@@ -130,6 +163,11 @@ struct LORA_HDR {
 struct MSG {
 	struct LORA_HDR hdr;	/**< LoRa header */
 	union FMSG content;	/**< Content of the frame */
+	uint8_t priority;	/**< Priority in the TX queue (not sent over the air) */
+	uint32_t deadline;	/**< Local time (ms, truncated) after which the message is dropped, 0 if none (not sent over the air) */
+	uint8_t key;		/**< Coalescing key, a queued message to the same destination with the same key is replaced, 0 if none (not sent over the air) */
+	uint8_t retry;		/**< Number of times a multicast message was sent again to its missing destinations (not sent over the air) */
+	uint32_t queued;	/**< Local time (ms, truncated) at which the message entered the TX queue (not sent over the air) */
 };
 
 /**
@@ -173,6 +211,28 @@ struct MSG_RXDONE {
 	int8_t snr;
 };
 
+/**
+ * Frame received, decoded in place in the reception buffer
+ *
+ * Only the LoRa header is copied, the content of the frame is read from the
+ * reception buffer, so that nothing is copied for the frames we drop.
+ */
+struct FRAME_VIEW {
+	/** LoRa header */
+	struct LORA_HDR hdr;
+	/** Content of the frame, starting with the destination and source ids, NULL if not decoded */
+	uint8_t* content;
+	/** Payload of a standard frame (after the sequence number), NULL for the other types */
+	uint8_t* payload;
+};
+
+/** Destination id of a frame view */
+#define FRAME_DEST(view)	((view)->content[0])
+/** Source id of a frame view */
+#define FRAME_SRC(view)		((view)->content[1])
+/** Sequence number of a standard frame view */
+#define FRAME_SEQ(view)		((view)->content[2])
+
 /**@} */
 /**@} */
 
@@ -181,6 +241,8 @@ struct MSG_RXDONE {
 typedef struct STDMSG STDMSG_T;
 /** Ack message type definition */
 typedef struct ACKMSG ACKMSG_T;
+/** Wake-up message type definition */
+typedef struct WAKEMSG WAKEMSG_T;
 /** Gateway out message type definition */
 typedef struct GWOUTMSG GWOUTMSG_T;
 /** Gateway in message type definition */
@@ -197,15 +259,21 @@ typedef struct MSG_RX_STATE MSG_RX_STATE_T;
 typedef struct MSG_RX_APP MSG_RX_APP_T;
 /** Receive message with RSSI and SNR */
 typedef struct MSG_RXDONE MSG_RXDONE_T;
+/** Frame view type definition */
+typedef struct FRAME_VIEW FRAME_VIEW_T;
 
 uint16_t buildFrame(uint8_t *frameBuffer, MSG_T *msg);
-int8_t retrieveMessage(MSG_T *msg, uint8_t *frameBuffer);
+int8_t frameHint(const uint8_t *frameBuffer, uint16_t length);
+int8_t frameView(FRAME_VIEW_T *view, uint8_t *frameBuffer, uint16_t length);
+void frameToMessage(MSG_T *msg, const FRAME_VIEW_T *view, bool withPayload);
 
 uint8_t frameSize(MSG_T *msg);
 
 void response_rx_packets();
 double get_symbol_time();
+double get_symbol_time_sf(uint8_t sf);
 uint16_t preamble_timems_to_symbols(uint16_t preambleTime);
+uint16_t preamble_timems_to_symbols_sf(uint16_t preambleTime, uint8_t sf);
 uint32_t preamble_symbols_to_timems(uint16_t preambleLen);
 
 #endif
@@ -0,0 +1,250 @@
+/**
+ * @file lowapp_neigh.c
+ * @brief LoWAPP neighbour table
+ *
+ * Every node heard is recorded in a hash table of #NEIGH_TABLE_SIZE entries,
+ * indexed by device id with linear probing over at most #NEIGH_PROBE entries,
+ * so that a neighbour is found in constant time whatever the size of the
+ * group. When all the probed entries are used, the neighbour heard the least
+ * recently among them is replaced. Entries are never removed one by one, so a
+ * lookup stops at the first free entry.
+ *
+ * For each neighbour, the table keeps moving averages (over about
+ * #NEIGH_EWMA_WEIGHT samples) of the RSSI and SNR of its frames, of the packet
+ * reception ratio (frames received against sequence number gaps), and of the
+ * ACK success rate of the unicast messages sent to it, along with the last CAD
+ * phase it reported. AT+WHO lists the content of the table.
+ *
+ * The link adaptation, the routing and the TX scheduler also read the table,
+ * which holds the consecutive missing ACK and the parking time of each
+ * destination. A destination is added on its first transmission if it was
+ * never heard, so that it can be parked.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+#if (NEIGH_TABLE_SIZE & (NEIGH_TABLE_SIZE - 1)) != 0 || NEIGH_TABLE_SIZE > 256
+	#error "NEIGH_TABLE_SIZE must be a power of 2, at most 256"
+#endif
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_neigh LoWAPP Core Neighbour Table
+ * @brief Link quality estimates of the nodes heard
+ * @{
+ */
+
+/** Neighbour table */
+static NEIGH_T neighTable[NEIGH_TABLE_SIZE];
+
+/** Number of used entries of #neighTable */
+static uint16_t neighCount = 0;
+
+/**
+ * Get the first entry probed for a device id
+ *
+ * @param id Device id
+ * @return Index in #neighTable
+ */
+static uint16_t neigh_hash(uint8_t id) {
+	return (id * 37) & (NEIGH_TABLE_SIZE - 1);
+}
+
+/**
+ * Move a ratio (1/255) towards a sample
+ *
+ * @param ratio Current estimate
+ * @param success True for a success, false for a failure
+ * @return The new estimate
+ */
+static uint8_t neigh_ewma_ratio(uint8_t ratio, bool success) {
+	int16_t delta = (success ? 255 : 0) - ratio;
+	int16_t step = delta / NEIGH_EWMA_WEIGHT;
+	/* Always move, so that the estimate can reach 0 and 255 */
+	if(step == 0 && delta != 0) {
+		step = (delta > 0) ? 1 : -1;
+	}
+	return ratio + step;
+}
+
+/**
+ * Look a neighbour up, and add it if needed
+ *
+ * @param id Device id of the neighbour
+ * @return The entry of the neighbour
+ */
+NEIGH_T* neigh_add(uint8_t id) {
+	uint16_t i, pos, victim = neigh_hash(id);
+	NEIGH_T* entry;
+	for(i = 0; i < NEIGH_PROBE; ++i) {
+		pos = (neigh_hash(id) + i) & (NEIGH_TABLE_SIZE - 1);
+		if(neighTable[pos].deviceId == id) {
+			return &neighTable[pos];
+		}
+		if(neighTable[pos].deviceId == 0) {
+			victim = pos;
+			neighCount++;
+			break;
+		}
+		if(neighTable[pos].lastSeen < neighTable[victim].lastSeen) {
+			victim = pos;
+		}
+	}
+	entry = &neighTable[victim];
+	if(i == NEIGH_PROBE) {
+		LOG(LOG_INFO, "Neighbour table full, replacing %u", entry->deviceId);
+	}
+	memset(entry, 0, sizeof(NEIGH_T));
+	entry->deviceId = id;
+	entry->prr = 255;
+	return entry;
+}
+
+/**
+ * Empty the neighbour table
+ */
+void neigh_clear(void) {
+	memset(neighTable, 0, sizeof(neighTable));
+	neighCount = 0;
+}
+
+/**
+ * Look a neighbour up
+ *
+ * @param id Device id of the neighbour
+ * @return The entry of the neighbour, NULL if it was never heard
+ */
+NEIGH_T* neigh_find(uint8_t id) {
+	uint16_t i, pos;
+	if(id == 0) {
+		return NULL;
+	}
+	for(i = 0; i < NEIGH_PROBE; ++i) {
+		pos = (neigh_hash(id) + i) & (NEIGH_TABLE_SIZE - 1);
+		if(neighTable[pos].deviceId == id) {
+			return &neighTable[pos];
+		}
+		if(neighTable[pos].deviceId == 0) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Record a frame received from a neighbour
+ *
+ * @param id Device id of the sender
+ * @param rssi RSSI of the frame (dBm)
+ * @param snr SNR of the frame (dB)
+ */
+void neigh_rx(uint8_t id, int16_t rssi, int8_t snr) {
+	NEIGH_T* entry;
+	if(id == 0) {
+		return;
+	}
+	entry = neigh_add(id);
+	if(entry->lastSeen == 0) {
+		entry->rssiAvg = rssi * 16;
+		entry->snrAvg = snr * 16;
+	}
+	else {
+		entry->rssiAvg += (rssi * 16 - entry->rssiAvg) / NEIGH_EWMA_WEIGHT;
+		entry->snrAvg += (snr * 16 - entry->snrAvg) / NEIGH_EWMA_WEIGHT;
+		entry->prr = neigh_ewma_ratio(entry->prr, true);
+	}
+	entry->lastRssi = rssi;
+	/* The neighbour is back, stop holding its messages */
+	entry->parkUntil = 0;
+	entry->lastSeen = _sys->SYS_getTimeMs();
+	/* Never 0, which marks a new entry */
+	if(entry->lastSeen == 0) {
+		entry->lastSeen = 1;
+	}
+}
+
+/**
+ * Record frames of a neighbour which were not received
+ *
+ * @param id Device id of the sender
+ * @param count Number of frames missing, from the gap in the sequence numbers
+ */
+void neigh_missed(uint8_t id, uint8_t count) {
+	NEIGH_T* entry = neigh_find(id);
+	if(entry == NULL) {
+		return;
+	}
+	/* A long gap is rather a restart or a long absence */
+	if(count > NEIGH_EWMA_WEIGHT) {
+		count = NEIGH_EWMA_WEIGHT;
+	}
+	while(count-- > 0) {
+		entry->prr = neigh_ewma_ratio(entry->prr, false);
+	}
+}
+
+/**
+ * Record the outcome of a unicast transmission to a neighbour
+ *
+ * @param id Device id of the destination
+ * @param acked True if the ACK was received
+ */
+void neigh_ack(uint8_t id, bool acked) {
+	NEIGH_T* entry = neigh_find(id);
+	if(entry == NULL) {
+		return;
+	}
+	if(!entry->ackKnown) {
+		entry->ackRate = acked ? 255 : 0;
+		entry->ackKnown = true;
+	}
+	else {
+		entry->ackRate = neigh_ewma_ratio(entry->ackRate, acked);
+	}
+}
+
+/**
+ * Record the CAD phase reported by a neighbour
+ *
+ * @param id Device id of the neighbour
+ * @param phase Phase of its CAD cycle (1/256 of the CAD interval)
+ */
+void neigh_cad_phase(uint8_t id, uint8_t phase) {
+	NEIGH_T* entry = neigh_find(id);
+	if(entry == NULL) {
+		return;
+	}
+	entry->cadPhase = phase;
+	entry->cadKnown = true;
+}
+
+/**
+ * Get the number of neighbours in the table
+ *
+ * @return The number of neighbours
+ */
+uint16_t neigh_count(void) {
+	return neighCount;
+}
+
+/**
+ * Get an entry of the table, to go through all the neighbours
+ *
+ * @param index Index of the entry, from 0 to #NEIGH_TABLE_SIZE - 1
+ * @return The entry, NULL if it is free
+ */
+NEIGH_T* neigh_at(uint16_t index) {
+	if(index >= NEIGH_TABLE_SIZE || neighTable[index].deviceId == 0) {
+		return NULL;
+	}
+	return &neighTable[index];
+}
+
+/** @} */
+/** @} */
@@ -0,0 +1,25 @@
+/**
+ * @file lowapp_neigh.h
+ * @brief LoWAPP neighbour table
+ *
+ * Defines the functions used to record the link quality of the nodes heard,
+ * and to look it up in constant time.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_NEIGH_H_
+#define LOWAPP_CORE_NEIGH_H_
+
+void neigh_clear(void);
+NEIGH_T* neigh_find(uint8_t id);
+NEIGH_T* neigh_add(uint8_t id);
+void neigh_rx(uint8_t id, int16_t rssi, int8_t snr);
+void neigh_missed(uint8_t id, uint8_t count);
+void neigh_ack(uint8_t id, bool acked);
+void neigh_cad_phase(uint8_t id, uint8_t phase);
+uint16_t neigh_count(void);
+NEIGH_T* neigh_at(uint16_t index);
+
+#endif
@@ -0,0 +1,311 @@
+/**
+ * @file lowapp_ping.c
+ * @brief LoWAPP ping
+ *
+ * AT+PING queues standard messages with the "PING" payload in the TX queue,
+ * like any other message, so that the node keeps receiving while a ping is
+ * in progress. The ping messages are recognised by their #TXQ_KEY_PING
+ * coalescing key.
+ *
+ * The round-trip time is measured from the start of the transmission of the
+ * data frame (after the wake-up strobe, if any) to the reception of its ACK.
+ * Each ping is reported with PING {"dest":"id","seq":"n","rtt":"ms","rssi":"dBm"}
+ * or PING {"dest":"id","seq":"n","lost":"1"}, and the series ends with
+ * PING {"dest":"id","sent":"n","received":"n","min":"ms","avg":"ms","max":"ms"}.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+extern const uint8_t pingPayload[];
+extern const uint8_t jsonPingPrefix[];
+extern const uint8_t jsonPingSeq[];
+extern const uint8_t jsonPingRtt[];
+extern const uint8_t jsonPingRssi[];
+extern const uint8_t jsonPingLost[];
+extern const uint8_t jsonPingSent[];
+extern const uint8_t jsonPingReceived[];
+extern const uint8_t jsonPingMin[];
+extern const uint8_t jsonPingAvg[];
+extern const uint8_t jsonPingMax[];
+extern const uint8_t jsonSuffix[];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_ping LoWAPP Core Ping
+ * @brief Pings sent through the TX queue, with round-trip time statistics
+ * @{
+ */
+
+/** Destination of the pings */
+static uint8_t pingDest = 0;
+
+/** Number of pings to send, 0 when no ping is in progress */
+static uint8_t pingCount = 0;
+
+/** Number of pings already queued */
+static uint8_t pingSeq = 0;
+
+/** Number of pings acknowledged */
+static uint8_t pingReceived = 0;
+
+/** Interval (in ms) between the outcome of a ping and the next one */
+static uint16_t pingInterval = PING_INTERVAL;
+
+/** A ping is queued or being sent */
+static bool pingWaiting = false;
+
+/** The last frame sent was a ping, its ACK is expected */
+static bool pingAwaitAck = false;
+
+/** Local time (in ms) at which the last ping was queued */
+static uint64_t pingQueuedAt = 0;
+
+/** Local time (in ms) at which the transmission of the last ping started */
+static uint64_t pingTxStart = 0;
+
+/** Local time (in ms) at which the next ping is due */
+static uint64_t pingNextDue = 0;
+
+/** Minimum round-trip time (in ms) */
+static uint32_t rttMin = 0;
+
+/** Maximum round-trip time (in ms) */
+static uint32_t rttMax = 0;
+
+/** Sum of the round-trip times (in ms), for the average */
+static uint32_t rttSum = 0;
+
+/**
+ * Append a string to a response
+ *
+ * @param buffer Response buffer
+ * @param offset Offset in the buffer
+ * @param str String to append
+ * @return The new offset in the buffer
+ */
+static uint8_t ping_append(uint8_t* buffer, uint8_t offset, const uint8_t* str) {
+	uint8_t sizeStr = strlen((char*)str);
+	memcpy(buffer+offset, str, sizeStr);
+	return offset + sizeStr;
+}
+
+/**
+ * Append a time in ms to a response
+ *
+ * @param buffer Response buffer
+ * @param offset Offset in the buffer
+ * @param time Time in ms
+ * @return The new offset in the buffer
+ */
+static uint8_t ping_append_time(uint8_t* buffer, uint8_t offset, uint32_t time) {
+	uint16_t value = (time > UINT16_MAX) ? UINT16_MAX : time;
+	return FillBuffer16_t(buffer, offset, &value, 1, false);
+}
+
+/**
+ * Report the statistics of the series of pings and end it
+ */
+static void ping_summary(void) {
+	uint8_t buffer[120] = "";
+	uint8_t offset = 0;
+	offset = ping_append(buffer, offset, jsonPingPrefix);
+	offset = FillBufferHexBI8_t(buffer, offset, &pingDest, 1, false);
+	offset = ping_append(buffer, offset, jsonPingSent);
+	offset = FillBuffer8_t(buffer, offset, &pingSeq, 1, false);
+	offset = ping_append(buffer, offset, jsonPingReceived);
+	offset = FillBuffer8_t(buffer, offset, &pingReceived, 1, false);
+	offset = ping_append(buffer, offset, jsonPingMin);
+	offset = ping_append_time(buffer, offset, rttMin);
+	offset = ping_append(buffer, offset, jsonPingAvg);
+	offset = ping_append_time(buffer, offset, (pingReceived == 0) ? 0 : rttSum / pingReceived);
+	offset = ping_append(buffer, offset, jsonPingMax);
+	offset = ping_append_time(buffer, offset, rttMax);
+	offset = ping_append(buffer, offset, jsonSuffix);
+	_sys->SYS_cmdResponse(buffer, offset);
+	pingCount = 0;
+}
+
+/**
+ * Report the outcome of the last ping and schedule the next one
+ *
+ * @param acked True if the ping was acknowledged
+ * @param rtt Round-trip time in ms
+ * @param rssi RSSI of the ACK (dBm)
+ */
+static void ping_result(bool acked, uint32_t rtt, int16_t rssi) {
+	uint8_t buffer[80] = "";
+	uint8_t offset = 0;
+	pingWaiting = false;
+	pingAwaitAck = false;
+
+	offset = ping_append(buffer, offset, jsonPingPrefix);
+	offset = FillBufferHexBI8_t(buffer, offset, &pingDest, 1, false);
+	offset = ping_append(buffer, offset, jsonPingSeq);
+	offset = FillBuffer8_t(buffer, offset, &pingSeq, 1, false);
+	if(acked) {
+		if(pingReceived == 0 || rtt < rttMin) {
+			rttMin = rtt;
+		}
+		if(rtt > rttMax) {
+			rttMax = rtt;
+		}
+		rttSum += rtt;
+		pingReceived++;
+		offset = ping_append(buffer, offset, jsonPingRtt);
+		offset = ping_append_time(buffer, offset, rtt);
+		offset = ping_append(buffer, offset, jsonPingRssi);
+		offset = FillBufferS16_t(buffer, offset, rssi, false);
+	}
+	else {
+		offset = ping_append(buffer, offset, jsonPingLost);
+	}
+	offset = ping_append(buffer, offset, jsonSuffix);
+	_sys->SYS_cmdResponse(buffer, offset);
+
+	if(pingSeq >= pingCount) {
+		ping_summary();
+		return;
+	}
+	pingNextDue = _sys->SYS_getTimeMs() + pingInterval;
+	deferred_schedule(pingInterval);
+}
+
+/**
+ * Start a series of pings
+ *
+ * A series already in progress is ended first.
+ *
+ * @param dest Device id of the destination
+ * @param count Number of pings to send
+ * @param interval Interval (in ms) between the outcome of a ping and the next one
+ */
+void ping_start(uint8_t dest, uint8_t count, uint16_t interval) {
+	if(pingCount != 0) {
+		ping_summary();
+	}
+	pingDest = dest;
+	pingCount = count;
+	pingInterval = interval;
+	pingSeq = 0;
+	pingReceived = 0;
+	pingWaiting = false;
+	pingAwaitAck = false;
+	rttMin = 0;
+	rttMax = 0;
+	rttSum = 0;
+	pingNextDue = _sys->SYS_getTimeMs();
+	deferred_schedule(0);
+}
+
+/**
+ * Queue the next ping when it is due
+ *
+ * Called when timer 3 ends, the timer is armed again for the next ping. A ping
+ * whose outcome is still unknown after #PING_TIMEOUT (dropped before its
+ * transmission) is reported as lost.
+ */
+void ping_poll(void) {
+	MSG_T* msg;
+	uint64_t now = _sys->SYS_getTimeMs();
+	if(pingCount == 0) {
+		return;
+	}
+	if(pingWaiting) {
+		if(now - pingQueuedAt >= PING_TIMEOUT) {
+			ping_result(false, 0, 0);
+		}
+		else {
+			deferred_schedule(PING_TIMEOUT - (now - pingQueuedAt));
+		}
+		return;
+	}
+	if(now < pingNextDue) {
+		deferred_schedule(pingNextDue - now);
+		return;
+	}
+
+	msg = msg_alloc();
+	if(msg == NULL) {
+		/* Try again after the interval */
+		deferred_schedule(PING_INTERVAL);
+		return;
+	}
+	msg->hdr.type = TYPE_STDMSG;
+	msg->hdr.version = LOWAPP_CURRENT_VERSION;
+	msg->hdr.payloadLength = strlen((char*)pingPayload);
+	msg->hdr.rfu = 0;
+	msg->content.std.destId = pingDest;
+	msg->content.std.srcId = _deviceId;
+	msg->content.std.txSeq = 0;
+	memcpy(msg->content.std.payload, pingPayload, msg->hdr.payloadLength);
+	msg->priority = TXQ_PRIO_NORMAL;
+	msg->deadline = 0;
+	msg->key = TXQ_KEY_PING;
+	msg->retry = 0;
+	pingSeq++;
+	pingWaiting = true;
+	pingQueuedAt = now;
+	deferred_schedule(PING_TIMEOUT);
+	/* The message is freed by lowapp_tx if the queue is full */
+	if(lowapp_tx(msg) == -1) {
+		ping_result(false, 0, 0);
+	}
+}
+
+/**
+ * Record the start of the transmission of a frame
+ *
+ * @param msg Message being sent
+ */
+void ping_tx_start(MSG_T* msg) {
+	if(msg != NULL && msg->key == TXQ_KEY_PING) {
+		pingTxStart = _sys->SYS_getTimeMs();
+	}
+}
+
+/**
+ * Record the end of the transmission of a unicast message
+ *
+ * @param msg Message sent
+ */
+void ping_sent(MSG_T* msg) {
+	pingAwaitAck = pingWaiting && msg != NULL && msg->key == TXQ_KEY_PING;
+}
+
+/**
+ * The ACK of the last unicast message was received
+ *
+ * @param rssi RSSI of the ACK (dBm)
+ */
+void ping_ack(int16_t rssi) {
+	if(pingAwaitAck) {
+		ping_result(true, _sys->SYS_getTimeMs() - pingTxStart, rssi);
+	}
+}
+
+/**
+ * The ACK of the last unicast message was not received
+ */
+void ping_lost(void) {
+	if(pingAwaitAck) {
+		ping_result(false, 0, 0);
+	}
+}
+
+/**
+ * Abandon the series of pings in progress, without report
+ */
+void ping_stop(void) {
+	pingCount = 0;
+	pingWaiting = false;
+	pingAwaitAck = false;
+}
+
+/** @} */
+/** @} */
@@ -0,0 +1,23 @@
+/**
+ * @file lowapp_ping.h
+ * @brief LoWAPP ping
+ *
+ * Defines the functions used to send pings through the state machine and to
+ * measure their round-trip time.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_PING_H_
+#define LOWAPP_CORE_PING_H_
+
+void ping_start(uint8_t dest, uint8_t count, uint16_t interval);
+void ping_poll(void);
+void ping_tx_start(MSG_T* msg);
+void ping_sent(MSG_T* msg);
+void ping_ack(int16_t rssi);
+void ping_lost(void);
+void ping_stop(void);
+
+#endif
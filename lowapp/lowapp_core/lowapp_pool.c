@@ -0,0 +1,166 @@
+/**
+ * @file lowapp_pool.c
+ * @brief LoWAPP object pools
+ *
+ * The objects of the message path are never allocated from the heap, but from
+ * pools of blocks reserved at build time: #MSG_POOL_SIZE messages,
+ * #RXDONE_POOL_SIZE radio reception descriptors and #ATCMD_POOL_SIZE AT command
+ * buffers of #ATCMD_MAX_LEN bytes. Allocating and freeing take constant time and can be done from the
+ * radio interrupt handlers.
+ *
+ * When a pool is empty, the allocation fails and the object is dropped as if
+ * its queue was full. AT+STATS reports, for each pool, the number of blocks in
+ * use, the highest number reached and the number of failed allocations.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+extern const uint8_t jsonFieldDelimiter[];
+extern const uint8_t jsonKeyValDelimiter[];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_pool LoWAPP Core Object Pools
+ * @brief Heap-free allocation of the messages and buffers
+ * @{
+ */
+
+/** Storage of #msgPool */
+static MSG_T msgBlocks[MSG_POOL_SIZE];
+/** Storage of #rxdonePool */
+static MSG_RXDONE_T rxdoneBlocks[RXDONE_POOL_SIZE];
+/** Storage of #atbufPool */
+static uint8_t atbufBlocks[ATCMD_POOL_SIZE][ATCMD_MAX_LEN];
+
+/** Messages, received or to be sent */
+static POOL_T msgPool = POOL_INIT(msgBlocks, MSG_POOL_SIZE);
+/** Radio reception descriptors, from the RX done callback to the state machine */
+static POOL_T rxdonePool = POOL_INIT(rxdoneBlocks, RXDONE_POOL_SIZE);
+/** AT command buffers, in the AT command queue */
+static POOL_T atbufPool = POOL_INIT(atbufBlocks, ATCMD_POOL_SIZE);
+
+/** Pools reported by AT+STATS */
+static POOL_T* const pools[] = { &msgPool, &rxdonePool, &atbufPool };
+/** Names of the pools in AT+STATS */
+static const char* poolNames[] = { "msgPool", "rxDonePool", "atCmdPool" };
+
+/**
+ * Allocate a message
+ *
+ * @return The message, not initialised
+ * @retval NULL If the pool is empty
+ */
+MSG_T* msg_alloc(void) {
+	return (MSG_T*) pool_alloc(&msgPool);
+}
+
+/**
+ * Free a message
+ *
+ * @param msg Message allocated by #msg_alloc, or NULL
+ */
+void msg_free(MSG_T* msg) {
+	pool_free(&msgPool, msg);
+}
+
+/**
+ * Count the messages which can still be allocated
+ *
+ * @return The number of free blocks of the message pool
+ */
+uint16_t msg_available(void) {
+	return msgPool.count - msgPool.used;
+}
+
+/**
+ * Allocate a radio reception descriptor
+ *
+ * @return The descriptor, not initialised
+ * @retval NULL If the pool is empty
+ */
+MSG_RXDONE_T* rxdone_alloc(void) {
+	return (MSG_RXDONE_T*) pool_alloc(&rxdonePool);
+}
+
+/**
+ * Free a radio reception descriptor
+ *
+ * @param rxDone Descriptor allocated by #rxdone_alloc, or NULL
+ */
+void rxdone_free(MSG_RXDONE_T* rxDone) {
+	pool_free(&rxdonePool, rxDone);
+}
+
+/**
+ * Allocate an AT command buffer of #ATCMD_MAX_LEN bytes
+ *
+ * @return The buffer, not initialised
+ * @retval NULL If the pool is empty
+ */
+uint8_t* atbuf_alloc(void) {
+	return (uint8_t*) pool_alloc(&atbufPool);
+}
+
+/**
+ * Free an AT command buffer
+ *
+ * @param buf Buffer allocated by #atbuf_alloc, or NULL
+ */
+void atbuf_free(uint8_t* buf) {
+	pool_free(&atbufPool, buf);
+}
+
+/**
+ * Append the usage of the pools to the AT+STATS answer
+ *
+ * Each pool is written as ,"name":"used,hwm,fails".
+ *
+ * @param buffer Buffer to fill
+ * @return The number of characters written
+ */
+uint16_t pools_fill_stats(uint8_t* buffer) {
+	uint16_t offset = 0;
+	uint16_t sizeStr;
+	uint16_t values[3];
+	uint8_t i, j;
+	for(i = 0; i < sizeof(pools)/sizeof(pools[0]); ++i) {
+		values[0] = pools[i]->used;
+		values[1] = pools[i]->hwm;
+		values[2] = pools[i]->fails;
+		sizeStr = strlen((char*)jsonFieldDelimiter);
+		memcpy(buffer+offset, jsonFieldDelimiter, sizeStr);
+		offset += sizeStr;
+		sizeStr = strlen(poolNames[i]);
+		memcpy(buffer+offset, poolNames[i], sizeStr);
+		offset += sizeStr;
+		sizeStr = strlen((char*)jsonKeyValDelimiter);
+		memcpy(buffer+offset, jsonKeyValDelimiter, sizeStr);
+		offset += sizeStr;
+		for(j = 0; j < 3; ++j) {
+			if(j > 0) {
+				buffer[offset++] = ',';
+			}
+			offset += FillBuffer16_t(buffer+offset, 0, &values[j], 1, false);
+		}
+	}
+	return offset;
+}
+
+/**
+ * Restart the high-water marks and the failure counters of the pools
+ */
+void pools_clear_stats(void) {
+	uint8_t i;
+	for(i = 0; i < sizeof(pools)/sizeof(pools[0]); ++i) {
+		pool_clear_stats(pools[i]);
+	}
+}
+
+/** @} */
+/** @} */
@@ -0,0 +1,26 @@
+/**
+ * @file lowapp_pool.h
+ * @brief LoWAPP object pools
+ *
+ * Defines the functions used to allocate the messages, the radio reception
+ * descriptors and the AT command buffers from statically sized pools.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_POOL_H_
+#define LOWAPP_CORE_POOL_H_
+
+MSG_T* msg_alloc(void);
+void msg_free(MSG_T* msg);
+uint16_t msg_available(void);
+MSG_RXDONE_T* rxdone_alloc(void);
+void rxdone_free(MSG_RXDONE_T* rxDone);
+uint8_t* atbuf_alloc(void);
+void atbuf_free(uint8_t* buf);
+
+uint16_t pools_fill_stats(uint8_t* buffer);
+void pools_clear_stats(void);
+
+#endif
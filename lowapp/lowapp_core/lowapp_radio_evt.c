@@ -60,8 +60,6 @@ void cadDone ( bool channelActivityDetected ) {
 	_sys->SYS_radioSleep();
 	LOG_LATER(LOG_RADIO, "CAD done callback");
 	LOG_LATER(LOG_PARSER, "CAD result = %d", channelActivityDetected);	/* Used by log parse */
-	lock_eventQ();
-
 	/*
 	 * Ignore gcc warning for this cast because we did want to pass a
 	 * uint8_t as a value to the event
@@ -70,8 +68,6 @@ void cadDone ( bool channelActivityDetected ) {
 	#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
 	add_event(&_eventQ, CADDONE, (void*)channelActivityDetected, 1);
 	#pragma GCC diagnostic pop
-
-	unlock_eventQ();
 #ifdef SIMU
 	/* Print log buffer only if CAD successfull */
 	if(channelActivityDetected) {
@@ -101,14 +97,37 @@ void rxDone ( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr ){
 	LOG(LOG_PARSER, "RX Done callback, received %d bytes", size);
 	/* Build a structure to store all informations */
 	MSG_RXDONE_T* rxDoneMessage;
-	rxDoneMessage = malloc(sizeof(MSG_RXDONE_T));
+	rxDoneMessage = rxdone_alloc();
+	if (rxDoneMessage == NULL) {
+		/* No descriptor left, handled as a reception error */
+		LOG(LOG_ERR, "RX descriptor pool empty, frame dropped");
+		add_simple_event(&_eventQ, RXERROR);
+		return;
+	}
 	rxDoneMessage->data = payload;
 	rxDoneMessage->length = size;
 	rxDoneMessage->rssi = rssi;
 	rxDoneMessage->snr = snr;
-	lock_eventQ();
-	add_event(&_eventQ, RXMSG, rxDoneMessage, sizeof(MSG_RXDONE_T));
-	unlock_eventQ();
+	if (add_event(&_eventQ, RXMSG, rxDoneMessage, sizeof(MSG_RXDONE_T)) < 0) {
+		rxdone_free(rxDoneMessage);
+	}
+}
+
+/**
+ * Called when the start of a frame has been received
+ *
+ * Lets the radio layer stop the reception of a frame whose cleartext hint shows
+ * another destination or another group, instead of receiving it to the end.
+ * The radio layer then calls #rxDone with the bytes already received, and the
+ * frame is dropped by the state machine without being decoded.
+ *
+ * @param head Bytes of the frame received so far
+ * @param size Number of bytes received so far, at least #FRAME_HINT_END
+ * @retval True If the reception must go on
+ * @retval False If the reception can be stopped
+ */
+bool rxHeader ( uint8_t *head, uint16_t size ){
+	return frameHint(head, size) == 0;
 }
 
 /**
@@ -122,9 +141,7 @@ void rxError(void){
 	_sys->SYS_radioSleep();
 
 	LOG(LOG_PARSER, "RX Error callback");
-	lock_eventQ();
 	add_simple_event(&_eventQ, RXERROR);
-	unlock_eventQ();
 }
 
 /**
@@ -138,9 +155,7 @@ void rxTimeout(void){
 	_sys->SYS_radioSleep();
 
 	LOG(LOG_PARSER, "RX Timeout callback");
-	lock_eventQ();
 	add_simple_event(&_eventQ, RXTIMEOUT);
-	unlock_eventQ();
 }
 
 /**
@@ -154,9 +169,7 @@ void txDone(void){
 	_sys->SYS_radioSleep();
 
 	LOG(LOG_PARSER, "TX Done callback");
-	lock_eventQ();
 	add_simple_event(&_eventQ, TXDONE);
-	unlock_eventQ();
 }
 
 /**
@@ -170,9 +183,7 @@ void txTimeout(void){
 	_sys->SYS_radioSleep();
 
 	LOG(LOG_PARSER, "TX Timeout callback");
-	lock_eventQ();
 	add_simple_event(&_eventQ, TXTIMEOUT);
-	unlock_eventQ();
 }
 
 /**
@@ -22,6 +22,7 @@
 
 void cadDone ( bool channelActivityDetected );
 void rxDone ( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr );
+bool rxHeader ( uint8_t *head, uint16_t size );
 void rxError ( void );
 void rxTimeout ( void );
 void txDone ( void );
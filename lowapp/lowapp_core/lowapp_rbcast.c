@@ -0,0 +1,285 @@
+/**
+ * @file lowapp_rbcast.c
+ * @brief LoWAPP reliable broadcast
+ *
+ * When the reliable broadcast mode is enabled, each source numbers its
+ * broadcast messages and keeps the last #RBC_HISTORY of them. Receivers follow
+ * the sequence number of each source and keep a mask of the messages they
+ * missed among the last #RBC_NACK_WINDOW ones.
+ *
+ * After a broadcast message, a receiver with missing messages sends a NACK to
+ * the source in one of #RBC_NACK_SLOTS randomly drawn slots. The NACK has the
+ * layout of an ACK: the expected sequence number is the next one expected from
+ * the source, and the received sequence number field carries the missing mask.
+ * The source listens during all the slots, merges the NACK it received, and
+ * sends each missing message it still has once, whatever the number of
+ * receivers which missed it.
+ *
+ * Repairs are sent again as broadcast messages with their original sequence
+ * number, so a receiver which already got them flags them as duplicate. A
+ * receiver whose NACK was lost reports the same messages again after the next
+ * broadcast message of the source.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+#include "utilities.h"
+
+extern PEER_T peers[256];
+extern uint16_t timer_safeguard_txing_ack;
+extern CORE_STATS_T coreStats;
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_rbcast LoWAPP Core Reliable Broadcast
+ * @brief Broadcast repairs from NACK
+ * @{
+ */
+
+/** Last broadcast messages sent, indexed by sequence number modulo #RBC_HISTORY */
+static MSG_T* rbcHistory[RBC_HISTORY] = { NULL };
+
+/** Sequence number of the last broadcast message sent (not counting repairs) */
+static uint8_t rbcLastSeq = 0;
+
+/** Messages of the history to send again (one bit per history entry) */
+static uint8_t rbcRepair = 0;
+
+/** Listening for NACK after a broadcast message */
+static bool rbcListening = false;
+
+/** Local time (in ms) at which the NACK reception window ends */
+static uint64_t rbcListenEnd = 0;
+
+/**
+ * Subtract from a broadcast sequence number, skipping 0
+ *
+ * @param seq Sequence number (1 to 255)
+ * @param n Value to subtract (less than 255)
+ * @return The sequence number n messages before seq
+ */
+static uint8_t rbc_seq_sub(uint8_t seq, uint8_t n) {
+	return ((seq + 254 - n) % 255) + 1;
+}
+
+/**
+ * Process a broadcast message received from a source
+ *
+ * Updates the missing messages of the source, and flags the message as
+ * duplicate if it was already received.
+ *
+ * @param msg Broadcast message received
+ * @param rxState State of the message in the RX queue
+ * @retval True If a NACK must be sent to the source
+ * @retval False Otherwise
+ */
+bool rbc_receive(MSG_T* msg, MSG_RX_STATE_T* rxState) {
+	PEER_T* peer = &peers[msg->content.std.srcId];
+	uint8_t seq = msg->content.std.txSeq;
+	uint8_t dist, back;
+
+	/* First message heard, or the source got initialised */
+	if(seq == 0 || peer->in_bcast == 0) {
+		peer->in_bcast = (seq % 255) + 1;
+		peer->bcast_missing = 0;
+		return false;
+	}
+
+	dist = (seq + 255 - peer->in_bcast) % 255;
+	if(dist < 128) {
+		/* New message, with dist messages missing before it */
+		if(dist > 0) {
+			LOG(LOG_WARN, "%u broadcast frames missing from %u", dist, msg->content.std.srcId);
+			rxState->missing_frames = dist;
+			neigh_missed(msg->content.std.srcId, dist);
+			coreStats.missingFrames += dist;
+		}
+		if(dist >= RBC_NACK_WINDOW) {
+			peer->bcast_missing = 0xFE;
+		}
+		else {
+			peer->bcast_missing = (peer->bcast_missing << (dist+1)) | (((1 << dist) - 1) << 1);
+		}
+		peer->in_bcast = (seq % 255) + 1;
+		return peer->bcast_missing != 0;
+	}
+
+	/* Older message: repair of a missing one, or duplicate */
+	back = (peer->in_bcast + 254 - seq) % 255;
+	if(back < RBC_NACK_WINDOW && ((peer->bcast_missing >> back) & 1)) {
+		LOG(LOG_INFO, "Broadcast frame %u from %u repaired", seq, msg->content.std.srcId);
+		peer->bcast_missing &= ~(1 << back);
+	}
+	else {
+		LOG(LOG_WARN, "Duplicate frame detected !");
+		coreStats.duplicate++;
+		rxState->duplicate_flag = 1;
+	}
+	return false;
+}
+
+/**
+ * Build the NACK reporting the broadcast messages missing from a source
+ *
+ * @param source Device id of the source
+ * @param snr SNR of the broadcast message received (dB)
+ * @return The NACK message, to be freed by the caller
+ * @retval NULL If the message pool is empty
+ */
+MSG_T* rbc_build_nack(uint8_t source, int8_t snr) {
+	MSG_T* nack = msg_alloc();
+	if(nack == NULL) {
+		return NULL;
+	}
+	nack->hdr.payloadLength = 0;
+	nack->hdr.type = TYPE_NACK;
+	nack->hdr.version = LOWAPP_CURRENT_VERSION;
+	nack->hdr.rfu = link_margin_report(snr);
+	nack->content.ack.destId = source;
+	nack->content.ack.srcId = _deviceId;
+	nack->content.ack.expectedSeq = peers[source].in_bcast;
+	nack->content.ack.rxdSeq = peers[source].bcast_missing;
+	return nack;
+}
+
+/**
+ * Draw the delay before sending a NACK
+ *
+ * @return The delay (in ms) from the end of the broadcast message to the NACK,
+ * in a random slot
+ */
+uint32_t rbc_nack_delay(void) {
+	return TIMER_ACK_SLOT_START + randr(0, RBC_NACK_SLOTS-1)*mcast_slot_length() + MCAST_ACK_GUARD;
+}
+
+/**
+ * Get the time during which NACK can follow a reliable broadcast message
+ *
+ * @return The time (in ms) from the end of the message to the end of the last
+ * NACK slot
+ */
+uint32_t rbc_window(void) {
+	return TIMER_ACK_SLOT_START + RBC_NACK_SLOTS*mcast_slot_length();
+}
+
+/**
+ * Record a broadcast message which was just sent and start waiting for NACK
+ *
+ * @param msg Broadcast message sent, owned by this module
+ */
+void rbc_sent(MSG_T* msg) {
+	uint8_t idx = msg->content.std.txSeq % RBC_HISTORY;
+	/* Repairs are already in the history */
+	if(msg->retry != 0) {
+		msg_free(msg);
+	}
+	else {
+		if(rbcHistory[idx] != NULL) {
+			msg_free(rbcHistory[idx]);
+		}
+		rbcHistory[idx] = msg;
+		rbcLastSeq = msg->content.std.txSeq;
+		/* The entry now holds another message */
+		rbcRepair &= ~(1 << idx);
+	}
+	rbcListening = true;
+	rbcListenEnd = 0;
+}
+
+/**
+ * Check whether NACK are expected after a broadcast message
+ *
+ * @retval True If the NACK window is open
+ * @retval False Otherwise
+ */
+bool rbc_active(void) {
+	return rbcListening;
+}
+
+/**
+ * Get the time left in the NACK reception window
+ *
+ * The window starts with the first call, at the beginning of the first slot.
+ *
+ * @return The time left in ms
+ */
+uint32_t rbc_listen_time(void) {
+	uint64_t now = _sys->SYS_getTimeMs();
+	if(!rbcListening) {
+		return 0;
+	}
+	if(rbcListenEnd == 0) {
+		rbcListenEnd = now + RBC_NACK_SLOTS*mcast_slot_length() + timer_safeguard_txing_ack;
+	}
+	if(now >= rbcListenEnd) {
+		return 0;
+	}
+	return rbcListenEnd - now;
+}
+
+/**
+ * Record the missing messages reported by a NACK
+ *
+ * @param nack NACK received
+ */
+void rbc_nack(MSG_T* nack) {
+	uint8_t i, seq, idx;
+	if(nack->content.ack.expectedSeq == 0) {
+		return;
+	}
+	LOG(LOG_INFO, "NACK from %u: %02X before %u", nack->content.ack.srcId,
+			nack->content.ack.rxdSeq, nack->content.ack.expectedSeq);
+	for(i = 0; i < RBC_NACK_WINDOW; ++i) {
+		if(((nack->content.ack.rxdSeq >> i) & 1) == 0) {
+			continue;
+		}
+		seq = rbc_seq_sub(nack->content.ack.expectedSeq, i+1);
+		idx = seq % RBC_HISTORY;
+		if(rbcHistory[idx] != NULL && rbcHistory[idx]->content.std.txSeq == seq) {
+			rbcRepair |= 1 << idx;
+		}
+	}
+}
+
+/**
+ * End the NACK reception window
+ *
+ * Queues one repair for each missing message still in the history, oldest
+ * first.
+ */
+void rbc_finish(void) {
+	uint8_t i, seq, idx;
+	MSG_T* repair;
+	rbcListening = false;
+	for(i = RBC_HISTORY; i > 0; --i) {
+		seq = rbc_seq_sub(rbcLastSeq, i-1);
+		idx = seq % RBC_HISTORY;
+		if(((rbcRepair >> idx) & 1) == 0 || rbcHistory[idx] == NULL
+				|| rbcHistory[idx]->content.std.txSeq != seq) {
+			continue;
+		}
+		repair = msg_alloc();
+		if(repair == NULL) {
+			LOG(LOG_WARN, "No message left to repair broadcast frame %u", seq);
+			break;
+		}
+		memcpy(repair, rbcHistory[idx], sizeof(MSG_T));
+		/* Repairs keep their sequence number and go first */
+		repair->retry = 1;
+		repair->key = 0;
+		repair->deadline = 0;
+		repair->priority = TXQ_PRIO_HIGH;
+		LOG(LOG_INFO, "Repairing broadcast frame %u", seq);
+		/* The message is freed by lowapp_tx if the queue is full */
+		lowapp_tx(repair);
+	}
+	rbcRepair = 0;
+}
+
+/** @} */
+/** @} */
@@ -0,0 +1,25 @@
+/**
+ * @file lowapp_rbcast.h
+ * @brief LoWAPP reliable broadcast
+ *
+ * Defines the functions used to detect missing broadcast messages, report them
+ * with NACK and repair them from the source.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_RBCAST_H_
+#define LOWAPP_CORE_RBCAST_H_
+
+bool rbc_receive(MSG_T* msg, MSG_RX_STATE_T* rxState);
+MSG_T* rbc_build_nack(uint8_t source, int8_t snr);
+uint32_t rbc_nack_delay(void);
+uint32_t rbc_window(void);
+void rbc_sent(MSG_T* msg);
+bool rbc_active(void);
+uint32_t rbc_listen_time(void);
+void rbc_nack(MSG_T* nack);
+void rbc_finish(void);
+
+#endif
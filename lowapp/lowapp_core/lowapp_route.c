@@ -0,0 +1,357 @@
+/**
+ * @file lowapp_route.c
+ * @brief LoWAPP multi-hop relaying
+ *
+ * When the relay mode is enabled, a unicast message to a node with a known
+ * route is sent to the next hop of the route as a #TYPE_RELAY message. The
+ * first #RELAY_HDR_SIZE bytes of its payload are the final destination, the
+ * origin, the number of hops left and a relay id chosen by the origin.
+ *
+ * Each hop is a standard unicast transmission: it is acknowledged by the next
+ * hop with the sequence numbers of the link, and sent again by the usual TX
+ * retries. A node receiving a relayed message either delivers it, if it is the
+ * final destination, or queues it again towards the next hop. The
+ * (origin, relay id) pairs seen last are remembered, so that a message reaching
+ * a node twice is neither delivered nor forwarded twice, and the hop limit
+ * stops messages caught in a loop.
+ *
+ * Routes are learned from the relayed messages received or overheard: their
+ * origin can be reached through the node which sent them. They can also be set
+ * by the application with AT+ROUTE. A destination with a working direct link
+ * (heard, without consecutive missing ACK in the neighbour table) is always
+ * reached directly.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_route LoWAPP Core Relaying
+ * @brief Route cache and relayed messages
+ * @{
+ */
+
+/**
+ * Route cache entry
+ */
+typedef struct ROUTE {
+	uint8_t dest; /**< Device id of the destination, 0 for a free entry */
+	uint8_t nextHop; /**< Device id of the neighbour to send the messages to */
+	uint8_t hops; /**< Number of hops to the destination */
+	bool fixed; /**< Route set by the application, never forgotten */
+	uint32_t lastSeen; /**< Local time (ms, truncated) at which the route was last confirmed */
+} ROUTE_T;
+
+/**
+ * Relayed message identifier, for duplicate suppression
+ */
+typedef struct RELAY_ID {
+	uint8_t origin; /**< Device id of the origin, 0 for a free entry */
+	uint8_t id; /**< Relay id chosen by the origin */
+} RELAY_ID_T;
+
+/** Route cache */
+static ROUTE_T routes[ROUTE_MAX];
+
+/** Last relayed messages received */
+static RELAY_ID_T relaySeen[RELAY_DUP_CACHE];
+
+/** Next entry of #relaySeen to overwrite */
+static uint8_t relaySeenPos = 0;
+
+/** Last relay id used for our own messages */
+static uint8_t relayId = 0;
+
+/**
+ * Find the route cache entry of a destination
+ *
+ * Learned routes which timed out are forgotten.
+ *
+ * @param dest Device id of the destination
+ * @return The entry
+ * @retval NULL If there is no route to the destination
+ */
+static ROUTE_T* route_find(uint8_t dest) {
+	uint8_t i;
+	for(i = 0; i < ROUTE_MAX; ++i) {
+		if(routes[i].dest != dest) {
+			continue;
+		}
+		if(!routes[i].fixed &&
+				(uint32_t)_sys->SYS_getTimeMs() - routes[i].lastSeen > ROUTE_TIMEOUT) {
+			routes[i].dest = 0;
+			return NULL;
+		}
+		return &routes[i];
+	}
+	return NULL;
+}
+
+/**
+ * Record a route to a destination
+ *
+ * A learned route replaces the current one if it is not longer, or if it goes
+ * through the same next hop. Routes set by the application are only replaced
+ * by other routes set by the application.
+ *
+ * @param dest Device id of the destination
+ * @param nextHop Device id of the neighbour to send the messages to
+ * @param hops Number of hops to the destination
+ * @param fixed True for a route set by the application
+ */
+void route_learn(uint8_t dest, uint8_t nextHop, uint8_t hops, bool fixed) {
+	uint8_t i;
+	ROUTE_T* route = route_find(dest);
+	if(route != NULL) {
+		if(route->fixed && !fixed) {
+			return;
+		}
+		if(!fixed && route->nextHop != nextHop && hops > route->hops) {
+			return;
+		}
+	}
+	else {
+		/* Free entry, or the oldest learned route */
+		for(i = 0; i < ROUTE_MAX; ++i) {
+			if(routes[i].dest == 0) {
+				route = &routes[i];
+				break;
+			}
+			if(!routes[i].fixed && (route == NULL || (int32_t)(routes[i].lastSeen - route->lastSeen) < 0)) {
+				route = &routes[i];
+			}
+		}
+		if(route == NULL) {
+			return;
+		}
+		LOG(LOG_INFO, "Route to %u via %u (%u hops)", dest, nextHop, hops);
+	}
+	route->dest = dest;
+	route->nextHop = nextHop;
+	route->hops = hops;
+	route->fixed = fixed;
+	route->lastSeen = (uint32_t)_sys->SYS_getTimeMs();
+}
+
+/**
+ * Forget the route to a destination
+ *
+ * @param dest Device id of the destination
+ * @retval True If a route was removed
+ * @retval False If there was no route to the destination
+ */
+bool route_remove(uint8_t dest) {
+	ROUTE_T* route = route_find(dest);
+	if(route == NULL) {
+		return false;
+	}
+	route->dest = 0;
+	return true;
+}
+
+/**
+ * Choose the neighbour to send a message to
+ *
+ * @param dest Device id of the destination
+ * @return The device id of the next hop, dest itself for a direct transmission
+ */
+uint8_t route_next_hop(uint8_t dest) {
+	ROUTE_T* route = route_find(dest);
+	NEIGH_T* entry;
+	if(route == NULL) {
+		return dest;
+	}
+	/* A working direct link is better than any relay */
+	entry = neigh_find(dest);
+	if(!route->fixed && entry != NULL && entry->lastSeen != 0 && entry->fails < TXQ_PARK_FAILS) {
+		return dest;
+	}
+	return route->nextHop;
+}
+
+/**
+ * Send a message through a relay if the destination is reached through one
+ *
+ * The relay header is added at the head of the payload, and the message is
+ * addressed to the next hop.
+ *
+ * @param msg Message to send, modified in place
+ */
+void route_wrap(MSG_T* msg) {
+	uint8_t dest = msg->content.std.destId;
+	uint8_t nextHop;
+	if(msg->hdr.type != TYPE_STDMSG || dest < MIN_DEVICE_ID || dest > MAX_DEVICE_ID) {
+		return;
+	}
+	nextHop = route_next_hop(dest);
+	if(nextHop == dest) {
+		return;
+	}
+	if(msg->hdr.payloadLength + RELAY_HDR_SIZE > MAX_PAYLOAD_STD_SIZE-1) {
+		LOG(LOG_WARN, "Payload too big for relaying, sending directly to %u", dest);
+		return;
+	}
+	memmove(msg->content.std.payload+RELAY_HDR_SIZE, msg->content.std.payload, msg->hdr.payloadLength);
+	msg->content.std.payload[0] = dest;
+	msg->content.std.payload[1] = _deviceId;
+	msg->content.std.payload[2] = RELAY_MAX_HOPS-1;
+	relayId++;
+	msg->content.std.payload[3] = relayId;
+	msg->hdr.payloadLength += RELAY_HDR_SIZE;
+	msg->hdr.type = TYPE_RELAY;
+	msg->content.std.destId = nextHop;
+	LOG(LOG_INFO, "Relaying message to %u via %u", dest, nextHop);
+}
+
+/**
+ * Check whether a relayed message was already received, and remember it
+ *
+ * @param origin Device id of the origin
+ * @param id Relay id of the message
+ * @retval True If the message was already received
+ * @retval False Otherwise
+ */
+static bool route_seen(uint8_t origin, uint8_t id) {
+	uint8_t i;
+	for(i = 0; i < RELAY_DUP_CACHE; ++i) {
+		if(relaySeen[i].origin == origin && relaySeen[i].id == id) {
+			return true;
+		}
+	}
+	relaySeen[relaySeenPos].origin = origin;
+	relaySeen[relaySeenPos].id = id;
+	relaySeenPos = (relaySeenPos + 1) % RELAY_DUP_CACHE;
+	return false;
+}
+
+/**
+ * Process a relayed message addressed to this device
+ *
+ * The message is either turned back into a standard message from its origin,
+ * or queued again towards its next hop.
+ *
+ * @param msg Relayed message received, modified in place
+ * @retval True If the message must be delivered to the application
+ * @retval False If the message was forwarded or dropped, and must be freed
+ */
+bool route_relay_in(MSG_T* msg) {
+	uint8_t prevHop = msg->content.std.srcId;
+	uint8_t dest, origin, hopsLeft, nextHop;
+	MSG_T* fwd;
+	if(msg->hdr.payloadLength < RELAY_HDR_SIZE) {
+		return false;
+	}
+	dest = msg->content.std.payload[0];
+	origin = msg->content.std.payload[1];
+	hopsLeft = msg->content.std.payload[2];
+	if(origin == _deviceId || hopsLeft >= RELAY_MAX_HOPS) {
+		return false;
+	}
+	if(origin != prevHop) {
+		route_learn(origin, prevHop, RELAY_MAX_HOPS-hopsLeft, false);
+	}
+	if(route_seen(origin, msg->content.std.payload[3])) {
+		LOG(LOG_INFO, "Relayed message from %u already received", origin);
+		return false;
+	}
+
+	/* We are the final destination */
+	if(dest == _deviceId) {
+		msg->hdr.payloadLength -= RELAY_HDR_SIZE;
+		memmove(msg->content.std.payload, msg->content.std.payload+RELAY_HDR_SIZE, msg->hdr.payloadLength);
+		msg->hdr.type = TYPE_STDMSG;
+		msg->content.std.srcId = origin;
+		msg->content.std.destId = _deviceId;
+		return true;
+	}
+
+	if(!_relayMode || hopsLeft == 0) {
+		LOG(LOG_INFO, "Relayed message to %u dropped", dest);
+		return false;
+	}
+	nextHop = route_next_hop(dest);
+	if(nextHop == prevHop) {
+		LOG(LOG_INFO, "Relayed message to %u would go back to %u", dest, prevHop);
+		return false;
+	}
+	fwd = msg_alloc();
+	if(fwd == NULL) {
+		LOG(LOG_WARN, "Relayed message to %u dropped, no message left", dest);
+		return false;
+	}
+	memcpy(fwd, msg, sizeof(MSG_T));
+	fwd->content.std.payload[2] = hopsLeft-1;
+	fwd->content.std.srcId = _deviceId;
+	fwd->content.std.destId = nextHop;
+	fwd->content.std.txSeq = 0;
+	fwd->hdr.rfu = 0;
+	fwd->priority = TXQ_PRIO_NORMAL;
+	fwd->deadline = 0;
+	fwd->key = 0;
+	fwd->retry = 0;
+	LOG(LOG_INFO, "Forwarding message from %u to %u via %u", origin, dest, nextHop);
+	/* The message is freed by lowapp_tx if the queue is full */
+	lowapp_tx(fwd);
+	return false;
+}
+
+/**
+ * Learn a route from a relayed message addressed to another node
+ *
+ * @param view Relayed frame overheard
+ */
+void route_overheard(const FRAME_VIEW_T* view) {
+	uint8_t origin, hopsLeft;
+	if(view->hdr.payloadLength < RELAY_HDR_SIZE) {
+		return;
+	}
+	origin = view->payload[1];
+	hopsLeft = view->payload[2];
+	if(origin == _deviceId || origin == FRAME_SRC(view) || hopsLeft >= RELAY_MAX_HOPS) {
+		return;
+	}
+	route_learn(origin, FRAME_SRC(view), RELAY_MAX_HOPS-hopsLeft, false);
+}
+
+/**
+ * Append the route cache to a response
+ *
+ * Each route is written as destination:next hop:hops, separated by commas.
+ *
+ * @param buffer Response buffer
+ * @param offset Offset in the buffer
+ * @param size Size of the buffer
+ * @return The new offset in the buffer
+ */
+uint8_t route_fill_list(uint8_t* buffer, uint8_t offset, uint8_t size) {
+	uint8_t i;
+	bool first = true;
+	for(i = 0; i < ROUTE_MAX; ++i) {
+		if(routes[i].dest == 0 || route_find(routes[i].dest) == NULL) {
+			continue;
+		}
+		/* Room for the longest entry and the end of the response */
+		if(offset + 10 + 4 > size) {
+			break;
+		}
+		if(!first) {
+			buffer[offset++] = ',';
+		}
+		offset = FillBufferHexBI8_t(buffer, offset, &routes[i].dest, 1, false);
+		buffer[offset++] = ':';
+		offset = FillBufferHexBI8_t(buffer, offset, &routes[i].nextHop, 1, false);
+		buffer[offset++] = ':';
+		offset = FillBuffer8_t(buffer, offset, &routes[i].hops, 1, false);
+		first = false;
+	}
+	return offset;
+}
+
+/** @} */
+/** @} */
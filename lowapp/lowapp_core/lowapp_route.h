@@ -0,0 +1,23 @@
+/**
+ * @file lowapp_route.h
+ * @brief LoWAPP multi-hop relaying
+ *
+ * Defines the functions used to learn routes to the nodes out of radio range
+ * and to relay messages to them through a next hop.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_ROUTE_H_
+#define LOWAPP_CORE_ROUTE_H_
+
+void route_learn(uint8_t dest, uint8_t nextHop, uint8_t hops, bool fixed);
+bool route_remove(uint8_t dest);
+uint8_t route_next_hop(uint8_t dest);
+void route_wrap(MSG_T* msg);
+bool route_relay_in(MSG_T* msg);
+void route_overheard(const FRAME_VIEW_T* view);
+uint8_t route_fill_list(uint8_t* buffer, uint8_t offset, uint8_t size);
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file lowapp_rxq.c
+ * @brief LoWAPP queue of the received messages
+ *
+ * The messages received for the application are not kept as #MSG_T, whose
+ * payload array is sized for the longest frame, but copied as records packed
+ * one after the other in a ring of #RXQ_BYTES bytes. A record holds the state
+ * of the message (duplicate, missing frames), its RSSI and SNR, the LoRa
+ * header and the fields of the standard message, and only the bytes of the
+ * payload actually received: a 10 bytes message takes 24 bytes of the ring.
+ *
+ * The state of a record can be updated in place until the record is read, so
+ * that a message can be queued before the duplicate and missing frames
+ * detection. AT+POLLRX reads the records out in order of reception.
+ *
+ * The ring is only accessed from the state machine.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_rxq LoWAPP Core RX Queue
+ * @brief Packed records of the messages received for the application
+ * @{
+ */
+
+/** Size of the fields of a message stored in a record, before its payload */
+#define RXQ_MSG_FIELDS	offsetof(MSG_T, content.std.payload)
+
+/**
+ * Metadata of a record, followed by the fields of the message and its payload
+ *
+ * Only bytes, so that a record needs no alignment in the ring.
+ */
+typedef struct RXQ_META {
+	MSG_RX_STATE_T state;	/**< Duplicate and missing frames */
+	uint8_t rssi[2];		/**< RSSI of the message (dBm), least significant byte first */
+	int8_t snr;				/**< SNR of the message (dB) */
+} RXQ_META_T;
+
+/** Storage of #_rx_pkt_ring */
+static uint8_t rxqBytes[RXQ_BYTES];
+
+/** Records of the messages received for the application, oldest first */
+RING_T _rx_pkt_ring = RING_INIT(rxqBytes);
+
+/**
+ * Queue a message received for the application
+ *
+ * The message is copied from the reception buffer, which can be released once
+ * queued.
+ *
+ * @param view Standard frame received
+ * @param rssi RSSI of the message (dBm)
+ * @param snr SNR of the message (dB)
+ * @return The state of the message in the queue, to flag a duplicate or
+ * missing frames before the next access to the queue
+ * @retval NULL If the queue is full
+ */
+MSG_RX_STATE_T* rxq_push(const FRAME_VIEW_T* view, int16_t rssi, int8_t snr) {
+	uint8_t payloadLength = view->hdr.payloadLength;
+	RXQ_META_T* meta;
+	uint8_t* record;
+	uint8_t* fields;
+	if(payloadLength > MAX_PAYLOAD_STD_SIZE) {
+		payloadLength = MAX_PAYLOAD_STD_SIZE;
+	}
+	record = ring_put(&_rx_pkt_ring, sizeof(RXQ_META_T) + RXQ_MSG_FIELDS + payloadLength);
+	if(record == NULL) {
+		return NULL;
+	}
+	meta = (RXQ_META_T*) record;
+	meta->state.duplicate_flag = 0;
+	meta->state.missing_frames = 0;
+	meta->rssi[0] = (uint16_t)rssi & 0xFF;
+	meta->rssi[1] = (uint16_t)rssi >> 8;
+	meta->snr = snr;
+	/* Same layout as a MSG_T, for rxq_peek */
+	fields = record + sizeof(RXQ_META_T);
+	memcpy(fields, &view->hdr, sizeof(LORA_HDR_T));
+	memcpy(fields + offsetof(MSG_T, content.std.destId), view->content, 3);
+	memcpy(fields + RXQ_MSG_FIELDS, view->payload, payloadLength);
+	return &meta->state;
+}
+
+/**
+ * Read the oldest message of the queue, leaving it in the queue
+ *
+ * @param[out] msgRx State, RSSI and SNR of the message, its msg field pointing
+ * to msg
+ * @param[out] msg Message, only the LoRa header and the standard message
+ * fields are set
+ * @retval True If a message was read
+ * @retval False If the queue is empty
+ */
+bool rxq_peek(MSG_RX_APP_T* msgRx, MSG_T* msg) {
+	RXQ_META_T* meta;
+	uint8_t* record;
+	uint16_t len;
+	record = ring_get(&_rx_pkt_ring, &len);
+	if(record == NULL) {
+		return false;
+	}
+	meta = (RXQ_META_T*) record;
+	msgRx->state = meta->state;
+	msgRx->rssi = (int16_t)(meta->rssi[0] | (meta->rssi[1] << 8));
+	msgRx->snr = meta->snr;
+	msgRx->msg = msg;
+	memcpy(msg, record + sizeof(RXQ_META_T), len - sizeof(RXQ_META_T));
+	return true;
+}
+
+/**
+ * Remove the oldest message of the queue
+ */
+void rxq_pop(void) {
+	ring_remove(&_rx_pkt_ring);
+}
+
+/**
+ * Get the number of messages in the queue
+ *
+ * @return The number of messages
+ */
+uint16_t rxq_count(void) {
+	return ring_count(&_rx_pkt_ring);
+}
+
+/**
+ * Drop all the messages of the queue
+ */
+void rxq_clear(void) {
+	ring_clear(&_rx_pkt_ring);
+}
+
+/** @} */
+/** @} */
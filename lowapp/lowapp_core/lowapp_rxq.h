@@ -0,0 +1,21 @@
+/**
+ * @file lowapp_rxq.h
+ * @brief LoWAPP queue of the received messages
+ *
+ * Defines the functions used to keep the messages received for the
+ * application, as packed records, until they are polled.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_RXQ_H_
+#define LOWAPP_CORE_RXQ_H_
+
+MSG_RX_STATE_T* rxq_push(const FRAME_VIEW_T* view, int16_t rssi, int8_t snr);
+bool rxq_peek(MSG_RX_APP_T* msgRx, MSG_T* msg);
+void rxq_pop(void);
+uint16_t rxq_count(void);
+void rxq_clear(void);
+
+#endif
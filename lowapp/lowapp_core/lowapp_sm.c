@@ -25,26 +25,28 @@ typedef STATES (*SM_PROCESS_T)(EVENT_T evt);
 PEER_T peers[256];
 
 /**
- * Received messages queue
+ * Transmission messages queues
  *
- * This queue contains the messages received, waiting to be retrieved by the application
- * (or pushed to the application regarding the mode).
+ * These queues contain the messages waiting to be transmitted, one queue per
+ * priority level (indexed by #TXQ_PRIO_LOW, #TXQ_PRIO_NORMAL and #TXQ_PRIO_HIGH).
  */
-volatile QFIXED_T _rx_pkt_list;
-/**
- * Transmission messages queue
- *
- * This queue contains the messages waiting to be transmitted.
- */
-volatile QFIXED_T _tx_pkt_list;
+volatile QFIXED_T _tx_pkt_list[TXQ_PRIO_LEVELS];
+/** Storage of #_tx_pkt_list */
+static QEL_T _tx_pkt_els[TXQ_PRIO_LEVELS][TXQ_SIZE];
+/** Storage of #_atcmd_list */
+static QEL_T _atcmd_els[ATCMDQ_SIZE];
 /**
  * AT command queue, waiting to be process
+ *
+ * Usable before the core is initialised, commands can be received at any time.
  */
-volatile QFIXED_T _atcmd_list;
+volatile QFIXED_T _atcmd_list = { .mask = ATCMDQ_SIZE - 1, .els = _atcmd_els };
 /**
  * Standard event queue
  */
 volatile QEVENT_T _eventQ;
+/** Storage of #_eventQ */
+static EVENT_T _eventEvts[EVENTQ_SIZE];
 /**
  * Cold event queue
  *
@@ -52,22 +54,22 @@ volatile QEVENT_T _eventQ;
  * when nothing else is happening, in the idle state.
  */
 volatile QEVENT_T _coldEventQ;
+/** Storage of #_coldEventQ */
+static EVENT_T _coldEventEvts[COLDQ_SIZE];
 
-/** Statistics queue for AT+WHO */
-volatile QSTAT_T statisticsWho;
+#if !QUEUE_SIZE_VALID(TXQ_SIZE) || !QUEUE_SIZE_VALID(ATCMDQ_SIZE) \
+		|| !QUEUE_SIZE_VALID(EVENTQ_SIZE) || !QUEUE_SIZE_VALID(COLDQ_SIZE)
+	#error "Queue capacities must be powers of 2, at most QUEUE_MAX_SIZE"
+#endif
+
+/** Counters for AT+STATS */
+CORE_STATS_T coreStats;
 
 /** Current state of the state machine */
 STATES _currentState = RESTART;
 
-/**
- * CAD flag
- *
- * This is set when a CAD is done, by the radio callback. Normally, the CADTIMEOUT
- * event should be enough. This flag is raised in case the CADTIMEOUT is reached
- * when the state machine is not in idle and is therefore unable to process that
- * event. The flag is read every time we enter the idle state.
- */
-volatile uint8_t cad_flag;
+/** Local time (in ms) of the last CAD timer tick, for the CAD phase of hello replies */
+volatile uint64_t lastCadTime = 0;
 
 /**
  * Ack message used to go through the wait tx ack window and the wait channel ack
@@ -84,6 +86,15 @@ uint8_t lastDestination;
  */
 MSG_T* currentTxMsg;
 
+/**
+ * ACK or early ACK to send, pointed to by #currentTxMsg
+ *
+ * It does not come from the message pool, so that a message received is still
+ * acknowledged when the pool is exhausted by the TX queue. Only one ACK is
+ * pending at a time, it is sent as soon as its slot starts.
+ */
+static MSG_T ackTxMsg;
+
 /**
  * Current frame transmitting (used as temporary buffer)
  */
@@ -109,6 +120,75 @@ uint8_t retryTxFrame = 0;
  */
 volatile bool txBlocked = false;
 
+/**
+ * Local time (in ms) at which timer 3 ends, 0 when it is not armed
+ */
+volatile uint64_t deferredDue = 0;
+
+/**
+ * Flag used to indicate that timer 3 ended, and that deferred transmissions
+ * are due
+ */
+volatile bool deferredReady = false;
+
+/**
+ * Destination of the last message taken from the TX queue, used for round-robin
+ * scheduling across destinations
+ */
+uint8_t lastScheduledDest = LOWAPP_ID_BROADCAST;
+
+/**
+ * Flag used to indicate that the wake-up strobe for currentTxFrame is over
+ * (early ACK received or end of the train reached)
+ */
+bool wakeupTrainDone = false;
+
+/**
+ * Time (in ms) at which the wake-up strobe must end and the data frame be sent
+ */
+uint64_t wakeupTrainEnd = 0;
+
+/**
+ * Time (in ms) during which a wake-up frame is listened for an early ACK
+ */
+uint32_t timer_wakeup_ack_window = 0;
+
+/**
+ * Time (in ms) until which CAD is skipped after overhearing a wake-up frame
+ * destined to another node
+ */
+uint64_t wakeupSleepUntil = 0;
+
+/**
+ * Reception timeout (in ms) to use when entering RXING after an early ACK,
+ * 0 if the next reception is a standard one
+ */
+uint32_t wakeupRxTimeout = 0;
+
+/**
+ * Flag used to indicate that the radio is set with the sync preamble for the
+ * transmission of currentTxFrame
+ */
+bool txSyncPreamble = false;
+
+/**
+ * Delay (in ms) between the end of the received message and the transmission
+ * of its ACK, later than #TIMER_ACK_SLOT_TX for a multicast message
+ */
+uint32_t ackSlotDelay = TIMER_ACK_SLOT_TX;
+
+/**
+ * Time (in ms) during which the ACK of a message destined to other nodes are
+ * skipped, longer for a multicast message
+ */
+uint32_t ackSkipTime = TIMER_ACK_SLOT_START+TIMER_ACK_SLOT_LENGTH;
+
+/**
+ * Time (in ms) at which the transmission of the last data frame started, for
+ * the ACK latency statistics
+ */
+uint64_t txStartTime = 0;
+
 /**
  * @name LoWAPP State Machine States
  * @{
@@ -123,6 +203,7 @@ static STATES state_restart(EVENT_T evt);
 static STATES state_txingack(EVENT_T evt);
 static STATES state_wait_before_listening_ack(EVENT_T evt);
 static STATES state_cad(EVENT_T evt);
+static STATES state_txing_wakeup(EVENT_T evt);
 /**@} */
 
 /**
@@ -131,7 +212,7 @@ static STATES state_cad(EVENT_T evt);
 SM_PROCESS_T SM[] = { state_idle, state_rxing, state_skipping_ack,
 		state_wait_slot_tx_ack, state_txingack,	state_txing,
 		state_wait_before_listening_ack, state_rxing_ack, state_cad,
-		state_restart };
+		state_txing_wakeup, state_restart };
 
 
 extern Lowapp_RadioEvents_t radio_callbacks;
@@ -147,6 +228,8 @@ extern const uint8_t jsonPrefixOkTx[];
 extern const uint8_t jsonNokTx[];
 extern const uint8_t jsonNokTxRxError[];
 extern const uint8_t jsonNokTxRxTimeout[];
+extern const uint8_t jsonNokTxExpired[];
+extern const uint8_t jsonNokRxQueueFull[];
 
 /* Safeguard timers */
 extern uint16_t timer_safeguard_rxing_std;
@@ -160,9 +243,28 @@ extern uint32_t _cad_interval;
 
 /* Static functions prototypes */
 static STATES tryTxFromQueue();
+static bool destParked(uint8_t dest);
+static int8_t scheduleTx(uint8_t* prio);
+static int32_t txRandomBackoff();
+static bool txExpired(MSG_T* msg);
+static uint8_t txFinalDest(MSG_T* msg);
+static bool txSameDest(MSG_T* a, MSG_T* b);
+static void dropExpiredFromQueue();
+static bool dropCurrentIfExpired();
+static void statsHist(uint16_t* hist, uint32_t time);
+static int8_t viewFrame(FRAME_VIEW_T* view, MSG_RXDONE_T* rxDoneMessage);
+static int8_t parseFrame(MSG_T* msg, MSG_RXDONE_T* rxDoneMessage);
 static STATES tryTxCurrent();
 static STATES tryTxFrame();
+static void txRetryResponse();
 static void setTimerForUnblockingTx();
+static void deferred_poll(void);
+static void txWakeupFrame();
+static STATES nextWakeupFrame();
+static STATES process_wakeup(MSG_T* msg, int8_t received);
+static void prepare_ack(MSG_T* msg, MSG_RX_STATE_T* rxState, int8_t snr);
+static STATES process_relay(MSG_T* msg, MSG_RXDONE_T* rxDoneMessage);
+static STATES process_hello(MSG_T* msg, MSG_RXDONE_T* rxDoneMessage);
 
 /**
  * Initialise the radio core with radio event callbacks
@@ -171,6 +273,7 @@ void core_radio_init() {
 	/* Register radio events */
 	radio_callbacks.CadDone = cadDone;
 	radio_callbacks.RxDone = rxDone;
+	radio_callbacks.RxHeader = rxHeader;
 	radio_callbacks.RxError = rxError;
 	radio_callbacks.RxTimeout = rxTimeout;
 	radio_callbacks.TxDone = txDone;
@@ -185,11 +288,16 @@ void core_radio_init() {
  */
 void core_init() {
 	/* Initialise buffers, queues */
+	uint8_t prio;
 	memset((void*)&peers, 0, sizeof(peers));
-	memset((void*)&_rx_pkt_list, 0, sizeof(_rx_pkt_list));
-	memset((void*)&_tx_pkt_list, 0, sizeof(_tx_pkt_list));
-	memset((void*)&_eventQ, 0, sizeof(_eventQ));
-	memset((void*)&_coldEventQ, 0, sizeof(_coldEventQ));
+	for(prio = 0; prio < TXQ_PRIO_LEVELS; ++prio) {
+		queue_init(&_tx_pkt_list[prio], _tx_pkt_els[prio], TXQ_SIZE);
+	}
+	rxq_clear();
+	memset((void*)&coreStats, 0, sizeof(coreStats));
+	neigh_clear();
+	event_init(&_eventQ, _eventEvts, EVENTQ_SIZE);
+	event_init(&_coldEventQ, _coldEventEvts, COLDQ_SIZE);
 
 	/* By default, lastDestination is the device id */
 	lastDestination = _deviceId;
@@ -198,14 +306,15 @@ void core_init() {
 	/* Initialise multi level log system */
 	init_log();
 #endif
+#ifdef LOWAPP_SM_PROFILE
+	smprof_reset();
+#endif
 
 	/* Reset frame and frame flag */
 	memset(currentTxFrame, 0, MAX_FRAME_SIZE);
 
 	/* Start the state machine */
-	lock_eventQ();
 	add_simple_event(&_eventQ, STATE_ENTER);
-	unlock_eventQ();
 
 	/*
 	 * Start random number generator from Semtech using a seed
@@ -218,8 +327,20 @@ void core_init() {
  * Update the values of safeguard timers according to the current radio configuration
  */
 void update_safeguard_timers() {
+	set_radio_config(_rsf, _coderate, _preambleLen, _power);
+}
+
+/**
+ * Set the radio configuration and update the safeguard timers accordingly
+ *
+ * @param sf Spreading factor
+ * @param cr Coding rate
+ * @param preambleLen Preamble length (in symbols) of standard messages
+ * @param power Transmit power (in dBm)
+ */
+void set_radio_config(uint8_t sf, uint8_t cr, uint16_t preambleLen, int8_t power) {
 	/* Set radio Tx configuration for ACK */
-	_sys->SYS_radioSetTxConfig(_power, _bandwidth, _rsf, _coderate, PREAMBLE_ACK, timer_safeguard_txing_ack, true);
+	_sys->SYS_radioSetTxConfig(power, _bandwidth, sf, cr, PREAMBLE_ACK, timer_safeguard_txing_ack, true);
 
 	/* Set safeguard timer for rxing ack messages */
 	timer_safeguard_txing_ack = ceil(_sys->SYS_radioTimeOnAir(ACK_FRAME_LENGTH)*1.2);
@@ -230,7 +351,7 @@ void update_safeguard_timers() {
 	timer_safeguard_rxing_ack = TIMER_ACK_SLOT_LENGTH+timer_safeguard_txing_ack;
 
 	/* Set radio Rx and Tx configuration to standard messages */
-	_sys->SYS_radioSetRxConfig(_bandwidth, _rsf, _coderate, _preambleLen, false, 0, true);
+	_sys->SYS_radioSetRxConfig(_bandwidth, sf, cr, preambleLen, false, 0, true);
 	_sys->SYS_radioSetTxFixLen(false);
 
 	/* Set safeguard timer for rxing standard messages */
@@ -254,6 +375,33 @@ void set_default_values() {
 	/* Pull mode is the default operation mode */
 	_opMode = PULL;
 
+	/* Long preamble is the default wake-up method */
+	_wakeupMode = false;
+
+	/* Asynchronous CAD cycle is the default listening schedule */
+	_syncMode = false;
+
+	/* Group SF and coding rate are used for all links by default */
+	_linkAdaptMode = false;
+
+	/* Full power is used for all links by default */
+	_powerCtrlMode = false;
+
+	/* Broadcast messages are not repaired by default */
+	_relBcastMode = false;
+
+	/* Messages are not relayed by default */
+	_relayMode = false;
+
+	/* Broadcast messages are not flooded by default */
+	_floodMode = false;
+
+	/* Undelivered messages are dropped by default */
+	_mailboxMode = false;
+
+	/* Frames are sent without hint by default */
+	_hintMode = false;
+
  	/* Set coding rate */
  	_coderate = LOWAPP_CODING_RATE;	/* 1 : 4/5, 2 : 4/6, 3 : 4/7, 4 : 4/8 */
 
@@ -286,6 +434,8 @@ void set_default_values() {
 	/* Initialise retry variable */
 	retryTxFrame = 0;
 	txFrameFilled = false;
+	wakeupTrainDone = false;
+	txSyncPreamble = false;
 }
 
 /**
@@ -423,6 +573,28 @@ bool check_attribute(const uint8_t* key, const uint8_t* val) {
 	return true;
 }
 
+/**
+ * Notify the application that the transmission of the current frame will be
+ * tried again
+ */
+static void txRetryResponse() {
+	uint8_t bufCmd[50] = "";
+	/* Size of the current string to add to the anwser */
+	uint8_t sizeStr = 0;
+	uint8_t offset = 0;
+	/* Build the JSON message */
+	sizeStr = strlen((char*)jsonPrefixNokTxRetry);
+	memcpy(bufCmd, jsonPrefixNokTxRetry, sizeStr);
+	offset += sizeStr;
+
+	offset = FillBuffer8_t(bufCmd, offset, &retryTxFrame, 1, false);
+
+	sizeStr = strlen((char*)jsonSuffix);
+	memcpy(bufCmd+offset, jsonSuffix, sizeStr);
+	offset += sizeStr;
+	_sys->SYS_cmdResponse(bufCmd, offset);
+}
+
 /**
  * Set timer for unblocking TX
  */
@@ -430,7 +602,7 @@ static void setTimerForUnblockingTx() {
 	/* Block transmission */
 	LOG(LOG_DBG, "txBlocked = true");
 	txBlocked = true;
-	int32_t r = randr(RANDOM_BLOCK_TX_MIN,RANDOM_BLOCK_TX_MAX);
+	int32_t r = txRandomBackoff();
 	LOG(LOG_DBG, "Random value = %d", r);
 	_sys->SYS_setTimer2(preamble_symbols_to_timems(_preambleLen)+r);
 }
@@ -441,11 +613,9 @@ static void setTimerForUnblockingTx() {
  * Add CADTIMEOUT event to the standard event queue
  */
 void cadTimeoutCB() {
-	lock_eventQ();
 	add_simple_event(&_eventQ, CADTIMEOUT);
-	cad_flag = 1;
-	unlock_eventQ();
-	_sys->SYS_setRepetitiveTimer(_cad_interval);	// Rearm
+	lastCadTime = _sys->SYS_getTimeMs();
+	_sys->SYS_setRepetitiveTimer(sync_next_cad_delay());	// Rearm
 }
 
 /**
@@ -453,11 +623,9 @@ void cadTimeoutCB() {
  */
 void timeoutCB() {
 	LOG(LOG_STATES, "Timeout event occurred");
-	lock_eventQ();
 	if (add_event(&_eventQ, TIMEOUT, NULL, 0) < 0) {
 		LOG(LOG_ERR, "Event queue was full");
 	}
-	unlock_eventQ();
 }
 
 /**
@@ -465,37 +633,188 @@ void timeoutCB() {
  */
 void timeoutCB2() {
 	LOG(LOG_INFO, "Timeout 2 event occurred (unblocking tx)");
-	lock_eventQ();
 	txBlocked = false;
 	if (add_event(&_eventQ, TXUNBLOCK, NULL, 0) < 0) {
 		LOG(LOG_ERR, "Event queue was full");
 	}
-	unlock_eventQ();
+}
+
+/**
+ * Post a DEFERRED event when a deferred transmission is due
+ *
+ * The event is processed in the idle state. If the state machine is busy, the
+ * deferred transmissions are queued when it is back to idle.
+ */
+void timeoutCB3() {
+	deferredDue = 0;
+	deferredReady = true;
+	if (add_event(&_eventQ, DEFERRED, NULL, 0) < 0) {
+		LOG(LOG_ERR, "Event queue was full");
+	}
+}
+
+/**
+ * Arm timer 3 for a deferred transmission
+ *
+ * The timer is shared by all the deferred transmissions: it is only moved
+ * earlier, and the transmissions not due yet when it ends schedule it again.
+ *
+ * @param delay Time (in ms) before the transmission is due
+ */
+void deferred_schedule(uint32_t delay) {
+	uint64_t due = _sys->SYS_getTimeMs() + delay;
+	if(deferredDue != 0 && deferredDue <= due) {
+		return;
+	}
+	deferredDue = due;
+	/* A null delay would disarm the timer */
+	_sys->SYS_setTimer3(delay > 0 ? delay : 1);
+}
+
+/**
+ * Queue the deferred transmissions which are due
+ */
+static void deferred_poll(void) {
+	deferredReady = false;
+	/* Flooded messages whose rebroadcast delay is over */
+	flood_poll();
+	/* Next ping of AT+PING */
+	ping_poll();
 }
 
 /**
  * Schedule a message for transmission
  *
- * Puts the message on the tx queue.
+ * Puts the message on the tx queue of its priority level. A message with an
+ * invalid priority is given #TXQ_PRIO_NORMAL.
+ *
+ * If the message has a coalescing key and a message to the same destination
+ * with the same key is still queued, the queued message is replaced (last value
+ * wins). The new message takes the place of the old one when both have the same
+ * priority. Relayed messages are compared on their final destination, and
+ * multicast messages on their list of receivers.
  *
  * @param msg Message to transmit
  * @retval 0 If the message was added to the queue
- * @retval -1 If the queue was full
+ * @retval 1 If the message replaced a queued message
+ * @retval -1 If the queue was full, or if too many messages are already queued
+ * for the same destination. A queued message with the same key is then kept.
  */
 int8_t lowapp_tx(MSG_T* msg) {
+	uint8_t pos, prio, nDest = 0;
+	MSG_T* queued;
+	uint16_t len;
+	if(msg->priority >= TXQ_PRIO_LEVELS) {
+		msg->priority = TXQ_PRIO_NORMAL;
+	}
+	/* Destinations out of range are reached through their next hop */
+	if(_relayMode) {
+		route_wrap(msg);
+	}
+	/* Broadcast messages cross several hops */
+	if(_floodMode) {
+		flood_wrap(msg);
+	}
+	msg->queued = (uint32_t)_sys->SYS_getTimeMs();
+	/* Keep room in the TX queue for the other destinations */
+	for(prio = 0; prio < TXQ_PRIO_LEVELS; ++prio) {
+		for(pos = 0; peek_queue(&_tx_pkt_list[prio], pos, (void**) &queued, &len) == 0; ++pos) {
+			if(txFinalDest(queued) != txFinalDest(msg)) {
+				continue;
+			}
+			if(msg->key != 0 && queued->key == msg->key && txSameDest(queued, msg)) {
+				if(prio == msg->priority) {
+					LOG(LOG_INFO, "Replacing queued message to %u (key %u)", msg->content.std.destId, msg->key);
+					coreStats.txCoalesced++;
+					/* Same place in the queue, the new value does not wait longer */
+					memcpy(queued, msg, sizeof(MSG_T));
+					msg_free(msg);
+					msg = NULL;
+					return 1;
+				}
+				/* Keep the queued message if the new one cannot take its place */
+				if(queue_full(&_tx_pkt_list[msg->priority])) {
+					LOG(LOG_ERR, "Event queue was full");
+					coreStats.queueFull++;
+					msg_free(msg);
+					msg = NULL;
+					return -1;
+				}
+				LOG(LOG_INFO, "Replacing queued message to %u (key %u)", msg->content.std.destId, msg->key);
+				coreStats.txCoalesced++;
+				remove_from_queue(&_tx_pkt_list[prio], pos, (void**) &queued, &len);
+				msg_free(queued);
+				queued = NULL;
+				add_to_queue(&_tx_pkt_list[msg->priority], msg, sizeof(MSG_T));
+				return 1;
+			}
+			nDest++;
+		}
+	}
 	/* Try adding to the message to the TX queue */
-	if (add_to_queue(&_tx_pkt_list, msg, sizeof(MSG_T)) == -1) {
+	if (nDest >= TXQ_MAX_PER_DEST || add_to_queue(&_tx_pkt_list[msg->priority], msg, sizeof(MSG_T)) == -1) {
 		/* Queue was full, buffer was freed by the add_to_queue function */
 		LOG(LOG_ERR, "Event queue was full");
+		coreStats.queueFull++;
 		/* Free buffer */
-		free(msg);
+		msg_free(msg);
 		msg = NULL;
 		return -1;
 	}
 	else {
-		LOG(LOG_STATES, "Add message to TX queue");
+		LOG(LOG_STATES, "Add message to TX queue (priority %u)", msg->priority);
+		return 0;
+	}
+}
+
+/**
+ * Count the messages waiting for transmission ahead of a new message
+ *
+ * @param priority Priority of the new message
+ * @return The number of queued messages with the same or a higher priority
+ */
+uint8_t lowapp_tx_pending(uint8_t priority) {
+	uint8_t count = 0;
+	for(; priority < TXQ_PRIO_LEVELS; ++priority) {
+		count += queue_size(&_tx_pkt_list[priority]);
+	}
+	return count;
+}
+
+/**
+ * Count the messages which can still be queued for a destination
+ *
+ * @param priority Priority of the messages
+ * @param dest Final destination device id, whether the messages are relayed or not
+ * @return The number of messages #lowapp_tx would still accept, from the room
+ * left in the TX queue of the priority level and for the destination, and the
+ * messages left in the pool
+ */
+uint8_t lowapp_tx_credits(uint8_t priority, uint8_t dest) {
+	uint8_t pos, prio, nDest = 0, credits;
+	MSG_T* queued;
+	uint16_t len;
+	if(priority >= TXQ_PRIO_LEVELS) {
+		priority = TXQ_PRIO_NORMAL;
+	}
+	for(prio = 0; prio < TXQ_PRIO_LEVELS; ++prio) {
+		for(pos = 0; peek_queue(&_tx_pkt_list[prio], pos, (void**) &queued, &len) == 0; ++pos) {
+			if(txFinalDest(queued) == dest) {
+				nDest++;
+			}
+		}
+	}
+	if(nDest >= TXQ_MAX_PER_DEST) {
 		return 0;
 	}
+	credits = TXQ_SIZE - queue_size(&_tx_pkt_list[priority]);
+	if(credits > TXQ_MAX_PER_DEST - nDest) {
+		credits = TXQ_MAX_PER_DEST - nDest;
+	}
+	if(credits > msg_available()) {
+		credits = msg_available();
+	}
+	return credits;
 }
 
 /**
@@ -503,6 +822,17 @@ int8_t lowapp_tx(MSG_T* msg) {
  * @return The new state to run after trying to send the message
  */
 static STATES tryTxFrame() {
+	/* Do not pay for the preamble of a stale message */
+	if(dropCurrentIfExpired()) {
+		/* Back to standard radio TX configuration after a wake-up strobe */
+		if(wakeupTrainDone || txSyncPreamble) {
+			_sys->SYS_radioSetPreamble(_preambleLen);
+			wakeupTrainDone = false;
+			txSyncPreamble = false;
+		}
+		setTimerForUnblockingTx();
+		return IDLE;
+	}
 	LOG(LOG_PARSER, "Trying to send (tryTx)");	/* Used by log parser */
 	/* Used by log parser */
 	if(currentTxMsg == NULL) {
@@ -517,12 +847,47 @@ static STATES tryTxFrame() {
 		/* Block tx while transmitting to let time for the radio to finish the transmission */
 		LOG(LOG_DBG, "txBlocked = true");
 		txBlocked = true;
+		/* Radio parameters of the link to the destination */
+		uint8_t linkSf, linkCr;
+		int8_t linkPower;
+		link_select(lastDestination, &linkSf, &linkCr, &linkPower);
+		link_set_radio(linkSf, linkCr, linkPower);
+		/* Inside a rendezvous slot, the whole group is sampling the channel often */
+		uint16_t syncPreamble = sync_preamble();
+		/* Wake the destination up with a strobe of short frames first */
+		if(_wakeupMode && syncPreamble == 0 && !wakeupTrainDone && lastDestination != LOWAPP_ID_BROADCAST
+				&& lastDestination != LOWAPP_ID_MULTICAST) {
+			return TXING_WAKEUP;
+		}
+		if(syncPreamble != 0) {
+			_sys->SYS_radioSetPreamble(syncPreamble);
+			txSyncPreamble = true;
+		}
+		/* The destination is awake, no need for a long preamble */
+		else if(wakeupTrainDone) {
+			_sys->SYS_radioSetPreamble(PREAMBLE_WAKEUP);
+		}
+		/* Stamp the frame with the group clock as late as possible */
+		if(_syncMode && currentTxMsg != NULL &&
+				(currentTxMsg->hdr.type == TYPE_STDMSG || currentTxMsg->hdr.type == TYPE_RELAY)) {
+			currentTxMsg->hdr.rfu = sync_stamp(syncPreamble != 0);
+			currentTxLength = buildFrame(currentTxFrame, currentTxMsg);
+		}
+		/* Start of the round-trip time of a ping */
+		ping_tx_start(currentTxMsg);
+		txStartTime = _sys->SYS_getTimeMs();
 		/* Send frame */
 		_sys->SYS_radioTx(currentTxFrame, currentTxLength);
 		return TXING;
 	}
 	else {
 		retryTxFrame++;
+		coreStats.lbtBusy++;
+		/* The destination will be asleep again when we retry */
+		if(wakeupTrainDone) {
+			_sys->SYS_radioSetPreamble(_preambleLen);
+			wakeupTrainDone = false;
+		}
 
 		if(retryTxFrame < MAX_TX_FRAME_RETRY) {
 			LOG(LOG_INFO, "LBT found something, try to go to RX mode");
@@ -530,29 +895,13 @@ static STATES tryTxFrame() {
 			/* Set timer for unblocking tx */
 			txBlocked = true;
 			int32_t r = ceil(_sys->SYS_radioTimeOnAir(MAX_FRAME_SIZE))		// preamble time + max transmission
-							+randr(RANDOM_BLOCK_TX_MIN,RANDOM_BLOCK_TX_MAX)	// + random
+							+txRandomBackoff()								// + random
 							+TIMER_ACK_SLOT_START							// + time for transmitting ACK
 							+TIMER_ACK_SLOT_LENGTH;
 			LOG(LOG_DBG, "Set block timer to %d ms", r);
 			_sys->SYS_setTimer2(r);
 
-			uint8_t bufCmd[50] = "";
-
-			/* Format message for answer to the UART */
-			/* Size of the current string to add to the anwser */
-			uint8_t sizeStr = 0;
-			uint8_t offset = 0;
-			/* Build the JSON message */
-			sizeStr = strlen((char*)jsonPrefixNokTxRetry);
-			memcpy(bufCmd+offset, jsonPrefixNokTxRetry, sizeStr);
-			offset += sizeStr;
-
-			offset = FillBuffer8_t(bufCmd, offset, &retryTxFrame, 1, false);
-
-			sizeStr = strlen((char*)jsonSuffix);
-			memcpy(bufCmd+offset, jsonSuffix, sizeStr);
-			offset += sizeStr;
-			_sys->SYS_cmdResponse(bufCmd, offset);
+			txRetryResponse();
 			return RXING;
 		}
 		else {
@@ -561,6 +910,13 @@ static STATES tryTxFrame() {
 			memset(currentTxFrame, 0, MAX_FRAME_SIZE);
 			txFrameFilled = false;
 			_sys->SYS_cmdResponse((uint8_t*)jsonErrorMaxRetry, strlen((char*)jsonErrorMaxRetry));
+			if(currentTxMsg != NULL) {
+				/* Park the message or free its buffer */
+				if(!mbox_park(currentTxMsg)) {
+					msg_free(currentTxMsg);
+				}
+				currentTxMsg = NULL;
+			}
 			return RXING;
 		}
 	}
@@ -578,9 +934,16 @@ static STATES tryTxFrame() {
  * @retval #IDLE If the message type is unkown or cannot be handled
  */
 static STATES tryTxCurrent() {
+	/* No message could be allocated for the NACK or the discovery reply */
+	if(currentTxMsg == NULL) {
+		LOG(LOG_ERR, "Message pool empty, nothing to send");
+		return IDLE;
+	}
 	/* Check the type of message from its header */
 	switch (currentTxMsg->hdr.type) {
 	case TYPE_STDMSG:
+	case TYPE_RELAY:
+	case TYPE_HELLO:
 
 		/* Compute frame size */
 		currentTxLength = frameSize(currentTxMsg);
@@ -588,7 +951,23 @@ static STATES tryTxCurrent() {
 
 		LOG(LOG_DBG, "peers[out_tx]=%u\tpeers[out_rx]=%u\tpeers[in_expected]=%u", peers[currentTxMsg->content.std.destId].out_txseq, peers[currentTxMsg->content.std.destId].out_rxseq, peers[currentTxMsg->content.std.destId].in_expected);
 
-		currentTxMsg->content.std.txSeq = peers[currentTxMsg->content.std.destId].out_txseq;
+		/* Discovery requests are not numbered, they would look like missing broadcast messages */
+		if(currentTxMsg->hdr.type == TYPE_HELLO) {
+			currentTxMsg->content.std.txSeq = 0;
+		}
+		/* Multicast messages keep their own sequence number across retries */
+		else if(currentTxMsg->content.std.destId == LOWAPP_ID_MULTICAST) {
+			if(currentTxMsg->content.std.txSeq == 0) {
+				currentTxMsg->content.std.txSeq = mcast_next_seq();
+			}
+		}
+		/* Broadcast repairs keep the sequence number of the original message */
+		else if(currentTxMsg->content.std.destId == LOWAPP_ID_BROADCAST && currentTxMsg->retry != 0) {
+			LOG(LOG_INFO, "Broadcast repair %u", currentTxMsg->content.std.txSeq);
+		}
+		else {
+			currentTxMsg->content.std.txSeq = peers[currentTxMsg->content.std.destId].out_txseq;
+		}
 
 		lastDestination = currentTxMsg->content.std.destId;
 
@@ -597,9 +976,12 @@ static STATES tryTxCurrent() {
 		txFrameFilled = true;
 
 		retryTxFrame = 0;
+		wakeupTrainDone = false;
 
 		return tryTxFrame();
 	case TYPE_ACK:
+	case TYPE_NACK:
+	case TYPE_HELLO_REPLY:
 		/* For ACK, do not use the currentTxFrame buffer ! */
 		LOG(LOG_PARSER, "Trying to send ACK (tryTxAck)");	/* Used by log parser */
 		uint8_t frameBuffer[ACK_FRAME_LENGTH] = {0};
@@ -610,6 +992,9 @@ static STATES tryTxCurrent() {
 
 		LOG(LOG_INFO, "ack from %u to %u, rx %u, expect %u", currentTxMsg->content.ack.srcId, currentTxMsg->content.ack.destId, currentTxMsg->content.ack.rxdSeq, currentTxMsg->content.ack.expectedSeq);
 
+		/* Transmit power of the link to the destination */
+		link_set_power(currentTxMsg->content.ack.destId);
+
 		/* Set radio TX configuration for ACK */
 		_sys->SYS_radioSetTxFixLen(true);
 		_sys->SYS_radioSetPreamble(PREAMBLE_ACK);
@@ -620,13 +1005,33 @@ static STATES tryTxCurrent() {
 
 		LOG(LOG_DBG, "Time on air computer : %u us", _sys->SYS_radioTimeOnAir(frameBufferLength));
 
-		/* Free the message buffer */
-		free(currentTxMsg);
+		/* Free the message buffer, the ACK itself is not from the pool */
+		if(currentTxMsg != &ackTxMsg) {
+			msg_free(currentTxMsg);
+		}
+		currentTxMsg = NULL;
+		return TXING_ACK;
+	case TYPE_WAKEUP:
+		/* Early ACK, answer straight away while the sender is listening */
+		LOG(LOG_PARSER, "Trying to send early ACK (tryTxAck)");	/* Used by log parser */
+		uint8_t wakeBuffer[WAKEUP_FRAME_LENGTH] = {0};
+		uint16_t wakeBufferLength = 0;
+		wakeBufferLength = buildFrame(wakeBuffer, currentTxMsg);
+		LOG(LOG_PARSER, "Sending frame of %u bytes to node %u", wakeBufferLength, currentTxMsg->content.wake.destId);
+
+		/* Set radio TX configuration for early ACK (explicit header, short preamble) */
+		_sys->SYS_radioSetPreamble(PREAMBLE_WAKEUP);
+		_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_ack);
+
+		/* Start transmission */
+		_sys->SYS_radioTx(wakeBuffer, wakeBufferLength);
+
+		/* The early ACK is not from the pool */
 		currentTxMsg = NULL;
 		return TXING_ACK;
 	default:
 		/* Free message buffer */
-		free(currentTxMsg);
+		msg_free(currentTxMsg);
 		currentTxMsg = NULL;
 		/* #TODO Manage other message types */
 		LOG(LOG_ERR, "Unknown message type received");
@@ -635,6 +1040,58 @@ static STATES tryTxCurrent() {
 }
 
 
+/**
+ * Send one wake-up frame of the strobe to lastDestination
+ *
+ * The frame carries the time left before the data frame is sent. Radio
+ * configuration for wake-up frames is done when entering #TXING_WAKEUP.
+ */
+static void txWakeupFrame() {
+	MSG_T wakeMsg;
+	uint8_t frameBuffer[WAKEUP_FRAME_LENGTH] = {0};
+	uint16_t frameBufferLength = 0;
+	uint64_t now = _sys->SYS_getTimeMs();
+
+	wakeMsg.hdr.version = LOWAPP_CURRENT_VERSION;
+	wakeMsg.hdr.type = TYPE_WAKEUP;
+	wakeMsg.hdr.payloadLength = 0;
+	wakeMsg.hdr.rfu = 0;
+	wakeMsg.content.wake.destId = lastDestination;
+	wakeMsg.content.wake.srcId = _deviceId;
+	/* A null time to data is reserved for early ACK */
+	if(wakeupTrainEnd > now) {
+		wakeMsg.content.wake.timeToData = wakeupTrainEnd - now;
+	}
+	else {
+		wakeMsg.content.wake.timeToData = 1;
+	}
+
+	frameBufferLength = buildFrame(frameBuffer, &wakeMsg);
+	LOG(LOG_INFO, "Wake-up frame to %u, data in %u ms", lastDestination, wakeMsg.content.wake.timeToData);
+	_sys->SYS_radioTx(frameBuffer, frameBufferLength);
+}
+
+/**
+ * Carry on with the wake-up strobe after an early ACK window without ACK
+ *
+ * @return The new state to run
+ * @retval #TXING_WAKEUP If another wake-up frame was sent
+ * @retval #TXING If the strobe is over and the data frame was sent
+ * @retval #RXING If the strobe is over but the channel was busy
+ * @retval #IDLE If the strobe is over but the message expired
+ */
+static STATES nextWakeupFrame() {
+	if(_sys->SYS_getTimeMs() < wakeupTrainEnd) {
+		txWakeupFrame();
+		return TXING_WAKEUP;
+	}
+	LOG(LOG_INFO, "End of wake-up strobe without early ACK");
+	/* Send data anyway, the destination might have missed its early ACK */
+	wakeupTrainDone = true;
+	_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_std);
+	return tryTxFrame();
+}
+
 /**
  * Try sending message from the TX queue
  *
@@ -647,10 +1104,249 @@ static STATES tryTxCurrent() {
  * @retval #IDLE If the message type is unkown or cannot be handled
  */
 static STATES tryTxFromQueue() {
-	get_from_queue(&_tx_pkt_list, (void**) &currentTxMsg, &currentTxLength);
+	uint8_t prio;
+	int8_t pos;
+	dropExpiredFromQueue();
+	pos = scheduleTx(&prio);
+	if(pos < 0) {
+		return _currentState;
+	}
+	remove_from_queue(&_tx_pkt_list[prio], pos, (void**) &currentTxMsg, &currentTxLength);
+	lastScheduledDest = currentTxMsg->content.std.destId;
+	statsHist(coreStats.queueDelay, (uint32_t)_sys->SYS_getTimeMs() - currentTxMsg->queued);
 	return tryTxCurrent();
 }
 
+/**
+ * Check if a destination is parked after repeated missing ACK
+ *
+ * @param dest Destination device id
+ * @retval True If messages to this destination must be held back
+ * @retval False Otherwise
+ */
+static bool destParked(uint8_t dest) {
+	NEIGH_T* entry = neigh_find(dest);
+	if(entry == NULL || entry->parkUntil == 0) {
+		return false;
+	}
+	if((int32_t)(entry->parkUntil - (uint32_t)_sys->SYS_getTimeMs()) > 0) {
+		return true;
+	}
+	LOG(LOG_INFO, "Destination %u unparked", dest);
+	entry->parkUntil = 0;
+	return false;
+}
+
+/**
+ * Choose the next message to send from the TX queues
+ *
+ * The highest priority level holding a message that can be sent is served
+ * first. Inside a level, destinations are served in round-robin, each one
+ * getting its oldest message sent in turn. Parked destinations are skipped.
+ *
+ * @param[out] prio Priority level of the chosen message (can be NULL)
+ * @return The position of the message in the TX queue of its level
+ * @retval -1 If no message can be sent
+ */
+static int8_t scheduleTx(uint8_t* prio) {
+	uint8_t pos, dist, bestDist;
+	int8_t best, level;
+	MSG_T* msg;
+	uint16_t len;
+	for(level = TXQ_PRIO_LEVELS-1; level >= 0; --level) {
+		best = -1;
+		bestDist = 255;
+		for(pos = 0; peek_queue(&_tx_pkt_list[level], pos, (void**) &msg, &len) == 0; ++pos) {
+			/* Distance of the destination after the last one served, the last one coming last */
+			dist = msg->content.std.destId - lastScheduledDest - 1;
+			/* Strict comparison keeps the oldest message of each destination */
+			if((best < 0 || dist < bestDist) && !destParked(msg->content.std.destId)) {
+				best = pos;
+				bestDist = dist;
+			}
+		}
+		if(best >= 0) {
+			if(prio != NULL) {
+				*prio = level;
+			}
+			return best;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Check if the deadline of a message has passed
+ *
+ * @param msg Message to check
+ * @retval True If the message has a deadline and it has passed
+ * @retval False Otherwise
+ */
+static bool txExpired(MSG_T* msg) {
+	if((msg->hdr.type != TYPE_STDMSG && msg->hdr.type != TYPE_RELAY) || msg->deadline == 0) {
+		return false;
+	}
+	return (int32_t)(msg->deadline - (uint32_t)_sys->SYS_getTimeMs()) <= 0;
+}
+
+/**
+ * Get the final destination of a message to send
+ *
+ * A message sent through a relay, or flooded, is addressed to its next hop,
+ * its final destination is in its relay header.
+ *
+ * @param msg Message to send
+ * @return The device id of the final destination
+ */
+static uint8_t txFinalDest(MSG_T* msg) {
+	if(msg->hdr.type == TYPE_RELAY && msg->hdr.payloadLength >= RELAY_HDR_SIZE) {
+		return msg->content.std.payload[0];
+	}
+	return msg->content.std.destId;
+}
+
+/**
+ * Check if two messages to send go to the same destinations
+ *
+ * @param a First message
+ * @param b Second message
+ * @retval True If both have the same final destination, and the same list of
+ * receivers for multicast messages
+ * @retval False Otherwise
+ */
+static bool txSameDest(MSG_T* a, MSG_T* b) {
+	if(txFinalDest(a) != txFinalDest(b)) {
+		return false;
+	}
+	if(a->content.std.destId != LOWAPP_ID_MULTICAST) {
+		return true;
+	}
+	/* Receiver count then receivers, at the head of the payload */
+	return a->content.std.payload[0] == b->content.std.payload[0]
+			&& memcmp(a->content.std.payload+1, b->content.std.payload+1, a->content.std.payload[0]) == 0;
+}
+
+/**
+ * Drop all the expired messages from the TX queues
+ *
+ * The application is notified of each dropped message.
+ */
+static void dropExpiredFromQueue() {
+	uint8_t prio, pos;
+	MSG_T* msg;
+	uint16_t len;
+	for(prio = 0; prio < TXQ_PRIO_LEVELS; ++prio) {
+		pos = 0;
+		while(peek_queue(&_tx_pkt_list[prio], pos, (void**) &msg, &len) == 0) {
+			if(!txExpired(msg)) {
+				pos++;
+				continue;
+			}
+			remove_from_queue(&_tx_pkt_list[prio], pos, (void**) &msg, &len);
+			LOG(LOG_INFO, "Message to %u expired in the TX queue", msg->content.std.destId);
+			coreStats.txExpired++;
+			_sys->SYS_cmdResponse((uint8_t*)jsonNokTxExpired, strlen((char*)jsonNokTxExpired));
+			msg_free(msg);
+			msg = NULL;
+		}
+	}
+}
+
+/**
+ * Drop the message from currentTxMsg if it expired
+ *
+ * Used before each new attempt to send the message. The application is
+ * notified if the message is dropped.
+ *
+ * @retval True If the message was dropped
+ * @retval False If the message can still be sent
+ */
+static bool dropCurrentIfExpired() {
+	if(!txFrameFilled || currentTxMsg == NULL || !txExpired(currentTxMsg)) {
+		return false;
+	}
+	LOG(LOG_INFO, "Message to %u expired, canceling TX", currentTxMsg->content.std.destId);
+	coreStats.txExpired++;
+	_sys->SYS_cmdResponse((uint8_t*)jsonNokTxExpired, strlen((char*)jsonNokTxExpired));
+	/* Reset txFrame */
+	memset(currentTxFrame, 0, MAX_FRAME_SIZE);
+	txFrameFilled = false;
+	msg_free(currentTxMsg);
+	currentTxMsg = NULL;
+	return true;
+}
+
+/**
+ * Draw the random part of the TX blocking time
+ *
+ * The window is shortened while a high priority message is waiting, so that
+ * it gets the channel before the neighbours sending routine traffic.
+ *
+ * @return The random delay in ms
+ */
+static int32_t txRandomBackoff() {
+	if(queue_size(&_tx_pkt_list[TXQ_PRIO_HIGH]) > 0 ||
+			(txFrameFilled && currentTxMsg != NULL && currentTxMsg->priority == TXQ_PRIO_HIGH)) {
+		return randr(RANDOM_BLOCK_TX_MIN,RANDOM_BLOCK_TX_HIGH_MAX);
+	}
+	return randr(RANDOM_BLOCK_TX_MIN,RANDOM_BLOCK_TX_MAX);
+}
+
+/**
+ * Add a duration to a latency histogram of AT+STATS
+ *
+ * The first bucket counts the durations under #STATS_HIST_BASE, each following
+ * bucket doubles the bound, and the last one counts all the longer durations.
+ *
+ * @param hist Histogram of #STATS_HIST_BUCKETS buckets
+ * @param time Duration in ms
+ */
+static void statsHist(uint16_t* hist, uint32_t time) {
+	uint8_t bucket = 0;
+	uint32_t bound = STATS_HIST_BASE;
+	while(time >= bound && bucket < STATS_HIST_BUCKETS-1) {
+		bound *= 2;
+		bucket++;
+	}
+	if(hist[bucket] < UINT16_MAX) {
+		hist[bucket]++;
+	}
+}
+
+/**
+ * Decode a received frame in place, counting the frames for AT+STATS
+ *
+ * @param[out] view View of the frame
+ * @param rxDoneMessage Frame received
+ * @return The return value of #frameView
+ */
+static int8_t viewFrame(FRAME_VIEW_T* view, MSG_RXDONE_T* rxDoneMessage) {
+	int8_t received = frameView(view, rxDoneMessage->data, rxDoneMessage->length);
+	coreStats.rxFrames++;
+	if(received == -2 || received == -5) {
+		coreStats.notForMe++;
+	}
+	else if(received == -3) {
+		coreStats.crcError++;
+	}
+	return received;
+}
+
+/**
+ * Build a message from a received frame, without the payload of a standard
+ * message, counting the frames for AT+STATS
+ *
+ * @param[out] msg Message built
+ * @param rxDoneMessage Frame received
+ * @return The return value of #frameView
+ */
+static int8_t parseFrame(MSG_T* msg, MSG_RXDONE_T* rxDoneMessage) {
+	FRAME_VIEW_T view;
+	int8_t received = viewFrame(&view, rxDoneMessage);
+	frameToMessage(msg, &view, false);
+	return received;
+}
+
 /**
  * @addtogroup lowapp_core
  * @{
@@ -678,25 +1374,31 @@ uint8_t sm_run() {
 		EVENT_T evt;
 		STATES newState;
 		LOG(LOG_STATES, "Currently %u events in the queue", event_size(&_eventQ));
-		lock_eventQ();
 		/* Retrieve event from standard event queue */
 		int qs = get_event(&_eventQ, &evt.type, &evt.data, &evt.datalen);
-		unlock_eventQ();
 		/* If no event in the queue */
 		if (qs < 0) {
 			/*
-			 * Look at cold queue only if we are in idle mode and
-			 * did not have any standard queue event to process
+			 * Look at the coalesced events and at the cold queue only if
+			 * we are in idle mode and did not have any standard queue
+			 * event to process. Coalesced events posted while busy are
+			 * kept pending until then.
 			 */
 			if (_currentState == IDLE) {
-				lock_coldEventQ();
-				qs = get_event(&_coldEventQ, &evt.type, &evt.data,
-						&evt.datalen);
-				unlock_coldEventQ();
+				evt.data = NULL;
+				evt.datalen = 0;
+				qs = get_pending(&_eventQ, &evt.type);
+				if (qs < 0) {
+					qs = get_event(&_coldEventQ, &evt.type, &evt.data,
+							&evt.datalen);
+				}
+				if (qs < 0) {
+					qs = get_pending(&_coldEventQ, &evt.type);
+				}
 				/* If no event either, return */
 				if (qs < 0)
 					return LOWAPP_SM_DEEP_SLEEP;
-				LOG(LOG_STATES, "Get event %u from cold event queue", evt.type);
+				LOG(LOG_STATES, "Get event %u from idle events", evt.type);
 			}
 			else {
 				switch(_currentState) {
@@ -714,6 +1416,12 @@ uint8_t sm_run() {
 		}
 		else {
 			LOG(LOG_STATES, "Get event %u from standard event queue (forwarded to state %u)", evt.type, _currentState);
+			/* A frame received in a state which does not expect any, give its descriptor back */
+			if (evt.type == RXMSG && _currentState != RXING && _currentState != RXING_ACK
+					&& _currentState != TXING_WAKEUP) {
+				rxdone_free(evt.data);
+				continue;
+			}
 		}
 
 		/*
@@ -725,6 +1433,7 @@ uint8_t sm_run() {
 		while (newState != _currentState) {
 			evt.type = STATE_EXIT;
 			(SM[_currentState])(evt);
+			SM_PROFILE(_currentState, newState);
 			evt.type = STATE_ENTER;
 			_currentState = newState;
 			/* STATE_ENTER can also change state */
@@ -742,7 +1451,8 @@ uint8_t sm_run() {
  *
  * When entering the state, we first check if there is any AT command waiting
  * to be processed. If so, we process one of them.<br />
- * Then we check the cad flag. If the flag is raised, we move over to the CAD state.
+ * A CADTIMEOUT which occurred while the state machine was busy is kept pending
+ * and processed once back in this state.
  *
  * When a RXAT event occurs, we check the size of the AT command queue and process
  * one message.
@@ -752,6 +1462,9 @@ uint8_t sm_run() {
  *
  * When a CADTIMEOUT event occurs, we move other to CAD state.
  *
+ * When a DEFERRED event occurs, the transmissions which are due are queued,
+ * and we try sending one element of the TX queue.
+ *
  * @param evt Event to process by this state
  * @return Next state for the state machine
  */
@@ -759,43 +1472,61 @@ static STATES state_idle(EVENT_T evt) {
 	switch (evt.type) {
 	case STATE_ENTER:
 		LOG(LOG_STATES, "Entering Idle state");
+		/* Back to the group radio configuration */
+		link_set_radio(_rsf, _coderate, _power);
 		/* Check AT command queue */
-		lock_atcmd();
 		if (queue_size(&_atcmd_list) > 0) {
-			unlock_atcmd();
 			at_queue_process();
 		}
-		else {
-			unlock_atcmd();
-		}
 
 		/* Manage push mode */
-		if(_opMode == PUSH && queue_size(&_rx_pkt_list) > 0) {
+		if(_opMode == PUSH && rxq_count() > 0) {
 			response_rx_packets();
 		}
 
+		/* Deferred transmissions which became due while busy */
+		if(deferredReady) {
+			deferred_poll();
+		}
+
 		/* Check if tx is blocked */
-		if(!txBlocked) {
+		if(!txBlocked && sync_tx_allowed()) {
 			/* Unblock signal occured, try to send frame */
 			if(txFrameFilled) {
 				return tryTxFrame();
 			}
 			else {
 				/* Check tx queue */
-				if (queue_size(&_tx_pkt_list) > 0) {
+				if (scheduleTx(NULL) >= 0) {
 					return tryTxFromQueue();
 				}
 			}
 		}
 		return _currentState;
 	case TXUNBLOCK:
+		/* Wait for the next rendezvous slot */
+		if(!sync_tx_allowed()) {
+			return _currentState;
+		}
 		/* Unblock signal occured, try to send frame */
 		if(txFrameFilled) {
 			return tryTxFrame();
 		}
 		else {
 			/* Check tx queue */
-			if (queue_size(&_tx_pkt_list) > 0) {
+			if (scheduleTx(NULL) >= 0) {
+				return tryTxFromQueue();
+			}
+		}
+		return _currentState;
+	case DEFERRED:
+		deferred_poll();
+		/* Send them as any other queued message */
+		if(!txBlocked && sync_tx_allowed()) {
+			if(txFrameFilled) {
+				return tryTxFrame();
+			}
+			else if (scheduleTx(NULL) >= 0) {
 				return tryTxFromQueue();
 			}
 		}
@@ -803,32 +1534,35 @@ static STATES state_idle(EVENT_T evt) {
 	case RXAT:
 		LOG(LOG_STATES, "RXAT");
 		/* Check AT command queue */
-		lock_atcmd();
 		if (queue_size(&_atcmd_list) > 0) {
-			unlock_atcmd();
-			at_queue_process();
-		}
-		else {
-			unlock_atcmd();
+			at_queue_process();
 		}
 		return _currentState;
 	case TXREQ:
 		LOG(LOG_DBG, "Processing of TXREQ");
 		/* Check if tx is blocked */
-		if(!txBlocked) {
+		if(!txBlocked && sync_tx_allowed()) {
 			/* Unblock signal occured, try to send frame */
 			if(txFrameFilled) {
 				return tryTxFrame();
 			}
 			else {
 				/* Check tx queue */
-				if (queue_size(&_tx_pkt_list) > 0) {
+				if (scheduleTx(NULL) >= 0) {
 					return tryTxFromQueue();
 				}
 			}
 		}
 		return _currentState;
 	case CADTIMEOUT:
+		/* Keep sleeping while another node is being woken up */
+		if(_sys->SYS_getTimeMs() < wakeupSleepUntil) {
+			return _currentState;
+		}
+		/* Sleep between rendezvous slots */
+		if(!sync_listen_allowed()) {
+			return _currentState;
+		}
 		return CAD;
 	default:
 		return _currentState;		// Ignore event and stay here
@@ -843,21 +1577,39 @@ static STATES state_idle(EVENT_T evt) {
  * either posts a RXMSG event if a message was successfully received, a RXERROR
  * event if an error occurred or a TIMEOUT event if nothing happened.
  *
- * When a RXMSG event occurs, we build a corresponding MSG_T event from the
- * frame buffer, add it to the RX queue, build a ACK message and move to Wait slot
- * tx ack state.
+ * When a RXMSG event occurs, we decode the frame in place, copy it to the RX
+ * queue, build a ACK message and move to Wait slot tx ack state. A MSG_T is
+ * only allocated for the relayed messages, the discovery requests and the
+ * wake-up frames, nothing is copied from the frames destined to other nodes.
+ * The frames dropped from their cleartext hint are not even decoded, and may
+ * have been cut short by the radio layer.
  *
  * @param evt Event to process by this state
  * @return Next state for the state machine
  */
 static STATES state_rxing(EVENT_T evt) {
 	MSG_T* msg = NULL;
-	MSG_RX_APP_T *msg_rx_app = NULL;
+	/* Fields of a standard message, its payload being left in the frame */
+	MSG_T rxFrame;
+	FRAME_VIEW_T view;
+	MSG_RX_STATE_T* rxState = NULL;
+	STATES nextState;
+	int16_t rssi;
+	int8_t snr;
 	int8_t received;
+	uint16_t rxLength;
+	uint16_t frameLength;
 	MSG_RXDONE_T* rxDoneMessage = NULL;
 	switch (evt.type) {
 	case STATE_ENTER:
 		LOG(LOG_PARSER, "Entering RXING state");
+		/* Data frame expected after an early ACK */
+		if(wakeupRxTimeout != 0) {
+			LOG(LOG_DBG, "Waiting for data after early ACK (%u ms)", wakeupRxTimeout);
+			_sys->SYS_radioRx(wakeupRxTimeout);
+			wakeupRxTimeout = 0;
+			return _currentState;
+		}
 		LOG(LOG_DBG, "Timer safeguard at %u", timer_safeguard_rxing_std);
 		/* Start radio reception */
 		_sys->SYS_radioRx(timer_safeguard_rxing_std);
@@ -867,140 +1619,164 @@ static STATES state_rxing(EVENT_T evt) {
 		LOG(LOG_STATES, "Processing RXMSG event");
 		if (rxDoneMessage == NULL || rxDoneMessage->data == NULL) {
 			LOG(LOG_ERR, "No data received with RXMSG event");
+			rxdone_free(rxDoneMessage);
 			return IDLE;
 		}
-		/* Build MSG_T from message frame */
-		msg = malloc(sizeof(MSG_T));
-		received = retrieveMessage(msg, rxDoneMessage->data);
+		/* Decode the frame in place */
+		received = viewFrame(&view, rxDoneMessage);
+		/* Wake-up frames, relayed messages and discovery requests are handled apart */
+		if ((received != -3 && view.hdr.type == TYPE_WAKEUP)
+				|| (received == 0 && (view.hdr.type == TYPE_RELAY || view.hdr.type == TYPE_HELLO))) {
+			msg = msg_alloc();
+			if (msg == NULL) {
+				LOG(LOG_ERR, "Message pool empty, frame dropped");
+				rxdone_free(rxDoneMessage);
+				rxDoneMessage = NULL;
+				return IDLE;
+			}
+			frameToMessage(msg, &view, true);
+		}
+		if (received != -3 && view.hdr.type == TYPE_WAKEUP) {
+			rxdone_free(rxDoneMessage);
+			rxDoneMessage = NULL;
+			return process_wakeup(msg, received);
+		}
+		/* Follow the group clock, even from messages destined to other nodes */
+		if ((received == 0 || received == -2) &&
+				(view.hdr.type == TYPE_STDMSG || view.hdr.type == TYPE_RELAY)) {
+			sync_process_stamp(view.hdr.rfu, rxDoneMessage->length);
+		}
 		/* Check destination */
 		if (received == 0) {
-			/* Create message for app with the state included */
-			msg_rx_app = (MSG_RX_APP_T*) malloc(sizeof(MSG_RX_APP_T));
-			memset(msg_rx_app, 0, sizeof(MSG_RX_APP_T));
-			msg_rx_app->msg = msg;
-			msg_rx_app->rssi = rxDoneMessage->rssi;
-			msg_rx_app->snr = rxDoneMessage->snr;
+			/* Relayed message, acknowledged hop by hop */
+			if(view.hdr.type == TYPE_RELAY) {
+				return process_relay(msg, rxDoneMessage);
+			}
+			/* Discovery request, answered in a random slot */
+			if(view.hdr.type == TYPE_HELLO) {
+				return process_hello(msg, rxDoneMessage);
+			}
+			/* Skip the destination list of a multicast message and find our ACK slot */
+			if(view.hdr.type == TYPE_STDMSG && FRAME_DEST(&view) == LOWAPP_ID_MULTICAST) {
+				ackSlotDelay = mcast_accept(&view);
+			}
+			else {
+				ackSlotDelay = TIMER_ACK_SLOT_TX;
+			}
+			msg = &rxFrame;
+			frameToMessage(msg, &view, false);
+			rssi = rxDoneMessage->rssi;
+			snr = rxDoneMessage->snr;
+			/* Copy the message to the RX queue, its state being flagged below */
+			rxState = rxq_push(&view, rssi, snr);
 			/* Free the memory for the rx done message structure */
-			free(rxDoneMessage);
+			rxdone_free(rxDoneMessage);
 			rxDoneMessage = NULL;
-			/* Add message with state to the rx_pkt_list fifo */
-			received = add_to_queue(&_rx_pkt_list, msg_rx_app, sizeof(MSG_RX_APP_T));
 			/* Add to the statistics */
-			STAT_T stat;
-			stat.deviceId = msg->content.std.srcId;
-			stat.lastRssi = msg_rx_app->rssi;
-			stat.lastSeen = _sys->SYS_getTimeMs();
-			add_to_statqueue(&statisticsWho, stat);
+			neigh_rx(msg->content.std.srcId, rssi, snr);
+			/* The node is reachable again */
+			mbox_heard(msg->content.std.srcId);
 
 			/* Check the message was added to the queue (queue not full) */
-			if(received != -1) {
+			if(rxState != NULL) {
 				LOG(LOG_PARSER, "Received message from %u", msg->content.std.srcId);
 				LOG(LOG_DBG, "peers[out_tx]=%u\tpeers[out_rx]=%u\tpeers[in_expected]=%u", peers[msg->content.std.srcId].out_txseq, peers[msg->content.std.srcId].out_rxseq, peers[msg->content.std.srcId].in_expected);
 
 				/* Manage broadcast */
 				if(msg->content.std.destId == LOWAPP_ID_BROADCAST) {
 					LOG(LOG_INFO, "Broadcast received");
-					return IDLE;
+					if(!_relBcastMode) {
+						nextState = IDLE;
+					}
+					/* Report the missing broadcast messages of the source in a random slot */
+					else if(rbc_receive(msg, rxState)) {
+						currentTxMsg = rbc_build_nack(msg->content.std.srcId, snr);
+						ackSlotDelay = rbc_nack_delay();
+						nextState = WAIT_SLOT_TX_ACK;
+					}
+					/* Leave the channel to the NACK of the other receivers */
+					else {
+						ackSkipTime = rbc_window();
+						nextState = SKIPPING_ACK;
+					}
 				}
-				else {
+				/* Multicast messages do not take part in the sequence numbers of the link */
+				else if(msg->content.std.destId == LOWAPP_ID_MULTICAST) {
+					LOG(LOG_INFO, "Multicast received, ACK in %u ms", ackSlotDelay);
+					if(msg->content.std.txSeq == peers[msg->content.std.srcId].in_mcast) {
+						LOG(LOG_WARN, "Duplicate frame detected !");
+						coreStats.duplicate++;
+						rxState->duplicate_flag = 1;
+					}
+					peers[msg->content.std.srcId].in_mcast = msg->content.std.txSeq;
 
 					/* Prepare ACK message */
-					currentTxMsg = (MSG_T*) malloc(sizeof(MSG_T));
-
+					currentTxMsg = &ackTxMsg;
 					currentTxMsg->hdr.payloadLength = 0;
 					currentTxMsg->hdr.type = TYPE_ACK;
 					currentTxMsg->hdr.version = LOWAPP_CURRENT_VERSION;
+					currentTxMsg->hdr.rfu = link_margin_report(snr);
 					currentTxMsg->content.ack.destId = msg->content.std.srcId;
 					currentTxMsg->content.ack.srcId = _deviceId;
-					/* Sequence number is 0 if the sender node has been re-initialised */
-					if(msg->content.std.txSeq == 0 && peers[msg->content.std.srcId].in_expected != 0) {
-						LOG(LOG_INFO, "Sender's node got initialised");
-						peers[msg->content.std.srcId].in_expected = 0;
-						peers[msg->content.std.srcId].out_txseq = 0;
-						peers[msg->content.std.srcId].out_rxseq = 0;
-					}
-
-					/* Fill ACK sequence numbers */
-					currentTxMsg->content.ack.expectedSeq = peers[msg->content.std.srcId].in_expected;
+					currentTxMsg->content.ack.expectedSeq = msg->content.std.txSeq;
 					currentTxMsg->content.ack.rxdSeq = msg->content.std.txSeq;
 
-					/* Send ACK as of now */
-
-					/* If the sequence number is the one we were expecting */
-					if(msg->content.std.txSeq == peers[msg->content.std.srcId].in_expected) {
-						LOG(LOG_INFO, "Received seq = expected seq");
-						/* Update sequence number */
-						peers[msg->content.std.srcId].in_expected = (peers[msg->content.std.srcId].in_expected % 255) + 1;
-					}
-					/*
-					 * If the sequence number from the message is bigger than what we were expecting.
-					 * Take into account rollover of the variable using two thresholds.
-					 */
-					else if(msg->content.std.txSeq > peers[msg->content.std.srcId].in_expected ||
-								(msg->content.std.txSeq < SEQ_ROLLOVER_LOW_THRESHOLD
-									&& peers[msg->content.std.srcId].in_expected > SEQ_ROLLOVER_HIGH_THRESHOLD)) {
-						LOG(LOG_INFO, "Received seq > expected seq");
-						LOG(LOG_WARN, "%u missing frames !", msg->content.std.txSeq - peers[msg->content.std.srcId].in_expected);
-						/* Notify app by setting state for message added to _rx_pkt */
-						msg_rx_app->state.missing_frames = msg->content.std.txSeq - peers[msg->content.std.srcId].in_expected;
-						/* Catch up with the actual received sequence number */
-						peers[msg->content.std.srcId].in_expected = (msg->content.std.txSeq % 255) + 1;
-					}
-					/*
-					 * Duplicate frame is detected if the txSeq of the message is slightly lower than
-					 * the expected sequence number.
-					 */
-					else if((msg->content.std.txSeq < peers[msg->content.std.srcId].in_expected
-							 || (msg->content.std.txSeq > SEQ_ROLLOVER_HIGH_THRESHOLD &&
-									 peers[msg->content.std.srcId].in_expected < SEQ_ROLLOVER_LOW_THRESHOLD))
-							&& (peers[msg->content.std.srcId].in_expected - msg->content.std.txSeq) < 10) {
-						LOG(LOG_INFO, "Received seq < expected seq");
-						LOG(LOG_WARN, "Duplicate frame detected !");
-						msg_rx_app->state.duplicate_flag = 1;
-					}
-					else {
-						LOG(LOG_ERR, "Unexpected difference found between txSeq (%u) and peers[%u].in_expected (%u)",
-								msg->content.std.txSeq, msg->content.std.srcId, peers[msg->content.std.srcId].in_expected);
-					}
-
-					LOG(LOG_INFO, "Sequence number received");
-
-					LOG(LOG_DBG, "peers[out_tx]=%u\tpeers[out_rx]=%u\tpeers[in_expected]=%u", peers[msg->content.std.srcId].out_txseq, peers[msg->content.std.srcId].out_rxseq, peers[msg->content.std.srcId].in_expected);
+					/* Our own slot before sending Ack */
+					nextState = WAIT_SLOT_TX_ACK;
+				}
+				else {
+					/* Prepare ACK message */
+					prepare_ack(msg, rxState, snr);
 
 					/* Slot before sending Ack */
-					return WAIT_SLOT_TX_ACK;
+					nextState = WAIT_SLOT_TX_ACK;
 				}
 			}
 			else {
 				/* An error occurred during radio reception */
 				LOG(LOG_ERR, "RX queue was full");
-				/* Free buffer */
-				free(msg);
-				msg = NULL;
-				return IDLE;
+				coreStats.queueFull++;
+				_sys->SYS_cmdResponse((uint8_t*)jsonNokRxQueueFull, strlen((char*)jsonNokRxQueueFull));
+				nextState = IDLE;
 			}
+			return nextState;
 		}
 		else {
+			rxLength = rxDoneMessage->length;
 			/* Free the memory for the rx done message structure */
-			free(rxDoneMessage);
+			rxdone_free(rxDoneMessage);
 			rxDoneMessage = NULL;
+			/* Dropped from its hint, possibly before its end: sleep until the end of its ACK window */
+			if(received == -2 && view.content == NULL) {
+				LOG(LOG_PARSER, "Received message not for me, dropped from its hint");
+				frameLength = FRAME_HINT_END + FRAME_NONCE_SIZE + FRAME_STD_HDR_SIZE + view.hdr.payloadLength + FRAME_CRC_SIZE;
+				if(rxLength < frameLength) {
+					ackSkipTime += _sys->SYS_radioTimeOnAir(frameLength) - _sys->SYS_radioTimeOnAir(rxLength);
+				}
+				return SKIPPING_ACK;
+			}
 			/* If the packet was destined to someone else, log a message */
-			if(received == -2 && msg->hdr.type == TYPE_STDMSG) {
-				LOG(LOG_PARSER, "Received message from %u not for me", msg->content.std.srcId);
-				/* Free message if it was not destined to us */
-				free(msg);
-				msg = NULL;
+			if(received == -2 && (view.hdr.type == TYPE_STDMSG || view.hdr.type == TYPE_RELAY)) {
+				LOG(LOG_PARSER, "Received message from %u not for me", FRAME_SRC(&view));
+				/* The node is reachable again */
+				mbox_heard(FRAME_SRC(&view));
+				/* The relay of a message tells us how to reach its origin */
+				if(view.hdr.type == TYPE_RELAY) {
+					route_overheard(&view);
+				}
+				/* Wait for all the ACK slots of a multicast message */
+				if(FRAME_DEST(&view) == LOWAPP_ID_MULTICAST) {
+					ackSkipTime = mcast_window(&view);
+				}
 				return SKIPPING_ACK;
 			}
 			/* If the CRC check failed */
-			else if(received == -3 && msg->hdr.type == TYPE_STDMSG) {
+			else if(received == -3 && (view.hdr.type == TYPE_STDMSG || view.hdr.type == TYPE_RELAY)) {
 				LOG(LOG_PARSER, "CRC check failed");
 			}
-
-			if(msg != NULL) {
-				/* Free message if it was not destined to us */
-				free(msg);
-				msg = NULL;
+			/* Another group, dropped from its hint like a frame failing its CRC */
+			else if(received == -5) {
+				LOG(LOG_PARSER, "Received message of another group");
 			}
 			return IDLE;
 		}
@@ -1027,7 +1803,8 @@ static STATES state_skipping_ack(EVENT_T evt) {
 	switch (evt.type) {
 	case STATE_ENTER:
 		LOG(LOG_INFO, "Skipping ACK window");
-		_sys->SYS_setTimer(TIMER_ACK_SLOT_START+TIMER_ACK_SLOT_LENGTH);
+		_sys->SYS_setTimer(ackSkipTime);
+		ackSkipTime = TIMER_ACK_SLOT_START+TIMER_ACK_SLOT_LENGTH;
 		return _currentState;
 	case TIMEOUT:
 		LOG(LOG_INFO, "Skipping timeout");
@@ -1053,7 +1830,7 @@ static STATES state_wait_slot_tx_ack(EVENT_T evt) {
 	switch(evt.type) {
 	case STATE_ENTER:
 		LOG(LOG_STATES, "Entering Wait slot TX ACK state");
-		_sys->SYS_setTimer(TIMER_ACK_SLOT_TX);
+		_sys->SYS_setTimer(ackSlotDelay);
 		return _currentState;
 	case TIMEOUT:
 		return tryTxCurrent();
@@ -1080,15 +1857,22 @@ static STATES state_txingack(EVENT_T evt) {
 		_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_std);
 
 		LOG(LOG_INFO, "ACK transmitted");
+		coreStats.txFrames++;
+		/* Stay awake for the data frame after an early ACK */
+		if(wakeupRxTimeout != 0) {
+			return RXING;
+		}
 		return IDLE;
 	case TIMEOUT:
 	case TXTIMEOUT:
 		LOG(LOG_ERR, "Transmission of ACK timed out");
+		coreStats.txTimeout++;
 
 		/* Back to standard radio TX configuration */
 		_sys->SYS_radioSetTxFixLen(false);
 		_sys->SYS_radioSetPreamble(_preambleLen);
 		_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_std);
+		wakeupRxTimeout = 0;
 
 		return IDLE;
 	default:
@@ -1116,9 +1900,19 @@ static STATES state_txing(EVENT_T evt) {
 		LOG(LOG_STATES, "Entering TXING state (Transmitting message)");
 		return _currentState;
 	case TXDONE:
-		/* Increment sequence number when tx done*/
-		peers[lastDestination].out_txseq =
-			(peers[lastDestination].out_txseq % 255) + 1;
+		coreStats.txFrames++;
+		/* Back to standard preamble if the frame followed a wake-up strobe */
+		if(wakeupTrainDone || txSyncPreamble) {
+			_sys->SYS_radioSetPreamble(_preambleLen);
+			wakeupTrainDone = false;
+			txSyncPreamble = false;
+		}
+		/* Increment sequence number when tx done, repairs reuse an old one */
+		if(currentTxMsg == NULL || lastDestination != LOWAPP_ID_BROADCAST
+				|| (currentTxMsg->retry == 0 && currentTxMsg->hdr.type != TYPE_HELLO)) {
+			peers[lastDestination].out_txseq =
+				(peers[lastDestination].out_txseq % 255) + 1;
+		}
 		LOG(LOG_STATES, "peers[out_tx]=%u\tpeers[out_rx]=%u\tpeers[in_expected]=%u", peers[lastDestination].out_txseq, peers[lastDestination].out_rxseq, peers[lastDestination].in_expected);
 
 		/* Block transmissions for the duration of one preamble */
@@ -1129,50 +1923,74 @@ static STATES state_txing(EVENT_T evt) {
 
 		LOG(LOG_DBG, "frameFIlled = false");
 		/* Check if an ACK is expected */
-		if(lastDestination == LOWAPP_ID_BROADCAST) {
+		/* Listen for the replies to a discovery request */
+		if(currentTxMsg != NULL && currentTxMsg->hdr.type == TYPE_HELLO) {
+			hello_sent(currentTxMsg);
+			msg_free(currentTxMsg);
+			currentTxMsg = NULL;
+			return WAIT_BEFORE_LISTENING_FOR_ACK;
+		}
+		/* Keep the broadcast message for repairs and listen for NACK */
+		else if(lastDestination == LOWAPP_ID_BROADCAST && _relBcastMode && currentTxMsg != NULL
+				&& currentTxMsg->hdr.type == TYPE_STDMSG) {
+			rbc_sent(currentTxMsg);
+			currentTxMsg = NULL;
+			return WAIT_BEFORE_LISTENING_FOR_ACK;
+		}
+		else if(lastDestination == LOWAPP_ID_BROADCAST) {
 			setTimerForUnblockingTx();
 			if(currentTxMsg != NULL) {
 				/* Free message buffer */
-				free(currentTxMsg);
+				msg_free(currentTxMsg);
 				currentTxMsg = NULL;
 			}
 			return IDLE;
 		}
 		else {
 			LOG(LOG_DBG, "Not broadcast !");
+			/* ACK are always sent with the group coding rate */
+			link_restore_coderate();
+			ping_sent(currentTxMsg);
+			/* Keep a multicast message until all its ACK slots are over */
+			if(lastDestination == LOWAPP_ID_MULTICAST && currentTxMsg != NULL) {
+				mcast_start(currentTxMsg);
+				currentTxMsg = NULL;
+			}
+			/* Keep a unicast message until it is acknowledged */
+			if(_mailboxMode && currentTxMsg != NULL) {
+				mbox_sent(currentTxMsg);
+				currentTxMsg = NULL;
+			}
 			if(currentTxMsg != NULL) {
 				/* Free message buffer */
-				free(currentTxMsg);
+				msg_free(currentTxMsg);
 				currentTxMsg = NULL;
 			}
 			return WAIT_BEFORE_LISTENING_FOR_ACK;
 		}
 	case TIMEOUT:
 	case TXTIMEOUT:
+		coreStats.txTimeout++;
 		setTimerForUnblockingTx();
 
+		/* Back to standard preamble, a new strobe is needed for the retry */
+		if(wakeupTrainDone || txSyncPreamble) {
+			_sys->SYS_radioSetPreamble(_preambleLen);
+			wakeupTrainDone = false;
+			txSyncPreamble = false;
+		}
+
 		/* Increment retry */
 		retryTxFrame++;
 
+		/* The message expired while we were trying */
+		if(dropCurrentIfExpired()) {
+			return IDLE;
+		}
 		/* If we can still retry transmission */
 		if(retryTxFrame < MAX_TX_FRAME_RETRY) {
 			LOG(LOG_ERR, "TX Timeout (retry %u)", retryTxFrame);
-			uint8_t bufCmd[50] = "";
-			/* Format message for answer to the UART */
-			/* Size of the current string to add to the anwser */
-			uint8_t sizeStr = 0;
-			uint8_t offset = 0;
-			/* Build the JSON message */
-			sizeStr = strlen((char*)jsonPrefixNokTxRetry);
-			memcpy(bufCmd, jsonPrefixNokTxRetry, sizeStr);
-			offset += sizeStr;
-
-			offset = FillBuffer8_t(bufCmd, offset, &retryTxFrame, 1, false);
-
-			sizeStr = strlen((char*)jsonSuffix);
-			memcpy(bufCmd+offset, jsonSuffix, sizeStr);
-			offset += sizeStr;
-			_sys->SYS_cmdResponse(bufCmd, offset);
+			txRetryResponse();
 			return IDLE;
 		}
 		else {
@@ -1181,8 +1999,10 @@ static STATES state_txing(EVENT_T evt) {
 
 			txFrameFilled = false;
 			if(currentTxMsg != NULL) {
-				/* Free message buffer */
-				free(currentTxMsg);
+				/* Park the message or free its buffer */
+				if(!mbox_park(currentTxMsg)) {
+					msg_free(currentTxMsg);
+				}
 				currentTxMsg = NULL;
 			}
 			return IDLE;
@@ -1385,6 +2205,343 @@ void process_ack(MSG_T* msg) {
 	LOG(LOG_DBG, "peers[out_tx]=%u\tpeers[out_rx]=%u\tpeers[in_expected]=%u", peers[msg->content.ack.srcId].out_txseq, peers[msg->content.ack.srcId].out_rxseq, peers[msg->content.ack.srcId].in_expected);
 }
 
+/**
+ * Prepare the ACK of a unicast message received, in #currentTxMsg
+ *
+ * Updates the sequence numbers of the link to the sender, and flags missing or
+ * duplicate messages.
+ *
+ * @param msg Message received
+ * @param rxState State of the message in the RX queue, NULL if the message is
+ * not forwarded to the application
+ * @param snr SNR of the message received (dB)
+ */
+static void prepare_ack(MSG_T* msg, MSG_RX_STATE_T* rxState, int8_t snr) {
+	/* Sequence number is 0 if the sender node has been re-initialised */
+	if(msg->content.std.txSeq == 0 && peers[msg->content.std.srcId].in_expected != 0) {
+		LOG(LOG_INFO, "Sender's node got initialised");
+		peers[msg->content.std.srcId].in_expected = 0;
+		peers[msg->content.std.srcId].out_txseq = 0;
+		peers[msg->content.std.srcId].out_rxseq = 0;
+	}
+
+	currentTxMsg = &ackTxMsg;
+	currentTxMsg->hdr.payloadLength = 0;
+	currentTxMsg->hdr.type = TYPE_ACK;
+	currentTxMsg->hdr.version = LOWAPP_CURRENT_VERSION;
+	/* Report the link margin for the sender's power control */
+	currentTxMsg->hdr.rfu = link_margin_report(snr);
+	currentTxMsg->content.ack.destId = msg->content.std.srcId;
+	currentTxMsg->content.ack.srcId = _deviceId;
+	/* Fill ACK sequence numbers */
+	currentTxMsg->content.ack.expectedSeq = peers[msg->content.std.srcId].in_expected;
+	currentTxMsg->content.ack.rxdSeq = msg->content.std.txSeq;
+
+	/* Send ACK as of now */
+
+	/* If the sequence number is the one we were expecting */
+	if(msg->content.std.txSeq == peers[msg->content.std.srcId].in_expected) {
+		LOG(LOG_INFO, "Received seq = expected seq");
+		/* Update sequence number */
+		peers[msg->content.std.srcId].in_expected = (peers[msg->content.std.srcId].in_expected % 255) + 1;
+	}
+	/*
+	 * If the sequence number from the message is bigger than what we were expecting.
+	 * Take into account rollover of the variable using two thresholds.
+	 */
+	else if(msg->content.std.txSeq > peers[msg->content.std.srcId].in_expected ||
+				(msg->content.std.txSeq < SEQ_ROLLOVER_LOW_THRESHOLD
+					&& peers[msg->content.std.srcId].in_expected > SEQ_ROLLOVER_HIGH_THRESHOLD)) {
+		LOG(LOG_INFO, "Received seq > expected seq");
+		LOG(LOG_WARN, "%u missing frames !", msg->content.std.txSeq - peers[msg->content.std.srcId].in_expected);
+		/* Notify app by setting state for message added to the RX queue */
+		if(rxState != NULL) {
+			rxState->missing_frames = msg->content.std.txSeq - peers[msg->content.std.srcId].in_expected;
+			coreStats.missingFrames += rxState->missing_frames;
+		}
+		neigh_missed(msg->content.std.srcId, msg->content.std.txSeq - peers[msg->content.std.srcId].in_expected);
+		/* Catch up with the actual received sequence number */
+		peers[msg->content.std.srcId].in_expected = (msg->content.std.txSeq % 255) + 1;
+	}
+	/*
+	 * Duplicate frame is detected if the txSeq of the message is slightly lower than
+	 * the expected sequence number.
+	 */
+	else if((msg->content.std.txSeq < peers[msg->content.std.srcId].in_expected
+			 || (msg->content.std.txSeq > SEQ_ROLLOVER_HIGH_THRESHOLD &&
+					 peers[msg->content.std.srcId].in_expected < SEQ_ROLLOVER_LOW_THRESHOLD))
+			&& (peers[msg->content.std.srcId].in_expected - msg->content.std.txSeq) < 10) {
+		LOG(LOG_INFO, "Received seq < expected seq");
+		LOG(LOG_WARN, "Duplicate frame detected !");
+		coreStats.duplicate++;
+		if(rxState != NULL) {
+			rxState->duplicate_flag = 1;
+		}
+	}
+	else {
+		LOG(LOG_ERR, "Unexpected difference found between txSeq (%u) and peers[%u].in_expected (%u)",
+				msg->content.std.txSeq, msg->content.std.srcId, peers[msg->content.std.srcId].in_expected);
+	}
+
+	LOG(LOG_INFO, "Sequence number received");
+
+	LOG(LOG_DBG, "peers[out_tx]=%u\tpeers[out_rx]=%u\tpeers[in_expected]=%u", peers[msg->content.std.srcId].out_txseq, peers[msg->content.std.srcId].out_rxseq, peers[msg->content.std.srcId].in_expected);
+}
+
+/**
+ * Process a relayed message received in #RXING
+ *
+ * The message is acknowledged to the previous hop like a unicast message. It
+ * is then delivered to the application if we are its final destination, or
+ * forwarded to the next hop. A flooded message is not acknowledged, and is
+ * delivered the first time it is received.
+ *
+ * @param msg Relayed message received, freed by this function
+ * @param rxDoneMessage Radio reception information, freed by this function
+ * @return Next state for the state machine
+ */
+static STATES process_relay(MSG_T* msg, MSG_RXDONE_T* rxDoneMessage) {
+	FRAME_VIEW_T view;
+	STATES nextState;
+	bool deliver;
+	int16_t rssi = rxDoneMessage->rssi;
+	int8_t snr = rxDoneMessage->snr;
+	rxdone_free(rxDoneMessage);
+	rxDoneMessage = NULL;
+
+	neigh_rx(msg->content.std.srcId, rssi, snr);
+	/* The previous hop is reachable again */
+	mbox_heard(msg->content.std.srcId);
+
+	/* Flooded broadcast message, not acknowledged */
+	if(msg->content.std.destId == LOWAPP_ID_BROADCAST) {
+		nextState = IDLE;
+		deliver = flood_receive(msg);
+	}
+	else {
+		/* ACK to the previous hop, with the sequence numbers of that link */
+		ackSlotDelay = TIMER_ACK_SLOT_TX;
+		prepare_ack(msg, NULL, snr);
+		nextState = WAIT_SLOT_TX_ACK;
+		deliver = route_relay_in(msg);
+	}
+	if(!deliver) {
+		msg_free(msg);
+		msg = NULL;
+		return nextState;
+	}
+
+	/* Deliver the message from its origin, copied to the RX queue */
+	view.hdr = msg->hdr;
+	view.content = &msg->content.std.destId;
+	view.payload = msg->content.std.payload;
+	if(rxq_push(&view, rssi, snr) == NULL) {
+		LOG(LOG_ERR, "RX queue was full");
+		coreStats.queueFull++;
+		_sys->SYS_cmdResponse((uint8_t*)jsonNokRxQueueFull, strlen((char*)jsonNokRxQueueFull));
+	}
+	else {
+		LOG(LOG_PARSER, "Received message from %u", msg->content.std.srcId);
+	}
+	msg_free(msg);
+	msg = NULL;
+	return nextState;
+}
+
+/**
+ * Process a neighbour discovery request received in #RXING
+ *
+ * The request is not delivered to the application. The reply is sent in a
+ * random slot, with the RSSI of the request and our CAD phase.
+ *
+ * @param msg Discovery request received, freed by this function
+ * @param rxDoneMessage Radio reception information, freed by this function
+ * @return Next state for the state machine
+ */
+static STATES process_hello(MSG_T* msg, MSG_RXDONE_T* rxDoneMessage) {
+	int16_t rssi = rxDoneMessage->rssi;
+	int8_t snr = rxDoneMessage->snr;
+	rxdone_free(rxDoneMessage);
+	rxDoneMessage = NULL;
+
+	LOG(LOG_PARSER, "Received hello from %u", msg->content.std.srcId);
+	neigh_rx(msg->content.std.srcId, rssi, snr);
+	/* The node is reachable again */
+	mbox_heard(msg->content.std.srcId);
+
+	currentTxMsg = hello_build_reply(msg, rssi, snr, &ackSlotDelay);
+	msg_free(msg);
+	msg = NULL;
+	return WAIT_SLOT_TX_ACK;
+}
+
+/**
+ * Process a wake-up frame received in #RXING
+ *
+ * A node which is not the destination goes straight back to sleep and skips
+ * CAD until the data frame and its ACK are over. The destination answers with
+ * an early ACK and stays awake for the data frame.
+ *
+ * @param msg Message received (wake-up), freed by this function
+ * @param received Return value of #frameView for this message
+ * @return Next state for the state machine
+ */
+static STATES process_wakeup(MSG_T* msg, int8_t received) {
+	if(received == -2) {
+		LOG(LOG_PARSER, "Received wake-up from %u not for me", msg->content.wake.srcId);
+		wakeupSleepUntil = _sys->SYS_getTimeMs() + msg->content.wake.timeToData
+				+ timer_safeguard_txing_std + TIMER_ACK_SLOT_START + TIMER_ACK_SLOT_LENGTH;
+	}
+	else if(received == 0 && msg->content.wake.timeToData != 0) {
+		LOG(LOG_PARSER, "Received wake-up from %u", msg->content.wake.srcId);
+		/* Prepare early ACK */
+		currentTxMsg = &ackTxMsg;
+		currentTxMsg->hdr.version = LOWAPP_CURRENT_VERSION;
+		currentTxMsg->hdr.type = TYPE_WAKEUP;
+		currentTxMsg->hdr.payloadLength = 0;
+		currentTxMsg->hdr.rfu = 0;
+		currentTxMsg->content.wake.destId = msg->content.wake.srcId;
+		currentTxMsg->content.wake.srcId = _deviceId;
+		currentTxMsg->content.wake.timeToData = 0;
+		/* Listen until the end of the strobe if the early ACK gets lost */
+		wakeupRxTimeout = msg->content.wake.timeToData + timer_safeguard_rxing_std;
+		msg_free(msg);
+		msg = NULL;
+		return tryTxCurrent();
+	}
+	else {
+		LOG(LOG_INFO, "Unexpected wake-up frame ignored");
+	}
+	msg_free(msg);
+	msg = NULL;
+	return IDLE;
+}
+
+/**
+ * Start the radio reception of ACK
+ *
+ * @param timeout Reception timeout in ms
+ */
+static void startRxAck(uint32_t timeout) {
+#ifdef SIMU
+	simu_radio_rxing_ack(timeout);
+#else
+	_sys->SYS_radioRx(timeout);
+#endif
+}
+
+/**
+ * Check whether several ACK or NACK are expected in the Waiting for ACK state
+ *
+ * @retval True After a multicast message, a reliable broadcast message or a
+ * discovery request
+ * @retval False After a unicast message
+ */
+static bool ackWindowActive(void) {
+	return mcast_active() || rbc_active() || hello_active();
+}
+
+/**
+ * Get the type of the frames expected in the current ACK window
+ *
+ * @return #TYPE_ACK after a multicast message, #TYPE_NACK after a reliable
+ * broadcast message, #TYPE_HELLO_REPLY after a discovery request
+ */
+static uint8_t ackWindowType(void) {
+	if(mcast_active()) {
+		return TYPE_ACK;
+	}
+	if(rbc_active()) {
+		return TYPE_NACK;
+	}
+	return TYPE_HELLO_REPLY;
+}
+
+/**
+ * Get the time left in the current ACK window
+ *
+ * @return The time left in ms
+ */
+static uint32_t ackWindowTime(void) {
+	if(mcast_active()) {
+		return mcast_listen_time();
+	}
+	if(rbc_active()) {
+		return rbc_listen_time();
+	}
+	return hello_listen_time();
+}
+
+/**
+ * Process an event of the Waiting for ACK state for a multicast message, a
+ * reliable broadcast message or a discovery request
+ *
+ * The reception goes on until the last ACK, NACK or reply slot is over, or
+ * until every destination of a multicast message has sent its ACK. The outcome
+ * is then handled by #mcast_finish, #rbc_finish or #hello_finish.
+ *
+ * @param evt Event to process
+ * @return Next state for the state machine
+ */
+static STATES process_ack_window(EVENT_T evt) {
+	MSG_T msg;
+	MSG_RXDONE_T* rxDoneMessage = NULL;
+	bool allAcked = false;
+	uint32_t timeLeft;
+
+	if(evt.type == RXMSG) {
+		rxDoneMessage = (MSG_RXDONE_T*) evt.data;
+		if(rxDoneMessage != NULL && rxDoneMessage->data != NULL) {
+			if(parseFrame(&msg, rxDoneMessage) == 0
+					&& msg.hdr.type == ackWindowType()) {
+				neigh_rx(msg.content.ack.srcId, rxDoneMessage->rssi, rxDoneMessage->snr);
+				link_power_feedback(msg.content.ack.srcId, msg.hdr.rfu);
+				if(mcast_active()) {
+					allAcked = mcast_ack(&msg);
+				}
+				else if(rbc_active()) {
+					rbc_nack(&msg);
+				}
+				else {
+					hello_reply_in(&msg, rxDoneMessage->rssi);
+				}
+			}
+			else {
+				LOG(LOG_PARSER, "Messages received was not an ACK for me");
+			}
+		}
+		if(rxDoneMessage != NULL) {
+			rxdone_free(rxDoneMessage);
+			rxDoneMessage = NULL;
+		}
+	}
+
+	/* Keep listening for the following slots */
+	timeLeft = ackWindowTime();
+	if(!allAcked && timeLeft > 0 && evt.type != RXTIMEOUT && evt.type != TIMEOUT) {
+		startRxAck(timeLeft);
+		return _currentState;
+	}
+
+	setTimerForUnblockingTx();
+
+	/* Set RX configuration back to standard */
+	_sys->SYS_radioSetRxFixLen(false, 0);
+	_sys->SYS_radioSetPreamble(_preambleLen);
+	_sys->SYS_radioSetRxContinuous(true);
+
+	if(mcast_active()) {
+		mcast_finish();
+	}
+	else if(rbc_active()) {
+		rbc_finish();
+	}
+	else {
+		hello_finish();
+	}
+	return IDLE;
+}
+
 /**
  * Waiting for ACK state execution function
  *
@@ -1398,9 +2555,11 @@ void process_ack(MSG_T* msg) {
  * @return Next state for the state machine
  */
 static STATES state_rxing_ack(EVENT_T evt) {
-	MSG_T* msg = NULL;
+	MSG_T ackFrame;
+	MSG_T* msg = &ackFrame;
 	MSG_RXDONE_T* rxDoneMessage = NULL;
 	int8_t received;
+	int16_t rssi;
 	switch (evt.type) {
 	case STATE_ENTER:
 		/* Set RX configuration for ACK */
@@ -1411,18 +2570,26 @@ static STATES state_rxing_ack(EVENT_T evt) {
 		LOG(LOG_PARSER, "Entering RXING ACK state (Receiving ACK)");
 
 
+		/* All the ACK or NACK slots are received in one window */
+		uint32_t timeout = timer_safeguard_rxing_ack;
+		if(ackWindowActive()) {
+			timeout = ackWindowTime();
+		}
 #ifdef SIMU
 		uint8_t fail_generator = rand() % 100;
 		/* Simulate errors on reception of ACK */
 		if(fail_generator >= FAILURE_RANDOM_START_RX) {
-			simu_radio_rxing_ack(timer_safeguard_rxing_ack);
+			startRxAck(timeout);
 		}
 #else
 		/* Direclty start radio reception */
-		_sys->SYS_radioRx(timer_safeguard_rxing_ack);
+		startRxAck(timeout);
 #endif
 		return _currentState;
 	case RXMSG:
+		if(ackWindowActive()) {
+			return process_ack_window(evt);
+		}
 		rxDoneMessage = (MSG_RXDONE_T*) evt.data;
 		/* Set RX configuration back to standard */
 		_sys->SYS_radioSetRxFixLen(false, 0);
@@ -1431,19 +2598,28 @@ static STATES state_rxing_ack(EVENT_T evt) {
 
 		if (rxDoneMessage == NULL || rxDoneMessage->data == NULL) {
 			LOG(LOG_ERR, "No data received with RXMSG event");
+			rxdone_free(rxDoneMessage);
 			return IDLE;
 		}
 		/* Build MSG_T from message frame */
-		msg = malloc(sizeof(MSG_T));
-		received = retrieveMessage(msg, rxDoneMessage->data);
+		received = parseFrame(msg, rxDoneMessage);
+		if (received == 0 && msg->hdr.type == TYPE_ACK) {
+			neigh_rx(msg->content.ack.srcId, rxDoneMessage->rssi, rxDoneMessage->snr);
+		}
+		rssi = rxDoneMessage->rssi;
 		/* Free the memory for the rx done message structure */
-		free(rxDoneMessage);
+		rxdone_free(rxDoneMessage);
 		rxDoneMessage = NULL;
 		if (received == 0 && msg->hdr.type == TYPE_ACK) {
+			link_ack_result(msg->content.ack.srcId, true);
+			neigh_ack(msg->content.ack.srcId, true);
+			coreStats.ackOk++;
+			statsHist(coreStats.ackLatency, _sys->SYS_getTimeMs() - txStartTime);
+			link_power_feedback(msg->content.ack.srcId, msg->hdr.rfu);
 			process_ack(msg);
-			/* Free ack message received */
-			free(msg);
-			msg = NULL;
+			ping_ack(rssi);
+			mbox_delivered();
+			mbox_heard(msg->content.ack.srcId);
 		}
 		else {
 			if(msg->hdr.type != TYPE_ACK) {
@@ -1457,18 +2633,22 @@ static STATES state_rxing_ack(EVENT_T evt) {
 			else if(received == -3) {
 				LOG(LOG_PARSER, "CRC check failed");
 			}
+			link_ack_result(lastDestination, false);
+			neigh_ack(lastDestination, false);
+			coreStats.ackNok++;
 			_sys->SYS_cmdResponse((uint8_t*)jsonNokTx, strlen((char*)jsonNokTx));
-			if(msg != NULL) {
-				/* Free ack message received */
-				free(msg);
-				msg = NULL;
-			}
+			/* Keep the message until the destination is heard again */
+			mbox_failed();
+			ping_lost();
 		}
 
 		setTimerForUnblockingTx();
 
 		return IDLE;
 	case RXERROR:
+		if(ackWindowActive()) {
+			return process_ack_window(evt);
+		}
 		setTimerForUnblockingTx();
 
 		/* Set RX configuration back to standard */
@@ -1478,9 +2658,18 @@ static STATES state_rxing_ack(EVENT_T evt) {
 
 		/* Nothing was received by the radio */
 		LOG(LOG_PARSER, "No ACK");
+		link_ack_result(lastDestination, false);
+		neigh_ack(lastDestination, false);
+		coreStats.ackMissing++;
 		_sys->SYS_cmdResponse((uint8_t*)jsonNokTxRxError, strlen((char*)jsonNokTxRxError));
+		/* Keep the message until the destination is heard again */
+		mbox_failed();
+		ping_lost();
 		return IDLE;
 	case RXTIMEOUT:
+		if(ackWindowActive()) {
+			return process_ack_window(evt);
+		}
 		setTimerForUnblockingTx();
 
 		/* Set RX configuration back to standard */
@@ -1490,9 +2679,18 @@ static STATES state_rxing_ack(EVENT_T evt) {
 
 		/* Nothing was received by the radio */
 		LOG(LOG_PARSER, "No ACK");
+		link_ack_result(lastDestination, false);
+		neigh_ack(lastDestination, false);
+		coreStats.ackMissing++;
 		_sys->SYS_cmdResponse((uint8_t*)jsonNokTxRxTimeout, strlen((char*)jsonNokTxRxTimeout));
+		/* Keep the message until the destination is heard again */
+		mbox_failed();
+		ping_lost();
 		return IDLE;
 	case TIMEOUT:
+		if(ackWindowActive()) {
+			return process_ack_window(evt);
+		}
 		setTimerForUnblockingTx();
 
 		/* Set RX configuration back to standard */
@@ -1502,7 +2700,13 @@ static STATES state_rxing_ack(EVENT_T evt) {
 
 		/* Nothing was received by the radio */
 		LOG(LOG_PARSER, "No ACK");
+		link_ack_result(lastDestination, false);
+		neigh_ack(lastDestination, false);
+		coreStats.ackMissing++;
 		_sys->SYS_cmdResponse((uint8_t*)jsonNokTx, strlen((char*)jsonNokTx));
+		/* Keep the message until the destination is heard again */
+		mbox_failed();
+		ping_lost();
 		return IDLE;
 	default:
 		return _currentState;		// Ignore event and stay here
@@ -1527,8 +2731,6 @@ static STATES state_cad(EVENT_T evt) {
 	case STATE_ENTER:
 		LOG_LATER(LOG_PARSER, "Entering CAD state");	/* Used by log parser */
 
-		/* Reset CAD flag */
-		cad_flag = 0;
 		/* Check for the CAD preamble for one symbol */
 		_sys->SYS_radioCAD();
 		return _currentState;
@@ -1549,14 +2751,104 @@ static STATES state_cad(EVENT_T evt) {
 		 */
 		if (res == 1)
 			return RXING;
-		else
-			return IDLE;
+		/* Scan the next SF used by adapted links */
+		if(link_scan_next()) {
+			_sys->SYS_radioCAD();
+			return _currentState;
+		}
+		return IDLE;
 	default:
 //		LOG(LOG_INFO, "Event unknown (%u)", evt.type);
 		return _currentState;
 	}
 }
 
+/**
+ * Transmitting wake-up strobe state execution function
+ *
+ * When entering the state, the radio is set up for short preambles and the
+ * first wake-up frame is sent. After each wake-up frame, we listen for an early
+ * ACK from the destination for a short window.
+ *
+ * When the early ACK is received, or when the strobe has lasted as long as the
+ * preamble it replaces, the data frame is sent with a short preamble.
+ *
+ * @param evt Event to process by this state
+ * @return Next state for the state machine
+ */
+static STATES state_txing_wakeup(EVENT_T evt) {
+	MSG_T ackFrame;
+	MSG_T* msg = &ackFrame;
+	MSG_RXDONE_T* rxDoneMessage = NULL;
+	int8_t received;
+	switch (evt.type) {
+	case STATE_ENTER:
+		LOG(LOG_PARSER, "Entering TXING WAKEUP state (Wake-up strobe to %u)", lastDestination);
+		/* The strobe lasts as long as the preamble it replaces */
+		wakeupTrainEnd = _sys->SYS_getTimeMs() + preamble_symbols_to_timems(_preambleLen);
+		/* Short preamble for both wake-up frames and early ACK */
+		_sys->SYS_radioSetPreamble(PREAMBLE_WAKEUP);
+		_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_ack);
+		timer_wakeup_ack_window = ceil(_sys->SYS_radioTimeOnAir(WAKEUP_FRAME_LENGTH))
+				+ TIMER_WAKEUP_ACK_MARGIN;
+		txWakeupFrame();
+		return _currentState;
+	case TXDONE:
+		coreStats.txFrames++;
+		/* Listen for an early ACK */
+		_sys->SYS_radioRx(timer_wakeup_ack_window);
+		return _currentState;
+	case RXMSG:
+		rxDoneMessage = (MSG_RXDONE_T*) evt.data;
+		if (rxDoneMessage == NULL || rxDoneMessage->data == NULL) {
+			LOG(LOG_ERR, "No data received with RXMSG event");
+			rxdone_free(rxDoneMessage);
+			return nextWakeupFrame();
+		}
+		received = parseFrame(msg, rxDoneMessage);
+		rxdone_free(rxDoneMessage);
+		rxDoneMessage = NULL;
+		if(received == 0 && msg->hdr.type == TYPE_WAKEUP
+				&& msg->content.wake.srcId == lastDestination) {
+			LOG(LOG_PARSER, "Early ACK received from %u", msg->content.wake.srcId);
+			/* Destination is awake, send data now with a short preamble */
+			wakeupTrainDone = true;
+			_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_std);
+			return tryTxFrame();
+		}
+		return nextWakeupFrame();
+	case RXERROR:
+	case RXTIMEOUT:
+		return nextWakeupFrame();
+	case TXTIMEOUT:
+		LOG(LOG_ERR, "Transmission of wake-up frame timed out");
+		coreStats.txTimeout++;
+		/* Back to standard radio TX configuration */
+		_sys->SYS_radioSetPreamble(_preambleLen);
+		_sys->SYS_radioSetTxTimeout(timer_safeguard_txing_std);
+		setTimerForUnblockingTx();
+		retryTxFrame++;
+		if(retryTxFrame < MAX_TX_FRAME_RETRY) {
+			txRetryResponse();
+		}
+		/* Give up on the frame after too many failures */
+		else {
+			_sys->SYS_cmdResponse((uint8_t*)jsonErrorTxFail, strlen((char*)jsonErrorTxFail));
+			txFrameFilled = false;
+			if(currentTxMsg != NULL) {
+				/* Park the message or free its buffer */
+				if(!mbox_park(currentTxMsg)) {
+					msg_free(currentTxMsg);
+				}
+				currentTxMsg = NULL;
+			}
+		}
+		return IDLE;
+	default:
+		return _currentState;		// Ignore event and stay here
+	}
+}
+
 /**
  * Restart state execution function
  *
@@ -1578,49 +2870,44 @@ static STATES state_restart(EVENT_T evt) {
  */
 void clean_queues(void) {
 	MSG_T* msg = NULL;
-	MSG_RX_APP_T* msg_rx_app = NULL;
 	void *buf = NULL;
 	EVENTS evt;
 	uint16_t length;
+	uint8_t prio;
 	/* Clear rx packets */
-	while(queue_size(&_rx_pkt_list) > 0) {
-		get_from_queue(&_rx_pkt_list, &buf, &length);
-		msg_rx_app = (MSG_RX_APP_T*) buf;
-		msg = msg_rx_app->msg;
-		free(msg);
-		msg = NULL;
-		free(msg_rx_app);
-		msg = NULL;
-	}
+	rxq_clear();
 	/* Clear tx packets */
-	while(queue_size(&_tx_pkt_list) > 0) {
-		get_from_queue(&_tx_pkt_list, &buf, &length);
-		msg = (MSG_T*) buf;
-		free(msg);
-		msg = NULL;
+	for(prio = 0; prio < TXQ_PRIO_LEVELS; ++prio) {
+		while(queue_size(&_tx_pkt_list[prio]) > 0) {
+			get_from_queue(&_tx_pkt_list[prio], &buf, &length);
+			msg = (MSG_T*) buf;
+			msg_free(msg);
+			msg = NULL;
+		}
 	}
+	/* Clear parked messages */
+	mbox_clear();
+	/* Forget the pings in progress */
+	ping_stop();
 	/* Clear atcmd packets */
 	while(queue_size(&_atcmd_list) > 0) {
 		get_from_queue(&_atcmd_list, &buf, &length);
-		free(buf);
+		atbuf_free(buf);
 		buf = NULL;
 	}
-	/* Clean event queue */
-	while(event_size(&_eventQ) > 0) {
-		get_event(&_eventQ, &evt, &buf, &length);
-		if(buf != NULL) {
-			free(buf);
+	/* Clean event queue, only reception events carry a buffer */
+	while(get_event(&_eventQ, &evt, &buf, &length) >= 0) {
+		if(evt == RXMSG) {
+			rxdone_free(buf);
 			buf = NULL;
 		}
 	}
-	/* Clean cold event queue */
-	while(event_size(&_coldEventQ) > 0) {
-		get_event(&_coldEventQ, &evt, &buf, &length);
-		if(buf != NULL) {
-			free(buf);
-			buf = NULL;
-		}
+	/* Clean cold event queue, its events carry no data */
+	while(get_event(&_coldEventQ, &evt, &buf, &length) >= 0) {
 	}
+	/* Drop the coalesced events, they carry no data either */
+	_eventQ.pending = 0;
+	_coldEventQ.pending = 0;
 }
 
 /** @} */
@@ -0,0 +1,221 @@
+/**
+ * @file lowapp_smprof.c
+ * @brief LoWAPP state machine profiling
+ *
+ * When #LOWAPP_SM_PROFILE is defined, every transition of the state machine is
+ * timestamped, between the STATE_EXIT of the previous state and the
+ * STATE_ENTER of the next one. The time spent in each state, the number of
+ * entries in each state and the number of transitions between each pair of
+ * states are accumulated from the last reset.
+ *
+ * AT+SMPROF reports them as
+ * OK {"since":"ms","states":"name:ms:entries,...","trans":"from>to:count,..."},
+ * the transitions being given with the numeric values of #STATES and only when
+ * they happened. In the simulator, the same figures are printed when the node
+ * exits.
+ *
+ * Without #LOWAPP_SM_PROFILE, the profiling code and the AT command are not
+ * compiled at all.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+#ifdef LOWAPP_SM_PROFILE
+
+#ifdef SIMU
+#include <stdio.h>
+#endif
+
+extern STATES _currentState;
+extern const uint8_t jsonSuffix[];
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_smprof LoWAPP Core State Machine Profiling
+ * @brief Time spent in each state and transitions of the state machine
+ * @{
+ */
+
+/** Names of the states, in the order of #STATES */
+static const char* smprofNames[SMPROF_STATES] = {
+	"IDLE", "RXING", "SKIPPING_ACK", "WAIT_SLOT_TX_ACK", "TXING_ACK", "TXING",
+	"WAIT_BEFORE_LISTENING_FOR_ACK", "RXING_ACK", "CAD", "TXING_WAKEUP", "RESTART"
+};
+
+/** Time (in ms) spent in each state, without the current stay */
+static uint32_t smprofTime[SMPROF_STATES];
+
+/** Number of entries in each state */
+static uint16_t smprofEntries[SMPROF_STATES];
+
+/** Number of transitions from a state (first index) to another one */
+static uint16_t smprofTrans[SMPROF_STATES][SMPROF_STATES];
+
+/** Local time (in ms) of the last transition */
+static uint64_t smprofLast = 0;
+
+/** Local time (in ms) of the last reset */
+static uint64_t smprofSince = 0;
+
+/**
+ * Append a 32 bits unsigned integer in decimal to a buffer
+ *
+ * @param buffer Buffer to fill
+ * @param value Value to write
+ * @return The number of characters written
+ */
+static uint16_t smprof_fill32(uint8_t* buffer, uint32_t value) {
+	uint8_t digits[10];
+	uint8_t n = 0;
+	uint16_t i;
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while(value != 0);
+	for(i = 0; i < n; ++i) {
+		buffer[i] = digits[n-1-i];
+	}
+	return n;
+}
+
+/**
+ * Get the time spent in a state, including the current stay
+ *
+ * @param state State
+ * @param now Current local time (ms)
+ * @return The time spent in the state (ms)
+ */
+static uint32_t smprof_time(uint8_t state, uint64_t now) {
+	if(state == _currentState) {
+		return smprofTime[state] + (uint32_t)(now - smprofLast);
+	}
+	return smprofTime[state];
+}
+
+/**
+ * Record a transition of the state machine
+ *
+ * @param from State left
+ * @param to State entered
+ */
+void smprof_transition(STATES from, STATES to) {
+	uint64_t now = _sys->SYS_getTimeMs();
+	smprofTime[from] += (uint32_t)(now - smprofLast);
+	smprofLast = now;
+	if(smprofEntries[to] < UINT16_MAX) {
+		smprofEntries[to]++;
+	}
+	if(smprofTrans[from][to] < UINT16_MAX) {
+		smprofTrans[from][to]++;
+	}
+}
+
+/**
+ * Clear the profile, the stay in the current state starting now
+ */
+void smprof_reset(void) {
+	memset(smprofTime, 0, sizeof(smprofTime));
+	memset(smprofEntries, 0, sizeof(smprofEntries));
+	memset(smprofTrans, 0, sizeof(smprofTrans));
+	smprofLast = _sys->SYS_getTimeMs();
+	smprofSince = smprofLast;
+}
+
+/**
+ * Send the profile to the application
+ */
+void smprof_report(void) {
+	const uint8_t jsonSince[] = "OK {\"since\":\"";
+	const uint8_t jsonStates[] = "\",\"states\":\"";
+	const uint8_t jsonTrans[] = "\",\"trans\":\"";
+	uint64_t now = _sys->SYS_getTimeMs();
+	uint8_t* buffer;
+	uint16_t offset = 0;
+	uint16_t nTrans = 0;
+	uint8_t i, j;
+	for(i = 0; i < SMPROF_STATES; ++i) {
+		for(j = 0; j < SMPROF_STATES; ++j) {
+			if(smprofTrans[i][j] != 0) {
+				nTrans++;
+			}
+		}
+	}
+	/* Longest state entry "WAIT_BEFORE_LISTENING_FOR_ACK:ms:n," and "from>to:n," */
+	buffer = calloc(64 + SMPROF_STATES*48 + nTrans*12, sizeof(uint8_t));
+
+	memcpy(buffer+offset, jsonSince, strlen((char*)jsonSince));
+	offset += strlen((char*)jsonSince);
+	offset += smprof_fill32(buffer+offset, (uint32_t)(now - smprofSince));
+	memcpy(buffer+offset, jsonStates, strlen((char*)jsonStates));
+	offset += strlen((char*)jsonStates);
+	for(i = 0; i < SMPROF_STATES; ++i) {
+		if(i > 0) {
+			buffer[offset++] = ',';
+		}
+		memcpy(buffer+offset, smprofNames[i], strlen(smprofNames[i]));
+		offset += strlen(smprofNames[i]);
+		buffer[offset++] = ':';
+		offset += smprof_fill32(buffer+offset, smprof_time(i, now));
+		buffer[offset++] = ':';
+		offset += smprof_fill32(buffer+offset, smprofEntries[i]);
+	}
+	memcpy(buffer+offset, jsonTrans, strlen((char*)jsonTrans));
+	offset += strlen((char*)jsonTrans);
+	nTrans = 0;
+	for(i = 0; i < SMPROF_STATES; ++i) {
+		for(j = 0; j < SMPROF_STATES; ++j) {
+			if(smprofTrans[i][j] == 0) {
+				continue;
+			}
+			if(nTrans++ > 0) {
+				buffer[offset++] = ',';
+			}
+			offset += smprof_fill32(buffer+offset, i);
+			buffer[offset++] = '>';
+			offset += smprof_fill32(buffer+offset, j);
+			buffer[offset++] = ':';
+			offset += smprof_fill32(buffer+offset, smprofTrans[i][j]);
+		}
+	}
+	memcpy(buffer+offset, jsonSuffix, strlen((char*)jsonSuffix));
+	offset += strlen((char*)jsonSuffix);
+	_sys->SYS_cmdResponse(buffer, offset);
+	free(buffer);
+	buffer = NULL;
+}
+
+#ifdef SIMU
+/**
+ * Print the profile on the standard output of the simulated node
+ */
+void smprof_dump(void) {
+	uint64_t now = _sys->SYS_getTimeMs();
+	uint32_t total = (uint32_t)(now - smprofSince);
+	uint8_t i, j;
+	printf("State machine profile over %u ms\n", total);
+	printf("%-30s %10s %6s %8s\n", "state", "ms", "%", "entries");
+	for(i = 0; i < SMPROF_STATES; ++i) {
+		printf("%-30s %10u %6.2f %8u\n", smprofNames[i], smprof_time(i, now),
+				(total == 0) ? 0.0 : 100.0 * smprof_time(i, now) / total, smprofEntries[i]);
+	}
+	printf("Transitions\n");
+	for(i = 0; i < SMPROF_STATES; ++i) {
+		for(j = 0; j < SMPROF_STATES; ++j) {
+			if(smprofTrans[i][j] != 0) {
+				printf("%s -> %s: %u\n", smprofNames[i], smprofNames[j], smprofTrans[i][j]);
+			}
+		}
+	}
+}
+#endif
+
+/** @} */
+/** @} */
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * @file lowapp_smprof.h
+ * @brief LoWAPP state machine profiling
+ *
+ * Defines the functions used to measure the time spent in each state of the
+ * state machine and to count its transitions, when #LOWAPP_SM_PROFILE is
+ * defined.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_SMPROF_H_
+#define LOWAPP_CORE_SMPROF_H_
+
+#ifdef LOWAPP_SM_PROFILE
+
+/** Number of states of the state machine */
+#define SMPROF_STATES	(RESTART+1)
+
+void smprof_transition(STATES from, STATES to);
+void smprof_reset(void);
+void smprof_report(void);
+#ifdef SIMU
+void smprof_dump(void);
+#endif
+
+/**
+ * Profiling macro
+ *
+ * Records a transition of the state machine.
+ * @param from State left
+ * @param to State entered
+ */
+#define SM_PROFILE(from, to)	smprof_transition(from, to)
+
+#else
+
+#define SM_PROFILE(from, to)
+
+#endif
+
+#endif
@@ -0,0 +1,277 @@
+/**
+ * @file lowapp_sync.c
+ * @brief LoWAPP synchronised mode
+ *
+ * In synchronised mode, every standard message carries a stamp of the group
+ * clock in its header rfu field. Nodes converge on the group clock from the
+ * stamps they overhear and only listen during a rendezvous slot at the start of
+ * each #SYNC_PERIOD. Inside the slot, messages are sent with a short preamble
+ * and the channel is sampled accordingly. Outside the slot, nodes do not sample
+ * the channel at all.
+ *
+ * A node starts by acquiring the group clock: it samples the channel
+ * continuously and does not transmit. If no stamp is heard within
+ * #SYNC_ACQUIRE_TIME, it locks on its own clock. A locked node which has not
+ * heard any stamp for #SYNC_RESYNC_TIME goes back to acquisition.
+ *
+ * A node running on its own clock cannot tell whether the rest of the group
+ * shares its phase. Until it hears a stamp, it keeps the standard preamble for
+ * its messages and samples the channel at the standard CAD interval outside its
+ * slot, so that two nodes which locked on their own clock at different phases
+ * still hear each other and converge on the first stamp heard.
+ *
+ * All nodes of the group must use the synchronised mode and the same radio
+ * configuration.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#include "lowapp_inc.h"
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_sync LoWAPP Core Synchronised Mode
+ * @brief Group clock and rendezvous slots
+ * @{
+ */
+
+/** Current state of the group clock */
+static SYNC_STATE_T syncState = SYNC_ACQUIRING;
+
+/** Offset (in ms) between the group clock and the local clock */
+static int64_t syncOffset = 0;
+
+/** Local time (in ms) at which the current state was entered */
+static uint64_t syncStateSince = 0;
+
+/** Local time (in ms) at which the last stamp was heard */
+static uint64_t syncLastStamp = 0;
+
+/** True while locked on our own clock, no stamp having been heard since */
+static bool syncOwnClock = false;
+
+/** Preamble length (in symbols) used inside a slot */
+static uint16_t syncPreambleLen = SYNC_PREAMBLE_LEN;
+
+/** Interval between two CAD inside a slot (in ms) */
+static uint32_t syncCadInterval = 0;
+
+/** Time on air saved (in ms) by using the sync preamble instead of the standard one */
+static uint32_t syncPreambleSaving = 0;
+
+/**
+ * Get the current phase of the group clock in the rendezvous period
+ *
+ * @param now Local time in ms
+ * @return The phase in ms, between 0 and #SYNC_PERIOD
+ */
+static uint16_t sync_phase(uint64_t now) {
+	int64_t groupTime = (int64_t)now + syncOffset;
+	return ((groupTime % SYNC_PERIOD) + SYNC_PERIOD) % SYNC_PERIOD;
+}
+
+/**
+ * Update the state of the group clock from the elapsed time
+ *
+ * @param now Local time in ms
+ */
+static void sync_check(uint64_t now) {
+	if(syncState == SYNC_ACQUIRING) {
+		if(now - syncStateSince >= SYNC_ACQUIRE_TIME) {
+			LOG(LOG_INFO, "No stamp heard, locking on our own clock");
+			syncState = SYNC_LOCKED;
+			syncOwnClock = true;
+			syncStateSince = now;
+			syncLastStamp = now;
+		}
+	}
+	else if(now - syncLastStamp >= SYNC_RESYNC_TIME) {
+		LOG(LOG_INFO, "No stamp heard for too long, acquiring group clock");
+		syncState = SYNC_ACQUIRING;
+		syncStateSince = now;
+	}
+}
+
+/**
+ * Reset the group clock and start acquiring it
+ */
+void sync_init(void) {
+	syncState = SYNC_ACQUIRING;
+	syncOwnClock = false;
+	syncOffset = 0;
+	syncStateSince = _sys->SYS_getTimeMs();
+	syncLastStamp = syncStateSince;
+}
+
+/**
+ * Update the sync preamble and CAD interval according to the current radio
+ * configuration
+ *
+ * Must be called after #_preambleLen is updated.
+ */
+void sync_update_radio(void) {
+	syncPreambleLen = SYNC_PREAMBLE_LEN;
+	if(syncPreambleLen > _preambleLen) {
+		syncPreambleLen = _preambleLen;
+	}
+	/* Same margin between preamble and CAD interval as the standard preamble */
+	syncCadInterval = preamble_symbols_to_timems(syncPreambleLen-10);
+	syncPreambleSaving = preamble_symbols_to_timems(_preambleLen) - preamble_symbols_to_timems(syncPreambleLen);
+}
+
+/**
+ * Get the current state of the group clock
+ * @return The state of the group clock
+ */
+SYNC_STATE_T sync_state(void) {
+	sync_check(_sys->SYS_getTimeMs());
+	return syncState;
+}
+
+/**
+ * Build the stamp to put in the header of a message about to be sent
+ *
+ * @param shortPreamble True if the message is sent with the sync preamble
+ * @return The value of the header rfu field
+ */
+uint16_t sync_stamp(bool shortPreamble) {
+	uint16_t stamp = sync_phase(_sys->SYS_getTimeMs()) | SYNC_STAMP_FLAG;
+	if(shortPreamble) {
+		stamp |= SYNC_STAMP_SHORT;
+	}
+	return stamp;
+}
+
+/**
+ * Adjust the group clock from the stamp of a received message
+ *
+ * The stamp was taken by the sender when starting the transmission, so the time
+ * on air of the frame is taken into account. The first stamp heard while
+ * acquiring is adopted as is. Once locked, small differences are halved to
+ * smooth out the reception jitter.
+ *
+ * @param stamp Header rfu field of the received message
+ * @param frameLength Length of the received frame in bytes
+ */
+void sync_process_stamp(uint16_t stamp, uint16_t frameLength) {
+	if(!_syncMode || (stamp & SYNC_STAMP_FLAG) == 0) {
+		return;
+	}
+	uint64_t now = _sys->SYS_getTimeMs();
+	uint32_t toa = _sys->SYS_radioTimeOnAir(frameLength);
+	if((stamp & SYNC_STAMP_SHORT) && toa > syncPreambleSaving) {
+		toa -= syncPreambleSaving;
+	}
+	/* Difference between the sender's clock and ours, wrapped around the period */
+	int32_t diff = (int32_t)(stamp & SYNC_STAMP_PHASE_MASK) - sync_phase(now - toa);
+	if(diff > SYNC_PERIOD/2) {
+		diff -= SYNC_PERIOD;
+	}
+	else if(diff < -SYNC_PERIOD/2) {
+		diff += SYNC_PERIOD;
+	}
+
+	sync_check(now);
+	if(syncState == SYNC_ACQUIRING) {
+		LOG(LOG_INFO, "Group clock acquired (offset %d ms)", diff);
+		syncOffset += diff;
+		syncState = SYNC_LOCKED;
+		syncStateSince = now;
+	}
+	else if(diff > SYNC_GUARD_TIME || diff < -SYNC_GUARD_TIME) {
+		/* Far away clock, probably another cluster of the group: join it */
+		LOG(LOG_INFO, "Group clock jumped by %d ms", diff);
+		syncOffset += diff;
+	}
+	else {
+		syncOffset += diff/2;
+	}
+	syncOwnClock = false;
+	syncLastStamp = now;
+}
+
+/**
+ * Check whether a transmission can be started now
+ *
+ * @retval True If the synchronised mode is disabled or if we are inside the
+ * transmission window of a slot
+ * @retval False Otherwise
+ */
+bool sync_tx_allowed(void) {
+	if(!_syncMode) {
+		return true;
+	}
+	uint64_t now = _sys->SYS_getTimeMs();
+	sync_check(now);
+	if(syncState != SYNC_LOCKED) {
+		return false;
+	}
+	uint16_t phase = sync_phase(now);
+	return phase >= SYNC_GUARD_TIME && phase <= SYNC_SLOT_LENGTH - SYNC_GUARD_TIME;
+}
+
+/**
+ * Check whether the channel should be sampled now
+ *
+ * @retval True If the synchronised mode is disabled, if we are acquiring the
+ * group clock or running on our own clock, or if we are inside a slot
+ * @retval False Otherwise
+ */
+bool sync_listen_allowed(void) {
+	if(!_syncMode) {
+		return true;
+	}
+	uint64_t now = _sys->SYS_getTimeMs();
+	sync_check(now);
+	if(syncState != SYNC_LOCKED || syncOwnClock) {
+		return true;
+	}
+	return sync_phase(now) < SYNC_SLOT_LENGTH;
+}
+
+/**
+ * Get the preamble length to use for the next standard transmission
+ *
+ * @return The sync preamble length if the group clock is locked on a stamp
+ * heard, 0 if the standard preamble must be used
+ */
+uint16_t sync_preamble(void) {
+	if(!_syncMode || sync_state() != SYNC_LOCKED || syncOwnClock) {
+		return 0;
+	}
+	return syncPreambleLen;
+}
+
+/**
+ * Get the delay before the next CAD
+ *
+ * @return #_cad_interval if the synchronised mode is disabled, the sync CAD
+ * interval if we are acquiring or inside a slot, or else the time left before
+ * the next slot, at most #_cad_interval when running on our own clock
+ */
+uint32_t sync_next_cad_delay(void) {
+	if(!_syncMode) {
+		return _cad_interval;
+	}
+	uint64_t now = _sys->SYS_getTimeMs();
+	sync_check(now);
+	if(syncState != SYNC_LOCKED) {
+		return syncCadInterval;
+	}
+	uint16_t phase = sync_phase(now);
+	if(phase < SYNC_SLOT_LENGTH) {
+		return syncCadInterval;
+	}
+	/* Long preambles from the other phases are caught with the standard interval */
+	if(syncOwnClock && _cad_interval < (uint32_t)(SYNC_PERIOD - phase)) {
+		return _cad_interval;
+	}
+	return SYNC_PERIOD - phase;
+}
+
+/** @} */
+/** @} */
@@ -0,0 +1,33 @@
+/**
+ * @file lowapp_sync.h
+ * @brief LoWAPP synchronised mode
+ *
+ * Defines the group clock and rendezvous slots used when the synchronised mode
+ * is enabled.
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_CORE_SYNC_H_
+#define LOWAPP_CORE_SYNC_H_
+
+/**
+ * State of the group clock
+ */
+typedef enum {
+	SYNC_ACQUIRING = 0,		/**< Listening continuously for a stamp from the group */
+	SYNC_LOCKED				/**< Following the group clock, listening in slots only */
+} SYNC_STATE_T;
+
+void sync_init(void);
+void sync_update_radio(void);
+SYNC_STATE_T sync_state(void);
+uint16_t sync_stamp(bool shortPreamble);
+void sync_process_stamp(uint16_t stamp, uint16_t frameLength);
+bool sync_tx_allowed(void);
+bool sync_listen_allowed(void);
+uint16_t sync_preamble(void);
+uint32_t sync_next_cad_delay(void);
+
+#endif
@@ -45,6 +45,12 @@ struct LOWAPP_SYS_IF {
 	 * @param callback Callback to be called after timems
 	 */
 	LOWAPP_INITTIMER_T SYS_initTimer2;
+	/**
+	 * Initialise timer 3
+	 *
+	 * @param callback Callback to be called after timems
+	 */
+	LOWAPP_INITTIMER_T SYS_initTimer3;
 	/**
 	 * Initialise retitive timer
 	 *
@@ -69,6 +75,15 @@ struct LOWAPP_SYS_IF {
 	 * @retval -1 If an error occurred
 	 */
 	LOWAPP_SETTIMER_T SYS_setTimer2;
+	/**
+	 * Request to set a callback to be called in timems milleseconds from now
+	 * using a third timer
+	 *
+	 * @param timems Time in ms
+	 * @retval 0 On success
+	 * @retval -1 If an error occurred
+	 */
+	LOWAPP_SETTIMER_T SYS_setTimer3;
 	/**
 	 * Request to set a callback to be called every timems milleseconds
 	 *
@@ -90,6 +105,12 @@ struct LOWAPP_SYS_IF {
 	 * @retval -1 If an error occurred
 	 */
 	LOWAPP_CANCELTIMER_T SYS_cancelTimer2;
+	/**
+	 * Disarm the third timer
+	 * @retval 0 On success
+	 * @retval -1 If an error occurred
+	 */
+	LOWAPP_CANCELTIMER_T SYS_cancelTimer3;
 	/**
 	 * Disarm the repetitive timer to avoid unexpected cad timeout later on
 	 * @retval 0 On success
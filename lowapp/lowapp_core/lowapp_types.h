@@ -52,8 +52,8 @@
  * @{*/
 /** ID field for broadcast messages */
 #define LOWAPP_ID_BROADCAST 0xFF
-/** RFU device id */
-#define LOWAPP_ID_ADDR_RES_1 	0xFE
+/** ID field for multicast messages, the destination list is in the payload */
+#define LOWAPP_ID_MULTICAST 	0xFE
 /** RFU device id */
 #define LOWAPP_ID_ADDR_RES_2 	0xFD
 /** RFU device id */
@@ -157,10 +157,269 @@
 #define TIMER_CHANNEL_FREE_INTERVAL	10
 /** Preamble time for ACK */
 #define PREAMBLE_ACK		8 //2
+/** Preamble length (in symbols) for wake-up strobe frames and the data frame following them */
+#define PREAMBLE_WAKEUP		16
+/**
+ * Turnaround margin (in ms) of the early ACK window
+ *
+ * The sender listens for an early ACK after each wake-up frame during the time
+ * on air of one wake-up frame plus this margin.
+ */
+#define TIMER_WAKEUP_ACK_MARGIN	20
 /** Timer for retry when TX fail */
 #define TIMER_TX_FAIL_RETRY		1000
 /**@}*/
 
+/**
+ * @name Synchronised mode (group clock and rendezvous slots)
+ * @{
+ */
+/** Period of the rendezvous slots on the group clock (in ms) */
+#define SYNC_PERIOD				10000
+/** Length of a rendezvous slot, at the start of each period (in ms) */
+#define SYNC_SLOT_LENGTH		2000
+/** Margin kept at both ends of the slot where transmissions are not started (in ms) */
+#define SYNC_GUARD_TIME			200
+/** Preamble length (in symbols) used inside a slot once the clock is locked */
+#define SYNC_PREAMBLE_LEN		24
+/** Time listening for a stamp before locking on our own clock (in ms) */
+#define SYNC_ACQUIRE_TIME		(2*SYNC_PERIOD)
+/** Time without hearing any stamp before acquiring the group clock again (in ms) */
+#define SYNC_RESYNC_TIME		(30*SYNC_PERIOD)
+/** Flag of the header rfu field indicating that it holds a clock stamp */
+#define SYNC_STAMP_FLAG			0x8000
+/** Flag of the header rfu field indicating that the frame used the sync preamble */
+#define SYNC_STAMP_SHORT		0x4000
+/** Mask of the group clock phase (in ms) in the header rfu field */
+#define SYNC_STAMP_PHASE_MASK	0x3FFF
+/**@}*/
+
+/**
+ * @name Per-link adaptation of the spreading factor, coding rate and transmit power
+ * @{
+ */
+/** Number of SF above the group SF that can be used on a link (and scanned during CAD) */
+#define LINK_SF_STEPS			3
+/** Margin (in dB) kept above the demodulation floor of the chosen SF */
+#define LINK_SNR_MARGIN			5
+/** Maximum number of consecutive missing ACK taken into account */
+#define LINK_MAX_FAILS			4
+/** Most robust coding rate (4/8) */
+#define LINK_MAX_CODERATE		4
+/** Flag of the ACK header rfu field indicating that it holds a link margin report */
+#define LINK_MARGIN_FLAG		0x8000
+/** Link margin (in dB) aimed at by transmit power control */
+#define LINK_POWER_TARGET_MARGIN	10
+/** Margin (in dB) above the target before the transmit power is lowered */
+#define LINK_POWER_HYSTERESIS	3
+/** Step (in dB) used to lower the transmit power */
+#define LINK_POWER_STEP			2
+/** Lowest transmit power (in dBm) used by transmit power control */
+#define LINK_MIN_POWER			2
+/**@}*/
+
+/**
+ * @name Queue capacities
+ *
+ * Each capacity can be set at build time (deeper RX and TX queues for a
+ * gateway for example). The capacities in number of elements are powers of 2,
+ * at most 64.
+ * @{
+ */
+#ifndef TXQ_SIZE
+/** Capacity of each priority level of the TX queue */
+#define TXQ_SIZE				16
+#endif
+#ifndef RXQ_BYTES
+/** Capacity in bytes of the queue of messages received for the application, less than 64 kB */
+#define RXQ_BYTES				2048
+#endif
+#ifndef RXQ_POLL_MAX
+/** Maximum number of messages answered to one AT+POLLRX, the others are kept for the next one */
+#define RXQ_POLL_MAX			16
+#endif
+#ifndef ATCMDQ_SIZE
+/** Capacity of the AT command queue */
+#define ATCMDQ_SIZE				4
+#endif
+#ifndef EVENTQ_SIZE
+/** Capacity of the standard event queue */
+#define EVENTQ_SIZE				16
+#endif
+#ifndef COLDQ_SIZE
+/** Capacity of the cold event queue */
+#define COLDQ_SIZE				16
+#endif
+/**@}*/
+
+/**
+ * @name Object pools
+ *
+ * Each size can be set at build time.
+ * @{
+ */
+#ifndef MSG_POOL_SIZE
+/** Number of messages, in the queues or being processed */
+#define MSG_POOL_SIZE			16
+#endif
+#ifndef RXDONE_POOL_SIZE
+/** Number of radio reception descriptors, waiting in the event queue */
+#define RXDONE_POOL_SIZE		EVENTQ_SIZE
+#endif
+#ifndef ATCMD_POOL_SIZE
+/** Number of AT command buffers, one for each command of the AT command queue */
+#define ATCMD_POOL_SIZE			ATCMDQ_SIZE
+#endif
+/** Size in bytes of an AT command buffer, the end of string included */
+#define ATCMD_MAX_LEN			256
+/**@}*/
+
+/**
+ * @name Transmission scheduling across destinations
+ * @{
+ */
+/** Maximum number of messages queued for a single destination */
+#define TXQ_MAX_PER_DEST		(TXQ_SIZE/2)
+/** Number of consecutive missing ACK after which a destination is parked */
+#define TXQ_PARK_FAILS			3
+/** Time (in ms) during which the messages to a parked destination are held back */
+#define TXQ_PARK_TIME			60000
+/** Priority of routine messages, sent after all the others */
+#define TXQ_PRIO_LOW			0
+/** Default priority of the messages */
+#define TXQ_PRIO_NORMAL			1
+/** Priority of urgent messages, sent before all the others */
+#define TXQ_PRIO_HIGH			2
+/** Number of priority levels of the TX queue */
+#define TXQ_PRIO_LEVELS			3
+/** Coalescing key of the GPS position updates (GPSAPP message type 0x02) */
+#define TXQ_KEY_POSITION		1
+/** Coalescing key of the AT+PING requests, also used to recognise them */
+#define TXQ_KEY_PING			2
+/** Highest coalescing key reserved for the stack, AT+SEND keys start above it */
+#define TXQ_KEY_RESERVED		2
+/**@}*/
+
+/**
+ * @name Multicast messages
+ * @{
+ */
+/** Maximum number of destinations of a multicast message */
+#define MCAST_MAX_DEST			8
+/** Margin (in ms) kept on both sides of an ACK inside its multicast slot */
+#define MCAST_ACK_GUARD			50
+/** Maximum number of times a multicast message is sent again to its missing destinations */
+#define MCAST_MAX_RETRY			2
+/**@}*/
+
+/**
+ * @name Reliable broadcast
+ * @{
+ */
+/** Number of broadcast messages kept by the source for repairs */
+#define RBC_HISTORY				4
+/** Number of randomised NACK slots after a reliable broadcast message */
+#define RBC_NACK_SLOTS			4
+/** Number of previous broadcast messages a NACK can report as missing */
+#define RBC_NACK_WINDOW			8
+/**@}*/
+
+/**
+ * @name Relaying
+ * @{
+ */
+/** Number of entries of the route cache */
+#define ROUTE_MAX				16
+/** Time (in ms) after which a learned route is forgotten */
+#define ROUTE_TIMEOUT			600000
+/** Maximum number of hops of a relayed message */
+#define RELAY_MAX_HOPS			3
+/** Size of the relay header at the head of the payload of a relayed message */
+#define RELAY_HDR_SIZE			4
+/** Number of relayed messages remembered for duplicate suppression */
+#define RELAY_DUP_CACHE			16
+/**@}*/
+
+/**
+ * @name Flooding
+ * @{
+ */
+/** Number of entries of the flooded messages cache (power of 2) */
+#define FLOOD_CACHE				32
+/** Number of copies of a flooded message which cancel its rebroadcast */
+#define FLOOD_SUPPRESS_COUNT	3
+/** Maximum number of hops of a flooded message */
+#define FLOOD_MAX_HOPS			4
+/** Minimum delay (in ms) before rebroadcasting a flooded message */
+#define FLOOD_DELAY_MIN			500
+/** Maximum delay (in ms) before rebroadcasting a flooded message */
+#define FLOOD_DELAY_MAX			3000
+/** Number of rebroadcasts waiting for their delay */
+#define FLOOD_PENDING			4
+/**@}*/
+
+/**
+ * @name Mailbox
+ * @{
+ */
+/** Number of undelivered messages kept in the mailbox */
+#define MBOX_SIZE				8
+/** Number of undelivered messages kept in the mailbox for a single destination */
+#define MBOX_PER_DEST			4
+/** Number of times an undelivered message is parked before being dropped */
+#define MBOX_MAX_ATTEMPTS		3
+/**@}*/
+
+/**
+ * @name Neighbour discovery
+ * @{
+ */
+/** Minimum number of reply slots after a discovery request */
+#define HELLO_SLOTS_MIN			4
+/** Maximum number of reply slots after a discovery request */
+#define HELLO_SLOTS_MAX			16
+/** Number of neighbours reported after a discovery request */
+#define HELLO_MAX_NODES			12
+/**@}*/
+
+/**
+ * @name Ping
+ * @{
+ */
+/** Maximum number of pings of a single AT+PING command */
+#define PING_MAX_COUNT			100
+/** Default interval (in ms) between two pings */
+#define PING_INTERVAL			1000
+/** Maximum interval (in ms) between two pings */
+#define PING_MAX_INTERVAL		60000
+/** Time (in ms) after which a ping without ACK nor error is considered lost */
+#define PING_TIMEOUT			30000
+/**@}*/
+
+/**
+ * @name Neighbour table
+ * @{
+ */
+#ifndef NEIGH_TABLE_SIZE
+/** Number of entries of the neighbour table (power of 2, at most 256) */
+#define NEIGH_TABLE_SIZE		64
+#endif
+/** Number of entries probed when looking up a neighbour */
+#define NEIGH_PROBE				8
+/** Weight of the moving averages of the neighbour table (1/n of each sample) */
+#define NEIGH_EWMA_WEIGHT		8
+/**@}*/
+
+/**
+ * @name Statistics
+ * @{
+ */
+/** Number of buckets of the latency histograms of AT+STATS */
+#define STATS_HIST_BUCKETS		10
+/** Upper bound (in ms) of the first bucket, each following bucket doubles it, the last one has no bound */
+#define STATS_HIST_BASE			32
+/**@}*/
+
 /**
  * @name Bounds for configuration variables
  * @{
@@ -191,6 +450,8 @@
 typedef void (*LOWAPP_TIMER_CB_T)(void);
 /** LoRa reception callback */
 typedef void (*LOWAPP_LORARX_CB_T)(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
+/** LoRa RX header callback, false to stop the reception */
+typedef bool (*LOWAPP_LORARXHEADER_CB_T)(uint8_t *head, uint16_t size);
 /** LoRa RX error callback */
 typedef void (*LOWAPP_LORARXERROR_CB_T)(void);
 /** LoRa RX timeout callback */
@@ -324,6 +585,12 @@ typedef struct
 	LOWAPP_LORATXTIMEOUT_CB_T TxTimeout;
 	/** LoRa reception callback */
 	LOWAPP_LORARX_CB_T RxDone;
+	/**
+	 * LoRa start of reception callback, called with the first #FRAME_HINT_END
+	 * bytes of a frame by the radio layers able to read them before its end,
+	 * NULL if not used
+	 */
+	LOWAPP_LORARXHEADER_CB_T RxHeader;
 	/** LoRa RX timeout callback */
     LOWAPP_LORARXTIMEOUT_CB_T RxTimeout;
 	/** LoRa RX error callback */
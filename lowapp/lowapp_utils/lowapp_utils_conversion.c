@@ -244,6 +244,25 @@ uint8_t FillBuffer16_t(uint8_t *buffer,uint8_t BufferOffset,uint16_t *Data, uint
 	return BufferOffset+index;
 }
 
+/*
+ * Fill a buffer with the conversion into decimal of a signed integer,
+ * preceded by a minus sign if it is negative.
+ */
+uint8_t FillBufferS16_t(uint8_t *buffer,uint8_t BufferOffset,int16_t Data, bool addEndChar)
+{
+	uint16_t Magnitude;
+	if(Data<0)
+	{
+		buffer[BufferOffset++]='-';
+		Magnitude=-(int32_t)Data;
+	}
+	else
+	{
+		Magnitude=Data;
+	}
+	return FillBuffer16_t(buffer,BufferOffset,&Magnitude,1,addEndChar);
+}
+
 /*
  * Convert ascii string into an integer.
  * The string is read as a decimal string
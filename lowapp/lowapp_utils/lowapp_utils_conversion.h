@@ -47,6 +47,7 @@ uint8_t DecimalAsciiConversion (uint16_t decimal);
 uint16_t AsciiDecStringConversion_t( const uint8_t *InBuffer , uint8_t BufSize);
 uint8_t FillBuffer8_t(uint8_t *buffer,uint8_t BufferOffset,uint8_t *Data, uint8_t DataSize, bool addEndChar);
 uint8_t FillBuffer16_t(uint8_t *buffer,uint8_t BufferOffset,uint16_t *Data, uint8_t DataSize, bool addEndChar);
+uint8_t FillBufferS16_t(uint8_t *buffer,uint8_t BufferOffset,int16_t Data, bool addEndChar);
 uint8_t FillBufferHexBI8_t(uint8_t *buffer,uint8_t BufferOffset,uint8_t *Data, uint8_t DataSize, bool addEndChar);
 uint8_t FillBufferHexLI8_t(uint8_t *buffer,uint8_t BufferOffset,uint8_t *Data, uint8_t DataSize, bool addEndChar);
 uint8_t AsciiHexStringConversionBI8_t( uint8_t *OutBuffer, const uint8_t *InBuffer , uint8_t BufSize);
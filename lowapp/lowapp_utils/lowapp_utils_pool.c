@@ -0,0 +1,108 @@
+/**
+ * @file lowapp_utils_pool.c
+ * @brief Functions to manage pools of fixed size blocks
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+#include "lowapp_utils_pool.h"
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils_pool LoWAPP Core Utility Pools
+ * @brief Allocation of fixed size blocks in constant time
+ * @{
+ */
+
+/**
+ * @brief Get the address of the next free block link of a block
+ * @param pool Pool of the block
+ * @param index Index of the block
+ * @return The address of the link
+ */
+static volatile uint16_t* pool_link(POOL_T* pool, uint16_t index) {
+	return (volatile uint16_t*)(pool->blocks + (uint32_t)index * pool->blockSize);
+}
+
+/**
+ * @brief Allocate a block from a pool
+ *
+ * The content of the block is not initialised.
+ *
+ * @param pool Pool to allocate from
+ * @return The block
+ * @retval NULL If all the blocks of the pool are allocated
+ */
+void* pool_alloc(POOL_T* pool) {
+	uint32_t head;
+	uint16_t index, used;
+	/* First block of the free list */
+	do {
+		head = pool->head;
+		index = head & 0xFFFF;
+		if (index == POOL_NONE) {
+			break;
+		}
+	} while (!__sync_bool_compare_and_swap(&pool->head, head,
+			((head + 0x10000) & 0xFFFF0000) | *pool_link(pool, index)));
+	/* Else a block never used yet */
+	if (index == POOL_NONE) {
+		do {
+			index = pool->fresh;
+			if (index >= pool->count) {
+				/* The pool is empty */
+				if (pool->fails < UINT16_MAX) {
+					__sync_fetch_and_add(&pool->fails, 1);
+				}
+				return NULL;
+			}
+		} while (!__sync_bool_compare_and_swap(&pool->fresh, index, index + 1));
+	}
+	used = __sync_add_and_fetch(&pool->used, 1);
+	/* Statistics only, a race between contexts is harmless */
+	if (used > pool->hwm) {
+		pool->hwm = used;
+	}
+	return pool->blocks + (uint32_t)index * pool->blockSize;
+}
+
+/**
+ * @brief Give a block back to its pool
+ *
+ * @param pool Pool the block was allocated from
+ * @param block Block to free, nothing is done if NULL
+ */
+void pool_free(POOL_T* pool, void* block) {
+	uint32_t head;
+	uint16_t index;
+	if (block == NULL) {
+		return;
+	}
+	index = ((uint8_t*)block - pool->blocks) / pool->blockSize;
+	do {
+		head = pool->head;
+		*pool_link(pool, index) = head & 0xFFFF;
+	} while (!__sync_bool_compare_and_swap(&pool->head, head,
+			((head + 0x10000) & 0xFFFF0000) | index));
+	__sync_fetch_and_sub(&pool->used, 1);
+}
+
+/**
+ * @brief Restart the high-water mark and the failure counter of a pool
+ * @param pool Pool to reset
+ */
+void pool_clear_stats(POOL_T* pool) {
+	pool->hwm = pool->used;
+	pool->fails = 0;
+}
+
+/** @} */
+/** @} */
+/** @} */
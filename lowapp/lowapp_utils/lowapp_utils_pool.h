@@ -0,0 +1,68 @@
+/**
+ * @file lowapp_utils_pool.h
+ * @brief Functions to manage pools of fixed size blocks
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_UTILS_POOL_H_
+#define LOWAPP_UTILS_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils_pool
+ * @{
+ */
+
+/** Index marking the end of the free list of a pool */
+#define POOL_NONE	0xFFFF
+
+/**
+ * Static initialiser of a pool
+ *
+ * @param storage Array of blocks of the pool, each block being at least 2 bytes
+ * @param n Number of blocks of storage, less than #POOL_NONE
+ */
+#define POOL_INIT(storage, n)	{ POOL_NONE, 0, (uint8_t*)(storage), sizeof((storage)[0]), (n), 0, 0, 0 }
+
+/**
+ * Pool of fixed size blocks
+ *
+ * Free blocks are kept in a linked list, the index of the next free block being
+ * written in the first bytes of each free block. The head of the list is
+ * updated with a compare-and-swap, along with a tag changed on every update, so
+ * that blocks can be allocated and freed from any context, interrupt handlers
+ * included, without any lock. Blocks never used yet are taken in order, so
+ * that a pool needs no initialisation.
+ */
+typedef struct POOL {
+	volatile uint32_t head;	/**< Index of the first free block (low 16 bits) and tag (high 16 bits) */
+	volatile uint16_t fresh;	/**< Number of blocks taken from the storage at least once */
+	uint8_t* blocks;		/**< Storage of the blocks */
+	uint16_t blockSize;		/**< Size in bytes of a block */
+	uint16_t count;			/**< Number of blocks of the pool */
+	volatile uint16_t used;	/**< Number of blocks allocated */
+	volatile uint16_t hwm;	/**< Highest number of blocks allocated */
+	volatile uint16_t fails;	/**< Number of allocations refused because the pool was empty */
+} POOL_T;
+
+/** @} */
+/** @} */
+/** @} */
+
+void* pool_alloc(POOL_T* pool);
+void pool_free(POOL_T* pool, void* block);
+void pool_clear_stats(POOL_T* pool);
+
+#endif /* LOWAPP_UTILS_POOL_H_ */
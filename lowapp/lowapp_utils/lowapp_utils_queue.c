@@ -6,6 +6,7 @@
  * @date August 26, 2016
  */
 #include "lowapp_utils_queue.h"
+#include <string.h>
 #ifdef SIMU
 	#include "lowapp_shared_res.h"
 #endif
@@ -24,9 +25,46 @@
  * @{
  */
 
+/**
+ * @brief Initialise an empty queue over its storage
+ *
+ * @param q Queue to initialise
+ * @param els Array of elements used as ring buffer
+ * @param size Number of elements of els, a power of two up to #QUEUE_MAX_SIZE
+ */
+void queue_init(volatile QFIXED_T* q, QEL_T* els, uint8_t size) {
+	memset(els, 0, size * sizeof(QEL_T));
+	q->head = 0;
+	q->tail = 0;
+	q->mask = size - 1;
+	q->hwm = 0;
+	q->drops = 0;
+	q->els = els;
+}
+
+/**
+ * @brief Initialise an empty event queue over its storage
+ *
+ * @param q Queue to initialise
+ * @param evts Array of events used as ring buffer
+ * @param size Number of events of evts, a power of two up to #QUEUE_MAX_SIZE
+ */
+void event_init(volatile QEVENT_T* q, EVENT_T* evts, uint8_t size) {
+	memset(evts, 0, size * sizeof(EVENT_T));
+	q->head = 0;
+	q->tail = 0;
+	q->mask = size - 1;
+	q->hwm = 0;
+	q->drops = 0;
+	q->pending = 0;
+	q->evts = evts;
+}
+
 /**
  * @brief Add element to the head of a queue
  *
+ * Only one context may add elements to a given queue.
+ *
  * @param q Queue in which the element should be put
  * @param d Element to put in the queue
  * @param dlen Size of the element d
@@ -35,22 +73,33 @@
  * @retval -1 If the queue was full and the element could not be added
  */
 int8_t add_to_queue(volatile QFIXED_T* q, void* d, uint16_t dlen) {
-	if (q->count == MAXQSZ) {
+	uint8_t head = q->head;
+	uint8_t count = head - q->tail;
+	if (count > q->mask) {
 		/* The queue is full */
+		if (q->drops < UINT16_MAX) {
+			q->drops++;
+		}
 		return -1;
 	}
 	/* Fill data into head of the queue */
-	q->els[q->head].data = d;
-	q->els[q->head].datalen = dlen;
-	/* Move the head to the next available space in the buffer */
-	q->head = (q->head + 1)%MAXQSZ;
-	/* Increment the number of element in the queue and return it */
-	return ++(q->count);
+	q->els[head & q->mask].data = d;
+	q->els[head & q->mask].datalen = dlen;
+	/* Publish the element before moving the head */
+	QUEUE_BARRIER();
+	q->head = head + 1;
+	/* Return the number of element in the queue */
+	if (count >= q->hwm) {
+		q->hwm = count + 1;
+	}
+	return count + 1;
 }
 
 /**
  * @brief Get an element from the tail of a queue
  *
+ * Only one context may retrieve elements from a given queue.
+ *
  * @param q Queue from which to extract the element
  * @param d Pointer to the element extracted from the queue
  * @param dlen Size of the element d
@@ -59,20 +108,81 @@ int8_t add_to_queue(volatile QFIXED_T* q, void* d, uint16_t dlen) {
  * @retval -1 If the queue was empty
  */
 int8_t get_from_queue(volatile QFIXED_T* q, void**d, uint16_t* dlen) {
-	if (q->count == 0) {
+	uint8_t tail = q->tail;
+	if (q->head == tail) {
 		/* The queue is empty */
 		return -1;
 	}
+	/* Do not read the element before the head publishing it */
+	QUEUE_BARRIER();
 	/* Retrieve data from tail of the queue */
-	*d = q->els[q->tail].data;
-	*dlen = q->els[q->tail].datalen;
+	*d = q->els[tail & q->mask].data;
+	*dlen = q->els[tail & q->mask].datalen;
 	/* Reset data pointed to by the tail */
-	q->els[q->tail].data=NULL;
-	q->els[q->tail].datalen=0;
-	/* Move the tail */
-	q->tail = (q->tail + 1) % MAXQSZ;
-	/* Decrease the number of elements in the queue and return it */
-	return --(q->count);
+	q->els[tail & q->mask].data = NULL;
+	q->els[tail & q->mask].datalen = 0;
+	/* Give the place back to the producer */
+	QUEUE_BARRIER();
+	q->tail = tail + 1;
+	/* Return the number of elements left in the queue */
+	return (uint8_t)(q->head - q->tail);
+}
+
+/**
+ * @brief Read an element of a queue without removing it
+ *
+ * Only valid for a queue used by a single context (the TX queues).
+ *
+ * @param q Queue to read from
+ * @param pos Position of the element, starting from the tail (0 is the oldest)
+ * @param d Pointer to the element
+ * @param dlen Size of the element d
+ *
+ * @retval 0 If the element was read
+ * @retval -1 If there is no element at this position
+ */
+int8_t peek_queue(volatile QFIXED_T* q, uint8_t pos, void**d, uint16_t* dlen) {
+	if (pos >= queue_size(q)) {
+		return -1;
+	}
+	*d = q->els[(q->tail + pos) & q->mask].data;
+	*dlen = q->els[(q->tail + pos) & q->mask].datalen;
+	return 0;
+}
+
+/**
+ * @brief Extract an element from any position of a queue
+ *
+ * The order of the remaining elements is kept. Only valid for a queue used by
+ * a single context (the TX queues).
+ *
+ * @param q Queue from which to extract the element
+ * @param pos Position of the element, starting from the tail (0 is the oldest)
+ * @param d Pointer to the element extracted from the queue
+ * @param dlen Size of the element d
+ *
+ * @return The new size of the queue
+ * @retval -1 If there is no element at this position
+ */
+int8_t remove_from_queue(volatile QFIXED_T* q, uint8_t pos, void**d, uint16_t* dlen) {
+	uint8_t i, cur, prev;
+	if (pos >= queue_size(q)) {
+		return -1;
+	}
+	cur = (q->tail + pos) & q->mask;
+	*d = q->els[cur].data;
+	*dlen = q->els[cur].datalen;
+	/* Shift older elements towards the head to fill the gap */
+	for (i = pos; i > 0; --i) {
+		prev = (cur - 1) & q->mask;
+		q->els[cur] = q->els[prev];
+		cur = prev;
+	}
+	/* The tail element is now duplicated, free its place */
+	q->els[q->tail & q->mask].data = NULL;
+	q->els[q->tail & q->mask].datalen = 0;
+	q->tail++;
+	return queue_size(q);
 }
 
 /**
@@ -81,7 +191,7 @@ int8_t get_from_queue(volatile QFIXED_T* q, void**d, uint16_t* dlen) {
  * @return The number of elements in the queue
  */
 uint8_t queue_size(volatile QFIXED_T* q) {
-	return q->count;
+	return (uint8_t)(q->head - q->tail);
 }
 
 /**
@@ -92,21 +202,46 @@ uint8_t queue_size(volatile QFIXED_T* q) {
  * @retval false If the queue is not full
  */
 bool queue_full(volatile QFIXED_T* q) {
-	return q->count == MAXQSZ;
+	return queue_size(q) > q->mask;
 }
 
 /**
  * @brief Get the size of the queue
+ *
+ * Events reserved by a producer but not written yet are counted.
+ *
  * @param q Queue to check
  * @return The number of elements in the queue
  */
 uint8_t event_size(volatile QEVENT_T* q) {
-	return q->count;
+	return (uint8_t)(q->head - q->tail);
+}
+
+/**
+ * @brief Restart the high-water mark and the drop counter of a queue
+ * @param q Queue to reset
+ */
+void queue_clear_stats(volatile QFIXED_T* q) {
+	q->hwm = queue_size(q);
+	q->drops = 0;
+}
+
+/**
+ * @brief Restart the high-water mark and the drop counter of an event queue
+ * @param q Queue to reset
+ */
+void event_clear_stats(volatile QEVENT_T* q) {
+	q->hwm = event_size(q);
+	q->drops = 0;
 }
 
 /**
  * @brief Add an event to an event queue
  *
+ * Can be called from any context, including interrupt handlers, without
+ * locking the queue. An event of #EVENT_COALESCED without data is only
+ * marked as pending, and merged with the same event if it is already pending.
+ *
  * @param q Queue in which the event should be put
  * @param t Event to put in the queue
  * @param d Data to store along the event
@@ -116,23 +251,45 @@ uint8_t event_size(volatile QEVENT_T* q) {
  * @retval -1 If the queue was full and the event could not be added
  */
 int8_t add_event(volatile QEVENT_T* q, EVENTS t, void* d, uint16_t dlen) {
+	uint8_t head, count;
+	volatile EVENT_T* evt;
 	LOG(LOG_STATES, "Add event %u to queue", t);
-	if (q->count == MAXQSZ) {
-		LOG(LOG_ERR, "The queue was full");
-		/* The queue is full */
-		return -1;
+	if (d == NULL && (EVENT_BIT(t) & EVENT_COALESCED)) {
+		__sync_fetch_and_or(&q->pending, EVENT_BIT(t));
+#ifdef SIMU
+		wakeup_sm();
+#endif
+		return event_size(q);
+	}
+	/* Reserve the head of the queue */
+	do {
+		head = q->head;
+		count = head - q->tail;
+		if (count > q->mask) {
+			LOG(LOG_ERR, "The queue was full");
+			/* The queue is full */
+			if (q->drops < UINT16_MAX) {
+				__sync_fetch_and_add(&q->drops, 1);
+			}
+			return -1;
+		}
+	} while (!__sync_bool_compare_and_swap(&q->head, head, (uint8_t)(head + 1)));
+	/* Fill data into the reserved event */
+	evt = &q->evts[head & q->mask];
+	evt->type = t;
+	evt->data = d;
+	evt->datalen = dlen;
+	/* Publish the event to the consumer */
+	QUEUE_BARRIER();
+	evt->ready = 1;
+	/* Statistics only, a race between producers is harmless */
+	if (count >= q->hwm) {
+		q->hwm = count + 1;
 	}
-	/* Fill data into head of the queue */
-	q->evts[q->head].type = t;
-	q->evts[q->head].data = d;
-	q->evts[q->head].datalen = dlen;
-	/* Move the head to the next available space in the buffer */
-	q->head = (q->head + 1)%MAXQSZ;
-	/* Increment the number of element in the queue and return it */
 #ifdef SIMU
 	wakeup_sm();
 #endif
-	return ++(q->count);
+	return count + 1;
 }
 
 /**
@@ -147,10 +304,13 @@ int8_t add_simple_event(volatile QEVENT_T* q, EVENTS t) {
 	return add_event(q, t, NULL, 0);
 }
 
-// Return (and remove) next event type via params, returns new qsize if ok or -1 if empty
 /**
  * @brief Get event from an event queue
  *
+ * Only the state machine retrieves events. An event reserved by a producer
+ * which was interrupted before writing it is not available yet, and neither
+ * are the events added after it.
+ *
  * @param q Queue from which to extract the element
  * @param t Pointer to the event extracted from the queue
  * @param d Pointer to the data associated with the extracted event
@@ -160,75 +320,54 @@ int8_t add_simple_event(volatile QEVENT_T* q, EVENTS t) {
  * @retval -1 If the queue was empty
  */
 int8_t get_event(volatile QEVENT_T* q, EVENTS* t, void** d, uint16_t *dlen) {
-	if (q->count == 0) {
+	uint8_t tail = q->tail;
+	volatile EVENT_T* evt = &q->evts[tail & q->mask];
+	if (q->head == tail || !evt->ready) {
 		/* The queue is empty */
 		return -1;
 	}
+	/* Do not read the event before its ready flag */
+	QUEUE_BARRIER();
 	/* Retrieve event and data from tail of the queue */
-	*t = q->evts[q->tail].type;
-	*d = q->evts[q->tail].data;
-	*dlen = q->evts[q->tail].datalen;
+	*t = evt->type;
+	*d = evt->data;
+	*dlen = evt->datalen;
 	/* Reset data pointed to by the tail */
-	q->evts[q->tail].type = STATE_ENTER;
-	q->evts[q->tail].data = NULL;
-	q->evts[q->tail].datalen = 0;
-	/* Move the tail */
-	q->tail = (q->tail + 1) % MAXQSZ;
-	/* Decrease the number of elements in the queue and return it */
-	return --(q->count);		// new q size
+	evt->type = STATE_ENTER;
+	evt->data = NULL;
+	evt->datalen = 0;
+	evt->ready = 0;
+	/* Give the place back to the producers */
+	QUEUE_BARRIER();
+	q->tail = tail + 1;
+	/* Return the number of events left in the queue */
+	return (uint8_t)(q->head - q->tail);
 }
 
-
 /**
- * @brief Add element to a statistics queue
+ * @brief Get a pending coalesced event from an event queue
  *
- * @param q Queue in which the element should be put
- * @param d Element to put in the queue
+ * The pending events are retrieved in the order of #EVENTS, whatever the
+ * order in which they were posted.
  *
- * @return The size of the queue once the element was added
+ * @param q Queue from which to extract the event
+ * @param t Pointer to the event extracted from the queue
+ *
+ * @retval 0 If an event was pending
+ * @retval -1 If no event was pending
  */
-int8_t add_to_statqueue(volatile QSTAT_T* q, STAT_T d) {
-	uint8_t i;
-	uint8_t foundAtPos = MAXQSZ;
-	uint8_t oldestRecordI = 0;
-
-	/* Search the device using its device id */
-	for(i = 0; i < q->count; i++) {
-		if(q->els[i].deviceId == d.deviceId) {
-			/* Update element */
-			q->els[i] = d;
-			foundAtPos = i;
-		}
-		else {
-			if(q->els[i].lastSeen < q->els[oldestRecordI].lastSeen) {
-				oldestRecordI = i;
-			}
-		}
-	}
-	/*
-	 * If the device is not in the list, we try to add it.
-	 * If the queue is full, we replace the oldest record.
-	 */
-	if(foundAtPos == MAXQSZ) {
-		if (q->count == MAXQSZ) {
-			/* Erase oldest record */
-			q->els[oldestRecordI] = d;
+int8_t get_pending(volatile QEVENT_T* q, EVENTS* t) {
+	uint32_t pending, bit;
+	do {
+		pending = q->pending;
+		if (pending == 0) {
+			return -1;
 		}
-		else {
-			q->els[q->count] = d;
-			q->count++;
-		}
-	}
-	return q->count;
-}
-
-/**
- * @brief Get the size of the queue
- * @param q Queue to check
- * @return The number of elements in the queue
- */
-uint8_t statqueue_size(volatile QSTAT_T* q) {
-	return q->count;
+		/* Lowest pending event */
+		bit = pending & (~pending + 1);
+	} while (!__sync_bool_compare_and_swap(&q->pending, pending, pending & ~bit));
+	*t = (EVENTS)__builtin_ctzl(bit);
+	return 0;
 }
 
 /** @} */
@@ -25,8 +25,29 @@
  * @{
  */
 
-/** Size of the FIFO queues (< 128) */
-#define MAXQSZ	16
+/** Largest capacity of a queue, so that its size fits in the int8_t results */
+#define QUEUE_MAX_SIZE	64
+
+/** Check a queue capacity, usable in preprocessor conditions */
+#define QUEUE_SIZE_VALID(n)	((n) >= 2 && (n) <= QUEUE_MAX_SIZE && ((n) & ((n) - 1)) == 0)
+
+/**
+ * Memory barrier between the writes to an element and the update of the index
+ * publishing it to the other side of the queue
+ */
+#define QUEUE_BARRIER()	__sync_synchronize()
+
+/** Bit of an event type in the pending events of an event queue */
+#define EVENT_BIT(t)	(1UL << (t))
+
+/**
+ * Event types coalesced at post time
+ *
+ * These events carry no data and processing one of them handles all the
+ * previous ones, so they are kept as pending bits instead of ring elements.
+ */
+#define EVENT_COALESCED	(EVENT_BIT(CADTIMEOUT) | EVENT_BIT(TXUNBLOCK) \
+		| EVENT_BIT(RXAT) | EVENT_BIT(TXREQ) | EVENT_BIT(DEFERRED))
 
 /** Generic element for FIFO queue */
 typedef struct QEL {
@@ -35,15 +56,21 @@ typedef struct QEL {
 } QEL_T;
 
 /**
- * FIFO represented as a ring buffer of generic elements
+ * Lock-free FIFO represented as a ring buffer of generic elements
  *
  * Elements are added in the head of the queue and retrieved from the tail.
+ * The capacity is a power of two (at most #QUEUE_MAX_SIZE) and head and tail
+ * run freely, the size of the queue being their difference. Only the producer
+ * writes the head and only the consumer writes the tail, so that one producer
+ * and one consumer can use the queue concurrently without any lock.
  */
 typedef struct QFIXED {
-	uint8_t head;		/**< Head of the FIFO queue */
-	uint8_t tail;		/**< Tail of the FIFO queue */
-	uint8_t count;		/**< Number of elements in the queue */
-	QEL_T els[MAXQSZ];	/**< Array used for ring buffer */
+	volatile uint8_t head;	/**< Head of the FIFO queue, written by the producer */
+	volatile uint8_t tail;	/**< Tail of the FIFO queue, written by the consumer */
+	uint8_t mask;		/**< Capacity of the queue minus one */
+	uint8_t hwm;		/**< Highest number of elements reached */
+	uint16_t drops;		/**< Number of elements refused because the queue was full */
+	QEL_T* els;			/**< Array used for ring buffer */
 } QFIXED_T;
 
 /**
@@ -56,45 +83,51 @@ typedef struct EVENT {
 	EVENTS type;		/**< Type of the event */
 	void* data;			/**< Data related to the event (optional) */
 	uint16_t datalen;	/**< Size in bytes of the event */
+	volatile uint8_t ready;	/**< Set once the producer has written the event */
 } EVENT_T;
 
 /**
- * FIFO represented as a ring buffer of event elements
+ * Lock-free FIFO represented as a ring buffer of event elements
  *
  * Elements are added in the head of the queue and retrieved from the tail.
+ * Several producers (interrupt handlers, timers, application) reserve their
+ * element by moving the head with a compare-and-swap, then mark it ready once
+ * written. The single consumer (the state machine) only retrieves ready
+ * elements and is the only one writing the tail.
+ *
+ * The events of #EVENT_COALESCED posted without data are not put in the ring
+ * but set a pending bit, so that they never fill the queue.
  */
 typedef struct QEVENT {
-	uint8_t head;		/**< Head of the FIFO queue */
-	uint8_t tail;		/**< Tail of the FIFO queue */
-	uint8_t count;		/**< Number of elements in the queue */
-	EVENT_T evts[MAXQSZ];	/**< Array used for ring buffer */
+	volatile uint8_t head;	/**< Head of the FIFO queue, reserved by the producers */
+	volatile uint8_t tail;	/**< Tail of the FIFO queue, written by the consumer */
+	uint8_t mask;		/**< Capacity of the queue minus one */
+	volatile uint8_t hwm;	/**< Highest number of elements reached */
+	volatile uint16_t drops;	/**< Number of elements refused because the queue was full */
+	volatile uint32_t pending;	/**< Coalesced events posted and not retrieved yet (#EVENT_BIT) */
+	EVENT_T* evts;		/**< Array used for ring buffer */
 } QEVENT_T;
 
-/**
- * FIFO represented as a ring buffer of generic elements
- *
- * Elements are added in the head of the queue and retrieved from the tail.
- */
-typedef struct QSTAT {
-	uint8_t count;		/**< Number of elements in the queue */
-	STAT_T els[MAXQSZ];	/**< Array used for ring buffer */
-} QSTAT_T;
-
 /** @} */
 /** @} */
 /** @} */
 
+void queue_init(volatile QFIXED_T* q, QEL_T* els, uint8_t size);
+void event_init(volatile QEVENT_T* q, EVENT_T* evts, uint8_t size);
+
 uint8_t event_size(volatile QEVENT_T* q);
 int8_t add_event(volatile QEVENT_T* q, EVENTS t, void* d, uint16_t dlen);
 int8_t add_simple_event(volatile QEVENT_T* q, EVENTS t);
 int8_t get_event(volatile QEVENT_T* q, EVENTS* t, void** d, uint16_t *dlen);
+int8_t get_pending(volatile QEVENT_T* q, EVENTS* t);
 
 int8_t add_to_queue(volatile QFIXED_T* q, void* d, uint16_t dlen);
 int8_t get_from_queue(volatile QFIXED_T* q, void**d, uint16_t* dlen);
+int8_t peek_queue(volatile QFIXED_T* q, uint8_t pos, void**d, uint16_t* dlen);
+int8_t remove_from_queue(volatile QFIXED_T* q, uint8_t pos, void**d, uint16_t* dlen);
 uint8_t queue_size(volatile QFIXED_T* q);
 bool queue_full(volatile QFIXED_T* q);
-
-int8_t add_to_statqueue(volatile QSTAT_T* q, STAT_T d);
-uint8_t statqueue_size(volatile QSTAT_T* q);
+void queue_clear_stats(volatile QFIXED_T* q);
+void event_clear_stats(volatile QEVENT_T* q);
 
 #endif /* LOWAPP_UTILS_QUEUE_H_ */
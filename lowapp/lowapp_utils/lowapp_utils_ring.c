@@ -0,0 +1,181 @@
+/**
+ * @file lowapp_utils_ring.c
+ * @brief Functions to manage rings of variable size records
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+#include "lowapp_utils_ring.h"
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils_ring LoWAPP Core Utility Rings
+ * @brief Storage of variable size records in a single byte array
+ * @{
+ */
+
+/**
+ * @brief Move the oldest record of a ring to the start when the end was skipped
+ *
+ * The end of the array is skipped when it holds a null length, or is too short
+ * for a length.
+ *
+ * @param ring Ring holding at least one record
+ */
+static void ring_skip_end(RING_T* ring) {
+	uint16_t left = ring->size - ring->tail;
+	if (left < RING_PREFIX_SIZE
+			|| (ring->buf[ring->tail] == 0 && ring->buf[ring->tail+1] == 0)) {
+		ring->used -= left;
+		ring->tail = 0;
+	}
+}
+
+/**
+ * @brief Add a record at the end of a ring
+ *
+ * The space of the record is reserved and counted in the ring at once, the
+ * caller must write its content before any other access to the ring.
+ *
+ * @param ring Ring to add to
+ * @param len Size in bytes of the record, not null
+ * @return The address where the content of the record must be written
+ * @retval NULL If there is no room left for the record
+ */
+uint8_t* ring_put(RING_T* ring, uint16_t len) {
+	uint32_t need = (uint32_t)len + RING_PREFIX_SIZE;
+	uint16_t pos;
+	if (ring->used == 0) {
+		/* Start from the beginning, for the longest free space */
+		ring->head = 0;
+		ring->tail = 0;
+	}
+	if (len == 0 || need > ring->size) {
+		pos = ring->size;
+	}
+	else if (ring->used > 0 && ring->head <= ring->tail) {
+		/* Free space between the newest record and the oldest one */
+		pos = ((uint32_t)(ring->tail - ring->head) >= need) ? ring->head : ring->size;
+	}
+	else if ((uint32_t)(ring->size - ring->head) >= need) {
+		/* Free space up to the end of the array */
+		pos = ring->head;
+	}
+	else if (ring->tail >= need) {
+		/* Skip the end of the array, marked with a null length if possible */
+		if (ring->size - ring->head >= RING_PREFIX_SIZE) {
+			ring->buf[ring->head] = 0;
+			ring->buf[ring->head+1] = 0;
+		}
+		ring->used += ring->size - ring->head;
+		pos = 0;
+	}
+	else {
+		pos = ring->size;
+	}
+	if (pos == ring->size) {
+		if (ring->drops < UINT16_MAX) {
+			ring->drops++;
+		}
+		return NULL;
+	}
+	ring->buf[pos] = len & 0xFF;
+	ring->buf[pos+1] = len >> 8;
+	ring->head = pos + need;
+	if (ring->head == ring->size) {
+		ring->head = 0;
+	}
+	ring->used += need;
+	ring->count++;
+	if (ring->count > ring->hwm) {
+		ring->hwm = ring->count;
+	}
+	if (ring->used > ring->hwmBytes) {
+		ring->hwmBytes = ring->used;
+	}
+	return ring->buf + pos + RING_PREFIX_SIZE;
+}
+
+/**
+ * @brief Get the oldest record of a ring, leaving it in the ring
+ *
+ * The record stays valid, and can be modified, until it is removed.
+ *
+ * @param ring Ring to read from
+ * @param[out] len Size in bytes of the record
+ * @return The address of the content of the record
+ * @retval NULL If the ring is empty
+ */
+uint8_t* ring_get(RING_T* ring, uint16_t* len) {
+	if (ring->count == 0) {
+		return NULL;
+	}
+	ring_skip_end(ring);
+	*len = ring->buf[ring->tail] | (ring->buf[ring->tail+1] << 8);
+	return ring->buf + ring->tail + RING_PREFIX_SIZE;
+}
+
+/**
+ * @brief Remove the oldest record of a ring
+ * @param ring Ring to remove from, nothing is done if it is empty
+ */
+void ring_remove(RING_T* ring) {
+	uint16_t need;
+	if (ring->count == 0) {
+		return;
+	}
+	ring_skip_end(ring);
+	need = (ring->buf[ring->tail] | (ring->buf[ring->tail+1] << 8)) + RING_PREFIX_SIZE;
+	ring->tail += need;
+	if (ring->tail == ring->size) {
+		ring->tail = 0;
+	}
+	ring->used -= need;
+	ring->count--;
+	if (ring->count == 0) {
+		ring->head = 0;
+		ring->tail = 0;
+		ring->used = 0;
+	}
+}
+
+/**
+ * @brief Remove all the records of a ring
+ * @param ring Ring to empty
+ */
+void ring_clear(RING_T* ring) {
+	ring->head = 0;
+	ring->tail = 0;
+	ring->used = 0;
+	ring->count = 0;
+}
+
+/**
+ * @brief Get the number of records in a ring
+ * @param ring Ring
+ * @return The number of records
+ */
+uint16_t ring_count(RING_T* ring) {
+	return ring->count;
+}
+
+/**
+ * @brief Restart the high-water marks and the drop counter of a ring
+ * @param ring Ring to reset
+ */
+void ring_clear_stats(RING_T* ring) {
+	ring->hwm = ring->count;
+	ring->hwmBytes = ring->used;
+	ring->drops = 0;
+}
+
+/** @} */
+/** @} */
+/** @} */
@@ -0,0 +1,69 @@
+/**
+ * @file lowapp_utils_ring.h
+ * @brief Functions to manage rings of variable size records
+ *
+ * @author agent
+ * @date October 18, 2026
+ */
+
+#ifndef LOWAPP_UTILS_RING_H_
+#define LOWAPP_UTILS_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @addtogroup lowapp_core
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils
+ * @{
+ */
+/**
+ * @addtogroup lowapp_core_utils_ring
+ * @{
+ */
+
+/** Size in bytes of the length prefix of a record */
+#define RING_PREFIX_SIZE	2
+
+/**
+ * Static initialiser of a ring
+ *
+ * @param storage Byte array of the ring, less than 64 kB
+ */
+#define RING_INIT(storage)	{ (uint8_t*)(storage), sizeof(storage), 0, 0, 0, 0, 0, 0, 0 }
+
+/**
+ * Ring of variable size records
+ *
+ * Records are written one after the other in a single byte array, each one
+ * prefixed with its length. A record is never split: when it does not fit
+ * before the end of the array, the end is skipped and the record is written at
+ * the start. The ring is meant to be used from a single context.
+ */
+typedef struct RING {
+	uint8_t* buf;		/**< Storage of the records */
+	uint16_t size;		/**< Size in bytes of the storage */
+	uint16_t head;		/**< Offset of the next record written */
+	uint16_t tail;		/**< Offset of the oldest record */
+	uint16_t used;		/**< Bytes used, by the records and by the end skipped */
+	uint16_t count;		/**< Number of records */
+	uint16_t hwm;		/**< Highest number of records */
+	uint16_t hwmBytes;	/**< Highest number of bytes used */
+	uint16_t drops;		/**< Number of records refused because the ring was full */
+} RING_T;
+
+/** @} */
+/** @} */
+/** @} */
+
+uint8_t* ring_put(RING_T* ring, uint16_t len);
+uint8_t* ring_get(RING_T* ring, uint16_t* len);
+void ring_remove(RING_T* ring);
+void ring_clear(RING_T* ring);
+uint16_t ring_count(RING_T* ring);
+void ring_clear_stats(RING_T* ring);
+
+#endif /* LOWAPP_UTILS_RING_H_ */
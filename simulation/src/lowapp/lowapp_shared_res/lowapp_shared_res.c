@@ -22,13 +22,6 @@
  * @{
  */
 
-/** Mutex protecting the standard event queue */
-pthread_mutex_t mutex_eventQ;
-/** Mutex protecting the cold event queue */
-pthread_mutex_t mutex_coldEventQ;
-/** Mutex protecting the at command queue */
-pthread_mutex_t mutex_atcmd;
-
 /** Pthread condition used to signal the radio thread */
 pthread_cond_t cond_wakeup;
 /** Mutex protecting the event queue for waking up the  */
@@ -59,9 +52,6 @@ void reset_device() {
  */
 void init_mutexes() {
 	pthread_mutex_init ( &mutex_wakeup, NULL);
-	pthread_mutex_init ( &mutex_atcmd, NULL);
-	pthread_mutex_init ( &mutex_coldEventQ, NULL);
-	pthread_mutex_init ( &mutex_eventQ, NULL);
 }
 /**
  * Lock the standard event queue mutex
@@ -75,50 +65,11 @@ int lock_wakeUp() {
 int unlock_wakeUp() {
 	return pthread_mutex_unlock(&mutex_wakeup);
 }
-/**
- * Lock the standard event queue mutex
- */
-int lock_eventQ() {
-	return pthread_mutex_lock(&mutex_eventQ);
-}
-/**
- * Unlock the standard event queue mutex
- */
-int unlock_eventQ() {
-	return pthread_mutex_unlock(&mutex_eventQ);
-}
-/**
- * Lock the cold event queue mutex
- */
-int lock_coldEventQ() {
-	return pthread_mutex_lock(&mutex_coldEventQ);
-}
-/**
- * Unlock the cold event queue mutex
- */
-int unlock_coldEventQ() {
-	return pthread_mutex_unlock(&mutex_coldEventQ);
-}
-/**
- * Lock the at command queue
- */
-int lock_atcmd() {
-	return pthread_mutex_lock(&mutex_atcmd);
-}
-/**
- * Unlock the at command queue
- */
-int unlock_atcmd() {
-	return pthread_mutex_unlock(&mutex_atcmd);
-}
 
 /**
  * Clean mutex resources
  */
 void clean_mutex() {
-    pthread_mutex_destroy(&mutex_eventQ);
-    pthread_mutex_destroy(&mutex_coldEventQ);
-    pthread_mutex_destroy(&mutex_atcmd);
     pthread_mutex_destroy(&mutex_wakeup);
 }
 
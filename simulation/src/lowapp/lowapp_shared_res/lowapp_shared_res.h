@@ -14,12 +14,6 @@ void reset_device();
 
 int lock_wakeUp();
 int unlock_wakeUp();
-int lock_eventQ();
-int unlock_eventQ();
-int lock_coldEventQ();
-int unlock_coldEventQ();
-int lock_atcmd();
-int unlock_atcmd();
 
 void init_mutexes();
 void clean_mutex();
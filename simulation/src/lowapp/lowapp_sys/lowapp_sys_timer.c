@@ -26,6 +26,8 @@
 timer_t timer_id;
 /** One shot timer 2 id */
 timer_t timer2_id;
+/** One shot timer 3 id */
+timer_t timer3_id;
 /** Repetitive timer id */
 timer_t timer_repet_id;
 
@@ -33,6 +35,8 @@ timer_t timer_repet_id;
 void (*timerCb)(void) = NULL;
 /** Callback for one shot timer 2 */
 void (*timer2Cb)(void) = NULL;
+/** Callback for one shot timer 3 */
+void (*timer3Cb)(void) = NULL;
 /** Callback for repetitive timer */
 void (*timerRepetCb)(void) = NULL;
 
@@ -218,6 +222,75 @@ void cancel_timer2() {
 
 /** @} */
 
+/**
+ * @name Third one shot timer
+ * @{
+ */
+
+/**
+ * Handler for the Linux timer signal, calling the timer3Cb callback
+ * @param sig Signal received
+ */
+void timer3_handler(sigval_t sig) {
+	timer3Cb();
+	pthread_exit(NULL);
+}
+
+/**
+ * Initialise the one shot timer 3 with its handler
+ */
+void init_timer3(void (*callback)(void)) {
+	struct sigevent sev;
+
+	/* Create the timer */
+	sev.sigev_notify = SIGEV_THREAD;	// Handle timer in a thread
+	sev.sigev_signo = SIGONESHOT3;
+	sev.sigev_notify_attributes = NULL;
+	sev.sigev_notify_function = timer3_handler;
+
+	timer3Cb = callback;
+
+	sev.sigev_value.sival_ptr = &timer3_id;
+	timer_create(CLOCK_MONOTONIC, &sev, &timer3_id);
+}
+
+
+/**
+ * Delete the timer 3 at the end of the program to free resources
+ */
+void clean_timer3() {
+	set_timer3(0);
+	timer_delete(timer3_id);
+}
+
+
+/**
+ * Request to set a callback to be called after timems ms
+ *
+ * @param timems Time after which the timer should send its signal
+ */
+void set_timer3(uint32_t timems) {
+	struct itimerspec its;
+
+	/* Convert into s and ns */
+	its.it_value.tv_sec = timems / 1000;
+	its.it_value.tv_nsec = (timems % 1000)*1000000;
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = 0;
+
+	/* Arm the timer */
+	timer_settime(timer3_id, 0, &its, NULL);
+}
+
+/**
+ * Disarm the timer
+ */
+void cancel_timer3() {
+	set_timer3(0);
+}
+
+/** @} */
+
 /**
  * @name Repetitive timer
  * @{
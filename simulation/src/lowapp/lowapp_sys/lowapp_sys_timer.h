@@ -17,11 +17,14 @@
 #define SIGONESHOT	SIGRTMIN
 /** SIgnal number for one shot timer 2 */
 #define SIGONESHOT2	SIGRTMIN+2
+/** SIgnal number for one shot timer 3 */
+#define SIGONESHOT3	SIGRTMIN+4
 /** Signal number for repetitive timer */
 #define SIGREPET	SIGRTMIN+1
 
 void init_timer1(void (*callback)(void));
 void init_timer2(void (*callback)(void));
+void init_timer3(void (*callback)(void));
 uint64_t get_time_ms();
 uint64_t get_time_us();
 void timer_callback(uint64_t ts);
@@ -31,6 +34,9 @@ void cancel_timer1();
 void set_timer2(uint32_t timems);
 void clean_timer2();
 void cancel_timer2();
+void set_timer3(uint32_t timems);
+void clean_timer3();
+void cancel_timer3();
 void set_repet_timer(uint32_t timems);
 void init_repet_timer(void (*callback)(void));
 void cancel_repet_timer();
@@ -14,6 +14,7 @@
 #include <lowapp_if.h>
 #include <lowapp_log.h>
 #include <lowapp_shared_res.h>
+#include <lowapp_smprof.h>
 #include <lowapp_sys.h>
 #include <lowapp_sys_timer.h>
 #include <pthread.h>
@@ -178,6 +179,7 @@ void releaseResources() {
 	clean_mutex();
 	clean_timer1();
 	clean_timer2();
+	clean_timer3();
 	clean_repet_timer();
 	clean_queues();
 }
@@ -199,6 +201,9 @@ void register_sigint_handler(void (*handler)(int)) {
  * Handler for SIGINT signal
  */
 void quitIRQ(int arg) {
+#ifdef LOWAPP_SM_PROFILE
+	smprof_dump();
+#endif
 	releaseResources();
 	printf("main exit\n");
 	exit(0);
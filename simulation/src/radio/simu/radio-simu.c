@@ -112,6 +112,9 @@ RadioEvents_t events;
 /** Pointer to the radio callbacks used in the radio driver files */
 RadioEvents_t *RadioEvents;
 
+/** Callback checking the start of a received frame, not part of the driver callbacks */
+static LOWAPP_LORARXHEADER_CB_T rxHeaderCallback = NULL;
+
 /** Actual bandwidth values */
 extern const uint32_t bandwidthValues[];
 
@@ -130,6 +133,7 @@ void simu_radio_init(Lowapp_RadioEvents_t *evt) {
 	events.RxTimeout = evt->RxTimeout;
 	events.TxDone = evt->TxDone;
 	events.TxTimeout = evt->TxTimeout;
+	rxHeaderCallback = evt->RxHeader;
 
 	RadioEvents = &events;
 
@@ -168,6 +172,7 @@ void simu_radio_setCallbacks(Lowapp_RadioEvents_t *evt) {
 	events.RxTimeout = evt->RxTimeout;
 	events.TxDone = evt->TxDone;
 	events.TxTimeout = evt->TxTimeout;
+	rxHeaderCallback = evt->RxHeader;
 	setRadioCallbacks(&events);
 }
 
@@ -965,6 +970,9 @@ int radio_rx(uint32_t timeoutms) {
  *  2. Read data from the file
  *  3. <b>Wait for the file to be removed before taking into account the data</b>
  *
+ * The reception is stopped at once when the core refuses the first bytes of
+ * the frame, which are then reported alone.
+ *
  * @param size Size of the data to read
  * @param timeoutms Reception timeout in ms
  * @retval 0 If success
@@ -1010,8 +1018,17 @@ int radio_read(int size, uint32_t timeoutms) {
 	}
 
 	fclose(fp);
-	/* Wait for the transmission to be finished */
 
+	/* Stop the reception of a frame refused from its first bytes */
+	if(ret >= FRAME_HINT_END && rxHeaderCallback != NULL
+			&& !rxHeaderCallback(buf, FRAME_HINT_END)) {
+		LOG(LOG_PARSER, "Reception stopped after %u bytes", FRAME_HINT_END);
+		if(RadioEvents->RxDone != NULL)
+			(RadioEvents->RxDone)(buf, FRAME_HINT_END, 0, 0);
+		return ret;
+	}
+
+	/* Wait for the transmission to be finished */
 	int evt;
 	if(ret != -1) {
 		/* Wait for the radio file to be deleted (transmission duration + 50%) */
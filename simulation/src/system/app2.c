@@ -139,6 +139,8 @@ void register_sys_functions(LOWAPP_SYS_IF_T *lowappSys) {
 	lowappSys->SYS_cancelTimer = cancel_timer1;
 	lowappSys->SYS_setTimer2 = set_timer2;
 	lowappSys->SYS_cancelTimer2 = cancel_timer2;
+	lowappSys->SYS_setTimer3 = set_timer3;
+	lowappSys->SYS_cancelTimer3 = cancel_timer3;
 	lowappSys->SYS_setRepetitiveTimer = set_repet_timer;
 	lowappSys->SYS_cancelRepetitiveTimer = cancel_repet_timer;
 	lowappSys->SYS_delayMs = simu_delayMs;
@@ -158,6 +160,7 @@ void register_sys_functions(LOWAPP_SYS_IF_T *lowappSys) {
 	lowappSys->SYS_radioSetChannel = simu_radio_setChannel;
 	lowappSys->SYS_initTimer = init_timer1;
 	lowappSys->SYS_initTimer2 = init_timer2;
+	lowappSys->SYS_initTimer3 = init_timer3;
 	lowappSys->SYS_initRepetitiveTimer = init_repet_timer;
 	lowappSys->SYS_random = simu_radio_random;
 	lowappSys->SYS_radioSleep = dummy;